@@ -31,6 +31,23 @@ CompareResult AbstractSequence::Compare(const INode* rh) const {
   return CompareResult::Equal;
 }
 
+uint64_t AbstractSequence::ComputeHash() const {
+  uint64_t result = HashCombine(INodeImpl::ComputeHash(), Size());
+  for (const auto& value : values_)
+    result = HashCombine(result, ChildHash(value.get()));
+  return result;
+}
+
+void AbstractSequence::CollectFreeVariables(SymbolSet* result) const {
+  for (const auto& value : values_)
+    result->InsertAll(ChildFreeVariables(value.get()));
+}
+
+void AbstractSequence::ForgetChildren() const {
+  for (const auto& value : values_)
+    ForgetChild(value.get());
+}
+
 PrintSize AbstractSequence::DoRender(PrintDirection direction,
                                      Canvas* canvas,
                                      PrintBox print_box,
@@ -71,6 +88,7 @@ bool AbstractSequence::CheckCircular(const INodeImpl* other) const {
 
 void AbstractSequence::SimplifyImpl(HotToken token,
                                     std::unique_ptr<INode>* new_node) {
+  InvalidateCaches();
   for (auto& val : values_) {
     std::unique_ptr<INode> new_sub_node;
     val->AsNodeImpl()->SimplifyImpl({&token}, &new_sub_node);
@@ -81,6 +99,7 @@ void AbstractSequence::SimplifyImpl(HotToken token,
 
 void AbstractSequence::OpenBracketsImpl(HotToken token,
                                         std::unique_ptr<INode>* new_node) {
+  InvalidateCaches();
   for (auto& val : values_) {
     std::unique_ptr<INode> temp_node;
     val->AsNodeImpl()->OpenBracketsImpl({&token}, &temp_node);
@@ -91,6 +110,7 @@ void AbstractSequence::OpenBracketsImpl(HotToken token,
 
 void AbstractSequence::ConvertToComplexImpl(HotToken token,
                                             std::unique_ptr<INode>* new_node) {
+  InvalidateCaches();
   for (auto& node : values_) {
     std::unique_ptr<INode> temp_node;
     node->AsNodeImpl()->ConvertToComplexImpl({&token}, &temp_node);
@@ -100,15 +120,18 @@ void AbstractSequence::ConvertToComplexImpl(HotToken token,
 }
 
 std::unique_ptr<INode> AbstractSequence::TakeValue(size_t indx) {
+  InvalidateCaches();
   return std::move(values_[indx]);
 }
 
 void AbstractSequence::AddValue(std::unique_ptr<INode> rh) {
+  InvalidateCaches();
   values_.push_back(std::move(rh));
 }
 
 void AbstractSequence::SetValue(size_t indx, std::unique_ptr<INode> node) {
   assert(indx < values_.size());
+  InvalidateCaches();
   values_[indx] = std::move(node);
 }
 
@@ -209,6 +232,7 @@ PrintSize AbstractSequence::RenderValue(const INode* value,
 }
 
 void AbstractSequence::DoUnfold(std::vector<std::unique_ptr<INode>>* result) {
+  InvalidateCaches();
   for (auto& value : values_) {
     if (auto* seq = value->AsNodeImpl()->AsAbstractSequence()) {
       seq->DoUnfold(result);
@@ -38,6 +38,10 @@ class AbstractSequence : public INodeImpl {
     Horizontal,
     Vertical,
   };
+  uint64_t ComputeHash() const override;
+  void CollectFreeVariables(SymbolSet* result) const override;
+  void ForgetChildren() const override;
+
   std::unique_ptr<AbstractSequence> DoClone(
       std::unique_ptr<AbstractSequence> result) const;
 
@@ -0,0 +1,185 @@
+#include "BatchKernels.h"
+
+#include <cmath>
+
+#include "BatchMath.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BATCH_KERNELS_X64 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+
+void ScalarUnMinus(const double* src, double* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = -src[i];
+}
+
+void ScalarMinus(const double* lh, const double* rh, double* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = lh[i] - rh[i];
+}
+
+void ScalarPlus(const double* lh, const double* rh, double* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = lh[i] + rh[i];
+}
+
+void ScalarMult(const double* lh, const double* rh, double* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = lh[i] * rh[i];
+}
+
+void ScalarDiv(const double* lh, const double* rh, double* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = lh[i] / rh[i];
+}
+
+void ScalarPowInt(const double* src, int exp, double* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = std::pow(src[i], exp);
+}
+
+void ScalarSqrt(const double* src, double* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = std::sqrt(src[i]);
+}
+
+void ScalarSin(const double* src, double* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = std::sin(src[i]);
+}
+
+void ScalarCos(const double* src, double* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = std::cos(src[i]);
+}
+
+void ScalarLog(const double* src, double* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = std::log(src[i]);
+}
+
+const BatchKernels kScalarKernels = {
+    SimdLevel::Scalar, &ScalarUnMinus, &ScalarMinus, &ScalarPlus,
+    &ScalarMult,       &ScalarDiv,     &ScalarPowInt, &ScalarSqrt,
+    &ScalarSin,        &ScalarCos,     &ScalarLog,
+};
+
+#if defined(BATCH_KERNELS_X64)
+struct Sse2 {
+  using Reg = __m128d;
+  static constexpr size_t kLanes = 2;
+
+  static Reg Load(const double* src) { return _mm_loadu_pd(src); }
+  static void Store(double* dst, Reg x) { _mm_storeu_pd(dst, x); }
+  static Reg Set1(double value) { return _mm_set1_pd(value); }
+  static Reg Add(Reg lh, Reg rh) { return _mm_add_pd(lh, rh); }
+  static Reg Sub(Reg lh, Reg rh) { return _mm_sub_pd(lh, rh); }
+  static Reg Mul(Reg lh, Reg rh) { return _mm_mul_pd(lh, rh); }
+  static Reg Div(Reg lh, Reg rh) { return _mm_div_pd(lh, rh); }
+  static Reg Sqrt(Reg x) { return _mm_sqrt_pd(x); }
+  static Reg And(Reg lh, Reg rh) { return _mm_and_pd(lh, rh); }
+  static Reg Xor(Reg lh, Reg rh) { return _mm_xor_pd(lh, rh); }
+  static Reg CmpEq(Reg lh, Reg rh) { return _mm_cmpeq_pd(lh, rh); }
+  static Reg CmpLt(Reg lh, Reg rh) { return _mm_cmplt_pd(lh, rh); }
+  static Reg CmpLe(Reg lh, Reg rh) { return _mm_cmple_pd(lh, rh); }
+  static Reg Blend(Reg mask, Reg if_true, Reg if_false) {
+    return _mm_or_pd(_mm_and_pd(mask, if_true),
+                     _mm_andnot_pd(mask, if_false));
+  }
+  static bool AllTrue(Reg mask) { return _mm_movemask_pd(mask) == 0x3; }
+  static Reg SignBit(Reg x) { return _mm_and_pd(x, _mm_set1_pd(-0.0)); }
+  // Only for non-negative values below 2^31.
+  static Reg Truncate(Reg x) { return _mm_cvtepi32_pd(_mm_cvttpd_epi32(x)); }
+  // x = Mantissa(x) * 2^Exponent(x), Mantissa(x) in [0.5, 1).
+  static Reg Exponent(Reg x) {
+    __m128i bits = _mm_srli_epi64(_mm_castpd_si128(x), 52);
+    bits = _mm_and_si128(bits, _mm_set1_epi64x(0x7ff));
+    bits = _mm_or_si128(bits, _mm_set1_epi64x(0x4330000000000000ll));
+    return _mm_sub_pd(_mm_castsi128_pd(bits),
+                      _mm_set1_pd(4503599627370496.0 + 1022.0));
+  }
+  static Reg Mantissa(Reg x) {
+    __m128i bits = _mm_and_si128(_mm_castpd_si128(x),
+                                 _mm_set1_epi64x(0x000fffffffffffffll));
+    bits = _mm_or_si128(bits, _mm_set1_epi64x(0x3fe0000000000000ll));
+    return _mm_castsi128_pd(bits);
+  }
+};
+
+bool CpuSupportsAvx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  bool os_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                (_xgetbv(0) & 0x6) == 0x6;
+  if (!os_avx)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+SimdLevel DetectSimdLevel() {
+#if defined(BATCH_KERNELS_X64)
+  if (CpuSupportsAvx2() && GetAvx2BatchKernels())
+    return SimdLevel::Avx2;
+  return SimdLevel::Sse2;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+}  // namespace
+
+double BatchScalarSin(double value) {
+  return std::sin(value);
+}
+
+double BatchScalarCos(double value) {
+  return std::cos(value);
+}
+
+double BatchScalarLog(double value) {
+  return std::log(value);
+}
+
+double BatchScalarPowInt(double value, int exp) {
+  return std::pow(value, exp);
+}
+
+const BatchKernels* GetSse2BatchKernels() {
+#if defined(BATCH_KERNELS_X64)
+  static const BatchKernels kernels = MakeBatchKernels<Sse2>(SimdLevel::Sse2);
+  return &kernels;
+#else
+  return nullptr;
+#endif
+}
+
+SimdLevel GetSupportedSimdLevel() {
+  static const SimdLevel level = DetectSimdLevel();
+  return level;
+}
+
+const BatchKernels* GetBatchKernels(SimdLevel level) {
+  if (level > GetSupportedSimdLevel())
+    return nullptr;
+  switch (level) {
+    case SimdLevel::Scalar:
+      return &kScalarKernels;
+    case SimdLevel::Sse2:
+      return GetSse2BatchKernels();
+    case SimdLevel::Avx2:
+      return GetAvx2BatchKernels();
+  }
+  return nullptr;
+}
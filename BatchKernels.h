@@ -0,0 +1,46 @@
+#pragma once
+#include <stddef.h>
+
+enum class SimdLevel {
+  Scalar = 0,
+  Sse2 = 1,
+  Avx2 = 2,
+};
+
+// Elementwise loops over arrays of doubles used by batch evaluation, one
+// table per instruction set. Source and destination may be the same array.
+// The vector versions of sin, cos, log and integer powers agree with the
+// scalar library functions to 3 ulp, sin and cos to 2.
+struct BatchKernels {
+  // Integer powers are repeated multiplications, each adding up to half an
+  // ulp, so larger exponents are left to std::pow.
+  static constexpr int kMaxPowInt = 4;
+
+  using UnaryF = void (*)(const double* src, double* dst, size_t count);
+  using BinaryF = void (*)(const double* lh,
+                           const double* rh,
+                           double* dst,
+                           size_t count);
+  using PowIntF = void (*)(const double* src,
+                           int exp,
+                           double* dst,
+                           size_t count);
+
+  SimdLevel level;
+  UnaryF un_minus;
+  BinaryF minus;
+  BinaryF plus;
+  BinaryF mult;
+  BinaryF div;
+  // |exp| must not exceed kMaxPowInt.
+  PowIntF pow_int;
+  UnaryF sqrt;
+  UnaryF sin;
+  UnaryF cos;
+  UnaryF log;
+};
+
+// Best level supported by both the build and the running CPU.
+SimdLevel GetSupportedSimdLevel();
+// Returns nullptr if |level| is not supported.
+const BatchKernels* GetBatchKernels(SimdLevel level);
@@ -0,0 +1,84 @@
+#include "BatchKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+
+// Everything below is compiled for AVX2 and only called after the CPU check
+// in GetSupportedSimdLevel(). Standard headers are included above so that no
+// shared inline code is emitted with AVX2 instructions.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), \
+                             apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+// The vector helpers never cross the boundary of this file.
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+#include "BatchMath.h"
+
+namespace {
+
+struct Avx2 {
+  using Reg = __m256d;
+  static constexpr size_t kLanes = 4;
+
+  static Reg Load(const double* src) { return _mm256_loadu_pd(src); }
+  static void Store(double* dst, Reg x) { _mm256_storeu_pd(dst, x); }
+  static Reg Set1(double value) { return _mm256_set1_pd(value); }
+  static Reg Add(Reg lh, Reg rh) { return _mm256_add_pd(lh, rh); }
+  static Reg Sub(Reg lh, Reg rh) { return _mm256_sub_pd(lh, rh); }
+  static Reg Mul(Reg lh, Reg rh) { return _mm256_mul_pd(lh, rh); }
+  static Reg Div(Reg lh, Reg rh) { return _mm256_div_pd(lh, rh); }
+  static Reg Sqrt(Reg x) { return _mm256_sqrt_pd(x); }
+  static Reg And(Reg lh, Reg rh) { return _mm256_and_pd(lh, rh); }
+  static Reg Xor(Reg lh, Reg rh) { return _mm256_xor_pd(lh, rh); }
+  static Reg CmpEq(Reg lh, Reg rh) { return _mm256_cmp_pd(lh, rh, _CMP_EQ_OQ); }
+  static Reg CmpLt(Reg lh, Reg rh) { return _mm256_cmp_pd(lh, rh, _CMP_LT_OQ); }
+  static Reg CmpLe(Reg lh, Reg rh) { return _mm256_cmp_pd(lh, rh, _CMP_LE_OQ); }
+  static Reg Blend(Reg mask, Reg if_true, Reg if_false) {
+    return _mm256_blendv_pd(if_false, if_true, mask);
+  }
+  static bool AllTrue(Reg mask) { return _mm256_movemask_pd(mask) == 0xf; }
+  static Reg SignBit(Reg x) { return _mm256_and_pd(x, _mm256_set1_pd(-0.0)); }
+  static Reg Truncate(Reg x) {
+    return _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+  }
+  static Reg Exponent(Reg x) {
+    __m256i bits = _mm256_srli_epi64(_mm256_castpd_si256(x), 52);
+    bits = _mm256_and_si256(bits, _mm256_set1_epi64x(0x7ff));
+    bits = _mm256_or_si256(bits, _mm256_set1_epi64x(0x4330000000000000ll));
+    return _mm256_sub_pd(_mm256_castsi256_pd(bits),
+                         _mm256_set1_pd(4503599627370496.0 + 1022.0));
+  }
+  static Reg Mantissa(Reg x) {
+    __m256i bits = _mm256_and_si256(_mm256_castpd_si256(x),
+                                    _mm256_set1_epi64x(0x000fffffffffffffll));
+    bits = _mm256_or_si256(bits, _mm256_set1_epi64x(0x3fe0000000000000ll));
+    return _mm256_castsi256_pd(bits);
+  }
+};
+
+}  // namespace
+
+const BatchKernels* GetAvx2BatchKernels() {
+  static const BatchKernels kernels = MakeBatchKernels<Avx2>(SimdLevel::Avx2);
+  return &kernels;
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#else
+
+#include "BatchMath.h"
+
+const BatchKernels* GetAvx2BatchKernels() {
+  return nullptr;
+}
+
+#endif
@@ -0,0 +1,289 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "BatchKernels.h"
+
+// Kernel templates shared by the SIMD kernel tables. |Simd| wraps one vector
+// register type; each table instantiates the templates in the translation
+// unit compiled for its instruction set, so this header must not pull in
+// inline code of its own.
+
+const BatchKernels* GetSse2BatchKernels();
+const BatchKernels* GetAvx2BatchKernels();
+
+double BatchScalarSin(double value);
+double BatchScalarCos(double value);
+double BatchScalarLog(double value);
+double BatchScalarPowInt(double value, int exp);
+
+template <typename Simd, typename F>
+void ApplyUnary(const double* src, double* dst, size_t count, F f) {
+  size_t i = 0;
+  for (; i + Simd::kLanes <= count; i += Simd::kLanes)
+    Simd::Store(dst + i, f(Simd::Load(src + i)));
+  if (i == count)
+    return;
+  // The tail goes through the same vector code, padded with ones.
+  double in[Simd::kLanes];
+  double out[Simd::kLanes];
+  for (size_t j = 0; j < Simd::kLanes; ++j)
+    in[j] = (i + j < count) ? src[i + j] : 1.0;
+  Simd::Store(out, f(Simd::Load(in)));
+  for (size_t j = 0; i + j < count; ++j)
+    dst[i + j] = out[j];
+}
+
+template <typename Simd, typename F>
+void ApplyBinary(const double* lh,
+                 const double* rh,
+                 double* dst,
+                 size_t count,
+                 F f) {
+  size_t i = 0;
+  for (; i + Simd::kLanes <= count; i += Simd::kLanes)
+    Simd::Store(dst + i, f(Simd::Load(lh + i), Simd::Load(rh + i)));
+  for (; i < count; ++i) {
+    double out[Simd::kLanes];
+    Simd::Store(out, f(Simd::Set1(lh[i]), Simd::Set1(rh[i])));
+    dst[i] = out[0];
+  }
+}
+
+// Lanes the approximation does not cover are recomputed by |scalar_f|.
+template <typename Simd, typename F>
+typename Simd::Reg FixLanes(typename Simd::Reg x,
+                            typename Simd::Reg result,
+                            typename Simd::Reg valid,
+                            F scalar_f) {
+  if (Simd::AllTrue(valid))
+    return result;
+  double in[Simd::kLanes];
+  double out[Simd::kLanes];
+  double mask[Simd::kLanes];
+  Simd::Store(in, x);
+  Simd::Store(out, result);
+  Simd::Store(mask, Simd::Blend(valid, Simd::Set1(1.0), Simd::Set1(0.0)));
+  for (size_t i = 0; i < Simd::kLanes; ++i) {
+    if (mask[i] == 0.0)
+      out[i] = scalar_f(in[i]);
+  }
+  return Simd::Load(out);
+}
+
+template <typename Simd>
+typename Simd::Reg HornerPolynomial(typename Simd::Reg x,
+                              const double* coefficients,
+                              size_t count) {
+  typename Simd::Reg result = Simd::Set1(coefficients[count - 1]);
+  for (size_t i = count - 1; i > 0; --i)
+    result = Simd::Add(Simd::Mul(result, x), Simd::Set1(coefficients[i - 1]));
+  return result;
+}
+
+// sin(z) and cos(z) for |z| <= pi/4, Taylor series.
+template <typename Simd>
+typename Simd::Reg SinKernel(typename Simd::Reg z) {
+  static const double kSin[] = {
+      -1.0 / 6.0,
+      1.0 / 120.0,
+      -1.0 / 5040.0,
+      1.0 / 362880.0,
+      -1.0 / 39916800.0,
+      1.0 / 6227020800.0,
+      -1.0 / 1307674368000.0,
+      1.0 / 355687428096000.0,
+      -1.0 / 121645100408832000.0,
+  };
+  auto z2 = Simd::Mul(z, z);
+  auto poly = HornerPolynomial<Simd>(z2, kSin, sizeof(kSin) / sizeof(kSin[0]));
+  return Simd::Add(z, Simd::Mul(Simd::Mul(z, z2), poly));
+}
+
+template <typename Simd>
+typename Simd::Reg CosKernel(typename Simd::Reg z) {
+  static const double kCos[] = {
+      1.0 / 24.0,
+      -1.0 / 720.0,
+      1.0 / 40320.0,
+      -1.0 / 3628800.0,
+      1.0 / 479001600.0,
+      -1.0 / 87178291200.0,
+      1.0 / 20922789888000.0,
+      -1.0 / 6402373705728000.0,
+      1.0 / 2432902008176640000.0,
+  };
+  auto z2 = Simd::Mul(z, z);
+  auto poly = HornerPolynomial<Simd>(z2, kCos, sizeof(kCos) / sizeof(kCos[0]));
+  return Simd::Add(Simd::Sub(Simd::Set1(1.0), Simd::Mul(Simd::Set1(0.5), z2)),
+                   Simd::Mul(Simd::Mul(z2, z2), poly));
+}
+
+// Reduces |x| to z in [-pi/4, pi/4] and the even octant index in 0..6.
+template <typename Simd>
+void ReduceAngle(typename Simd::Reg abs_x,
+                 typename Simd::Reg* z,
+                 typename Simd::Reg* octant) {
+  // pi/4 split so that y * kPiQuarter1 and y * kPiQuarter2 are exact.
+  const double kPiQuarter1 = 7.85398125648498535156e-1;
+  const double kPiQuarter2 = 3.77489470793079817668e-8;
+  const double kPiQuarter3 = 2.69515142907905952645e-15;
+  const double kFourOverPi = 1.27323954473516268615;
+
+  auto y = Simd::Truncate(Simd::Mul(abs_x, Simd::Set1(kFourOverPi)));
+  auto half = Simd::Truncate(Simd::Mul(y, Simd::Set1(0.5)));
+  auto odd = Simd::Sub(y, Simd::Add(half, half));
+  y = Simd::Add(y, odd);
+  *z = Simd::Sub(abs_x, Simd::Mul(y, Simd::Set1(kPiQuarter1)));
+  *z = Simd::Sub(*z, Simd::Mul(y, Simd::Set1(kPiQuarter2)));
+  *z = Simd::Sub(*z, Simd::Mul(y, Simd::Set1(kPiQuarter3)));
+  auto eighth = Simd::Truncate(Simd::Mul(y, Simd::Set1(0.125)));
+  *octant = Simd::Sub(y, Simd::Mul(eighth, Simd::Set1(8.0)));
+}
+
+// Reduction is exact well beyond this argument.
+constexpr double kMaxTrigArgument = 1e8;
+
+template <typename Simd>
+typename Simd::Reg SimdSin(typename Simd::Reg x) {
+  auto sign = Simd::SignBit(x);
+  auto abs_x = Simd::Xor(x, sign);
+  typename Simd::Reg z;
+  typename Simd::Reg octant;
+  ReduceAngle<Simd>(abs_x, &z, &octant);
+  // 0: sin(z), 2: cos(z), 4: -sin(z), 6: -cos(z).
+  auto use_cos = Simd::CmpEq(
+      Simd::Sub(octant, Simd::Mul(Simd::Truncate(Simd::Mul(
+                                      octant, Simd::Set1(0.25))),
+                                  Simd::Set1(4.0))),
+      Simd::Set1(2.0));
+  auto negate = Simd::CmpLe(Simd::Set1(4.0), octant);
+  auto result = Simd::Blend(use_cos, CosKernel<Simd>(z), SinKernel<Simd>(z));
+  result = Simd::Xor(result, Simd::And(negate, Simd::Set1(-0.0)));
+  result = Simd::Xor(result, sign);
+  auto valid = Simd::CmpLe(abs_x, Simd::Set1(kMaxTrigArgument));
+  return FixLanes<Simd>(x, result, valid, &BatchScalarSin);
+}
+
+template <typename Simd>
+typename Simd::Reg SimdCos(typename Simd::Reg x) {
+  auto abs_x = Simd::Xor(x, Simd::SignBit(x));
+  typename Simd::Reg z;
+  typename Simd::Reg octant;
+  ReduceAngle<Simd>(abs_x, &z, &octant);
+  // 0: cos(z), 2: -sin(z), 4: -cos(z), 6: sin(z).
+  auto use_sin = Simd::CmpEq(
+      Simd::Sub(octant, Simd::Mul(Simd::Truncate(Simd::Mul(
+                                      octant, Simd::Set1(0.25))),
+                                  Simd::Set1(4.0))),
+      Simd::Set1(2.0));
+  auto negate = Simd::And(Simd::CmpLe(Simd::Set1(2.0), octant),
+                          Simd::CmpLe(octant, Simd::Set1(4.0)));
+  auto result = Simd::Blend(use_sin, SinKernel<Simd>(z), CosKernel<Simd>(z));
+  result = Simd::Xor(result, Simd::And(negate, Simd::Set1(-0.0)));
+  auto valid = Simd::CmpLe(abs_x, Simd::Set1(kMaxTrigArgument));
+  return FixLanes<Simd>(x, result, valid, &BatchScalarCos);
+}
+
+// log(x) = e * ln(2) + 2 * atanh((m - 1) / (m + 1)), m in [sqrt(1/2), sqrt(2)).
+template <typename Simd>
+typename Simd::Reg SimdLog(typename Simd::Reg x) {
+  static const double kAtanh[] = {
+      2.0,        2.0 / 3.0,  2.0 / 5.0,  2.0 / 7.0,  2.0 / 9.0,  2.0 / 11.0,
+      2.0 / 13.0, 2.0 / 15.0, 2.0 / 17.0, 2.0 / 19.0, 2.0 / 21.0, 2.0 / 23.0,
+  };
+  const double kLn2Hi = 6.93359375e-1;
+  const double kLn2Lo = -2.121944400546905827679e-4;
+  const double kSqrtHalf = 7.07106781186547524401e-1;
+  const double kMinNormal = 2.2250738585072014e-308;
+  const double kMaxFinite = 1.7976931348623157e308;
+
+  auto m = Simd::Mantissa(x);
+  auto e = Simd::Exponent(x);
+  auto small = Simd::CmpLt(m, Simd::Set1(kSqrtHalf));
+  m = Simd::Blend(small, Simd::Add(m, m), m);
+  e = Simd::Sub(e, Simd::And(small, Simd::Set1(1.0)));
+  auto f = Simd::Sub(m, Simd::Set1(1.0));
+  auto s = Simd::Div(f, Simd::Add(m, Simd::Set1(1.0)));
+  auto poly = HornerPolynomial<Simd>(Simd::Mul(s, s), kAtanh,
+                               sizeof(kAtanh) / sizeof(kAtanh[0]));
+  auto result = Simd::Add(Simd::Mul(s, poly), Simd::Mul(e, Simd::Set1(kLn2Lo)));
+  result = Simd::Add(result, Simd::Mul(e, Simd::Set1(kLn2Hi)));
+  auto valid = Simd::And(Simd::CmpLe(Simd::Set1(kMinNormal), x),
+                         Simd::CmpLe(x, Simd::Set1(kMaxFinite)));
+  return FixLanes<Simd>(x, result, valid, &BatchScalarLog);
+}
+
+template <typename Simd>
+typename Simd::Reg SimdPowInt(typename Simd::Reg x, int exp) {
+  const double kMinNormal = 2.2250738585072014e-308;
+  const double kMaxFinite = 1.7976931348623157e308;
+  unsigned int n = exp < 0 ? -static_cast<unsigned int>(exp) : exp;
+  auto result = Simd::Set1(1.0);
+  auto base = x;
+  while (n) {
+    if (n & 1)
+      result = Simd::Mul(result, base);
+    n >>= 1;
+    if (n)
+      base = Simd::Mul(base, base);
+  }
+  // Lanes that left the normal range go to std::pow: the products lose its
+  // rounding there, and 1/x^n of an overflowed x^n is 0, not a denormal.
+  auto magnitude = Simd::Xor(result, Simd::SignBit(result));
+  auto valid = Simd::And(Simd::CmpLe(Simd::Set1(kMinNormal), magnitude),
+                         Simd::CmpLe(magnitude, Simd::Set1(kMaxFinite)));
+  if (exp < 0)
+    result = Simd::Div(Simd::Set1(1.0), result);
+  return FixLanes<Simd>(x, result, valid, [exp](double value) {
+    return BatchScalarPowInt(value, exp);
+  });
+}
+
+template <typename Simd>
+BatchKernels MakeBatchKernels(SimdLevel level) {
+  using Reg = typename Simd::Reg;
+  BatchKernels result;
+  result.level = level;
+  result.un_minus = [](const double* src, double* dst, size_t count) {
+    ApplyUnary<Simd>(src, dst, count,
+                     [](Reg x) { return Simd::Xor(x, Simd::Set1(-0.0)); });
+  };
+  result.minus = [](const double* lh, const double* rh, double* dst,
+                    size_t count) {
+    ApplyBinary<Simd>(lh, rh, dst, count,
+                      [](Reg a, Reg b) { return Simd::Sub(a, b); });
+  };
+  result.plus = [](const double* lh, const double* rh, double* dst,
+                   size_t count) {
+    ApplyBinary<Simd>(lh, rh, dst, count,
+                      [](Reg a, Reg b) { return Simd::Add(a, b); });
+  };
+  result.mult = [](const double* lh, const double* rh, double* dst,
+                   size_t count) {
+    ApplyBinary<Simd>(lh, rh, dst, count,
+                      [](Reg a, Reg b) { return Simd::Mul(a, b); });
+  };
+  result.div = [](const double* lh, const double* rh, double* dst,
+                  size_t count) {
+    ApplyBinary<Simd>(lh, rh, dst, count,
+                      [](Reg a, Reg b) { return Simd::Div(a, b); });
+  };
+  result.pow_int = [](const double* src, int exp, double* dst, size_t count) {
+    ApplyUnary<Simd>(src, dst, count,
+                     [exp](Reg x) { return SimdPowInt<Simd>(x, exp); });
+  };
+  result.sqrt = [](const double* src, double* dst, size_t count) {
+    ApplyUnary<Simd>(src, dst, count, [](Reg x) { return Simd::Sqrt(x); });
+  };
+  result.sin = [](const double* src, double* dst, size_t count) {
+    ApplyUnary<Simd>(src, dst, count, [](Reg x) { return SimdSin<Simd>(x); });
+  };
+  result.cos = [](const double* src, double* dst, size_t count) {
+    ApplyUnary<Simd>(src, dst, count, [](Reg x) { return SimdCos<Simd>(x); });
+  };
+  result.log = [](const double* src, double* dst, size_t count) {
+    ApplyUnary<Simd>(src, dst, count, [](Reg x) { return SimdLog<Simd>(x); });
+  };
+  return result;
+}
@@ -0,0 +1,221 @@
+#include "BatchProcessor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <utility>
+
+#include "BinaryImage.h"
+#include "CompiledExpression.h"
+#include "Constant.h"
+#include "EvaluationContext.h"
+#include "INodeHelper.h"
+#include "Imaginary.h"
+#include "MultOperation.h"
+#include "Parser.h"
+#include "PlusOperation.h"
+#include "Serializer.h"
+#include "Utf8.h"
+#include "ValueHelpers.h"
+#include "Variable.h"
+#include "VariableScope.h"
+
+namespace {
+// Expressions handed to a worker at a time. Results are written a chunk at a
+// time, in order, as soon as the chunk is done.
+constexpr size_t kChunkSize = 16;
+
+std::unique_ptr<INode> MakeValue(std::complex<double> value) {
+  if (value.imag() == 0)
+    return INodeHelper::MakeConst(value.real());
+  auto imag = INodeHelper::MakeMult(INodeHelper::MakeConst(value.imag()),
+                                    INodeHelper::MakeImaginary());
+  if (value.real() == 0)
+    return imag;
+  return INodeHelper::MakePlus(INodeHelper::MakeConst(value.real()),
+                               std::move(imag));
+}
+}  // namespace
+
+struct BatchProcessor::Worker {
+  Worker() : parser(&scope) {}
+
+  VariableScope scope;
+  Parser parser;
+};
+
+BatchProcessor::BatchProcessor(std::vector<BatchStep> steps,
+                               BatchOutput output,
+                               size_t threads_count)
+    : steps_(std::move(steps)),
+      output_(output),
+      threads_count_(threads_count) {
+  if (threads_count_ == 0)
+    threads_count_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+BatchProcessor::~BatchProcessor() {}
+
+void BatchProcessor::AddText(std::string_view text) {
+  while (!text.empty()) {
+    size_t end = text.find('\n');
+    std::string_view line = text.substr(0, end);
+    text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    if (line.find_first_not_of(" \t") != std::string_view::npos)
+      items_.push_back({line, nullptr, 0});
+  }
+}
+
+void BatchProcessor::AddImage(const BinaryImage* image) {
+  for (size_t i = 0; i < image->Size(); ++i)
+    items_.push_back({{}, image, i});
+}
+
+size_t BatchProcessor::Run(std::ostream& out) {
+  const size_t chunks_count = (items_.size() + kChunkSize - 1) / kChunkSize;
+  std::vector<std::string> results(items_.size());
+  std::vector<bool> chunks_done(chunks_count);
+  std::atomic<size_t> next_chunk{0};
+  std::atomic<size_t> failed{0};
+  std::mutex mutex;
+  std::condition_variable chunk_done;
+
+  auto work = [&]() {
+    Worker worker;
+    size_t worker_failed = 0;
+    for (;;) {
+      size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= chunks_count)
+        break;
+      size_t end = std::min(items_.size(), (chunk + 1) * kChunkSize);
+      for (size_t i = chunk * kChunkSize; i < end; ++i) {
+        results[i] = Process(items_[i], &worker);
+        if (results[i].compare(0, 7, "error: ") == 0)
+          ++worker_failed;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks_done[chunk] = true;
+      }
+      chunk_done.notify_one();
+    }
+    failed += worker_failed;
+  };
+
+  std::vector<std::thread> threads;
+  const size_t threads_count = std::min(threads_count_, chunks_count);
+  for (size_t i = 0; i < threads_count; ++i)
+    threads.emplace_back(work);
+  for (size_t chunk = 0; chunk < chunks_count; ++chunk) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      chunk_done.wait(lock, [&]() { return chunks_done[chunk]; });
+    }
+    size_t end = std::min(items_.size(), (chunk + 1) * kChunkSize);
+    for (size_t i = chunk * kChunkSize; i < end; ++i) {
+      out << results[i];
+      std::string().swap(results[i]);
+    }
+  }
+  for (auto& thread : threads)
+    thread.join();
+  out.flush();
+  return failed;
+}
+
+std::string BatchProcessor::Process(const Item& item, Worker* worker) const {
+  std::unique_ptr<INode> node;
+  if (item.image) {
+    node = item.image->Load(item.indx, &worker->scope);
+    if (!node)
+      return "error: damaged binary expression\n";
+  } else {
+    node = worker->parser.Parse(item.text);
+    if (!node) {
+      return "error: " + worker->parser.Error() + " at " +
+             std::to_string(worker->parser.ErrorOffset()) + "\n";
+    }
+  }
+
+  Variable expression(std::move(node));
+  std::string error;
+  for (const BatchStep& step : steps_) {
+    if (!ApplyStep(step, &expression, worker, &error))
+      return "error: " + error + "\n";
+  }
+
+  std::string result;
+  switch (output_) {
+    case BatchOutput::Infix:
+      result = ToUtf8(Serializer::ToString(expression, SerializeFormat::Infix));
+      break;
+    case BatchOutput::Latex:
+      result = ToUtf8(Serializer::ToString(expression, SerializeFormat::Latex));
+      break;
+    case BatchOutput::MathMl:
+      result =
+          ToUtf8(Serializer::ToString(expression, SerializeFormat::MathMl));
+      break;
+    case BatchOutput::Print:
+      result = ToUtf8(expression.Print());
+      break;
+  }
+  if (result.empty() || result.back() != '\n')
+    result.push_back('\n');
+  return result;
+}
+
+bool BatchProcessor::ApplyStep(const BatchStep& step,
+                               Variable* expression,
+                               Worker* worker,
+                               std::string* error) const {
+  switch (step.type) {
+    case BatchStepType::Simplify:
+      expression->Simplify();
+      return true;
+    case BatchStepType::OpenBrackets:
+      expression->OpenBrackets();
+      return true;
+    case BatchStepType::Diff: {
+      // DiffOperation only differentiates scalars.
+      const INode* value = expression->GetValue();
+      if (value && value->AsNodeImpl()->GetValueType() != ValueType::Scalar) {
+        *error = "can not differentiate, not a scalar";
+        return false;
+      }
+      *expression = Diff(*expression, *worker->scope.Get(step.variable));
+      // Diff nodes are expanded by SymCalc, Simplify keeps them.
+      *expression = expression->SymCalc(SymCalcSettings::KeepNamedConstants);
+      return true;
+    }
+    case BatchStepType::Evaluate: {
+      std::vector<Symbol> symbols;
+      symbols.reserve(step.bindings.size());
+      for (const auto& binding : step.bindings)
+        symbols.push_back(Symbol(binding.first));
+      std::shared_ptr<const CompiledExpression> compiled;
+      if (const INode* value = expression->GetValue())
+        compiled = CompiledExpression::Compile(value, std::move(symbols));
+      if (!compiled) {
+        *error = "can not evaluate, not a scalar or a variable is not bound";
+        return false;
+      }
+      EvaluationContext context(compiled);
+      for (size_t i = 0; i < step.bindings.size(); ++i)
+        context.Bind(i, step.bindings[i].second);
+      if (compiled->IsComplex())
+        *expression = MakeValue(context.EvaluateComplex());
+      else
+        *expression = INodeHelper::MakeConst(context.Evaluate());
+      return true;
+    }
+  }
+  return false;
+}
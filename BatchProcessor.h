@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class BinaryImage;
+class Parser;
+class Variable;
+class VariableScope;
+
+enum class BatchStepType {
+  Simplify,
+  OpenBrackets,
+  // Derivative by |variable|.
+  Diff,
+  // Numeric value with |bindings| substituted.
+  Evaluate,
+};
+
+// Aggregate-initialized with the fields its type needs, the rest stay empty.
+struct BatchStep {
+  BatchStepType type;
+  std::wstring variable{};
+  std::vector<std::pair<std::wstring, double>> bindings{};
+};
+
+enum class BatchOutput {
+  Infix,
+  Latex,
+  MathMl,
+  // The text of Variable::Print().
+  Print,
+};
+
+// Runs a pipeline of steps over many independent expressions on a pool of
+// threads. Every thread parses or loads its expressions into its own
+// VariableScope, so workers share nothing but the input. Results are written
+// in input order, one line per expression, as UTF-8.
+class BatchProcessor {
+ public:
+  BatchProcessor(std::vector<BatchStep> steps,
+                 BatchOutput output,
+                 size_t threads_count = 0);
+  BatchProcessor(const BatchProcessor&) = delete;
+  ~BatchProcessor();
+
+  // Adds every non-empty line of |text|. |text| must outlive Run().
+  void AddText(std::string_view text);
+  // Adds every expression of |image|, which must outlive Run().
+  void AddImage(const BinaryImage* image);
+  size_t Size() const { return items_.size(); }
+
+  // Returns the number of expressions that failed, their lines start with
+  // "error: ".
+  size_t Run(std::ostream& out);
+
+ private:
+  struct Item {
+    std::string_view text;
+    const BinaryImage* image;
+    size_t indx;
+  };
+  struct Worker;
+
+  std::string Process(const Item& item, Worker* worker) const;
+  bool ApplyStep(const BatchStep& step,
+                 Variable* expression,
+                 Worker* worker,
+                 std::string* error) const;
+
+  std::vector<BatchStep> steps_;
+  BatchOutput output_;
+  size_t threads_count_;
+  std::vector<Item> items_;
+};
@@ -0,0 +1,103 @@
+// Benchmark driver:
+//   symmath-bench [--filter TEXT] [--report] [--sweep DEPTH [--samples N]]
+//                 [--profile]
+// Writes the results of Benchmarks::RunSuite() to stdout as JSON, or with
+// --report runs the benchmarks of Benchmarks::Run() with readable output.
+// --sweep writes the CSV of Benchmarks::RunSweep() instead. --profile adds
+// the SimplifyProfile report of the run to stderr.
+// The global operator new is replaced here to count allocations.
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <new>
+#include <string_view>
+
+#include "Benchmarks.h"
+#include "SimplifyProfile.h"
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  Benchmarks::CountAllocation(size);
+  return malloc(size ? size : 1);
+}
+
+void* operator new(size_t size) {
+  if (void* ptr = operator new(size, std::nothrow))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  free(ptr);
+}
+
+int main(int argc, char* argv[]) {
+  std::string_view filter;
+  bool report = false;
+  bool sweep = false;
+  bool profile = false;
+  int sweep_depth = 0;
+  int samples = 8;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--filter" && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (arg == "--report") {
+      report = true;
+    } else if (arg == "--sweep" && i + 1 < argc) {
+      sweep = true;
+      sweep_depth = atoi(argv[++i]);
+    } else if (arg == "--samples" && i + 1 < argc) {
+      samples = atoi(argv[++i]);
+    } else if (arg == "--profile") {
+      profile = true;
+    } else {
+      std::cerr << "usage: symmath-bench [--filter TEXT] [--report] "
+                   "[--sweep DEPTH [--samples N]] [--profile]\n";
+      return 2;
+    }
+  }
+  if ((sweep && sweep_depth <= 0) || samples <= 0) {
+    std::cerr << "symmath-bench: bad --sweep or --samples value\n";
+    return 2;
+  }
+  SimplifyProfile simplify_profile;
+  ScopedSimplifyProfile scoped_profile(profile ? &simplify_profile : nullptr);
+  if (report)
+    Benchmarks::Run();
+  else if (sweep)
+    Benchmarks::RunSweep(std::cout, sweep_depth, samples);
+  else
+    Benchmarks::RunSuite(std::cout, filter);
+  if (profile)
+    simplify_profile.WriteReport(std::cerr);
+  return 0;
+}
@@ -0,0 +1,741 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BinaryImage.h"
+#include "BinaryWriter.h"
+#include "CompiledExpression.h"
+#include "Constant.h"
+#include "EvaluationContext.h"
+#include "INodeHelper.h"
+#include "Parser.h"
+#include "PlusOperation.h"
+#include "RandomExpression.h"
+#include "Serializer.h"
+#include "Utf8.h"
+#include "ValueHelpers.h"
+#include "Variable.h"
+#include "VariableScope.h"
+#include "Vector.h"
+
+namespace {
+using BenchmarkF = void (*)();
+
+const BenchmarkF kBenchmarks[] = {
+    &Benchmarks::BenchmarkGradient,
+    &Benchmarks::BenchmarkPrint,
+    &Benchmarks::BenchmarkSerialize,
+    &Benchmarks::BenchmarkParse,
+    &Benchmarks::BenchmarkBinary,
+};
+
+// Average time of |f| in microseconds over |repeats| calls.
+template <typename F>
+double MeasureMicroseconds(size_t repeats, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < repeats; ++i)
+    f(i);
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / repeats;
+}
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocated_bytes{0};
+
+// Accumulates the measured part of a suite case over its runs.
+class SuiteTimer {
+ public:
+  void Start() {
+    allocations_ = g_allocations.load(std::memory_order_relaxed);
+    allocated_bytes_ = g_allocated_bytes.load(std::memory_order_relaxed);
+    start_ = std::chrono::steady_clock::now();
+  }
+  void Stop() {
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start_;
+    total_us_ += elapsed.count();
+    min_us_ = runs_ ? std::min(min_us_, elapsed.count()) : elapsed.count();
+    total_allocations_ +=
+        g_allocations.load(std::memory_order_relaxed) - allocations_;
+    total_allocated_bytes_ +=
+        g_allocated_bytes.load(std::memory_order_relaxed) - allocated_bytes_;
+    ++runs_;
+  }
+  // Nodes of the input and of the result of the measured operation.
+  void SetNodes(size_t nodes_in, size_t nodes_out) {
+    has_nodes_in_ = true;
+    nodes_in_ = nodes_in;
+    nodes_out_ = nodes_out;
+  }
+  // For cases that build their input while measured.
+  void SetNodesOut(size_t nodes_out) { nodes_out_ = nodes_out; }
+  // For cases that print, their result is text rather than nodes.
+  void SetCharsOut(size_t chars_out) {
+    has_chars_out_ = true;
+    chars_out_ = chars_out;
+  }
+
+  size_t Runs() const { return runs_; }
+  double TotalMicroseconds() const { return total_us_; }
+  void WriteJson(std::ostream& out) const {
+    out << "\"runs\": " << runs_ << ", \"mean_us\": " << total_us_ / runs_
+        << ", \"min_us\": " << min_us_
+        << ", \"allocations\": " << total_allocations_ / runs_
+        << ", \"allocated_bytes\": " << total_allocated_bytes_ / runs_;
+    if (has_nodes_in_)
+      out << ", \"nodes_in\": " << nodes_in_;
+    if (has_chars_out_)
+      out << ", \"chars_out\": " << chars_out_;
+    else
+      out << ", \"nodes_out\": " << nodes_out_;
+  }
+  // Either nodes_out or chars_out is left empty.
+  void WriteCsv(std::ostream& out) const {
+    out << nodes_in_ << ',';
+    if (has_chars_out_)
+      out << ',' << chars_out_;
+    else
+      out << nodes_out_ << ',';
+    out << ',' << total_us_ / runs_ << ',' << total_allocations_ / runs_ << ','
+        << total_allocated_bytes_ / runs_;
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+  uint64_t allocations_ = 0;
+  uint64_t allocated_bytes_ = 0;
+  size_t runs_ = 0;
+  double total_us_ = 0;
+  double min_us_ = 0;
+  uint64_t total_allocations_ = 0;
+  uint64_t total_allocated_bytes_ = 0;
+  bool has_nodes_in_ = false;
+  size_t nodes_in_ = 0;
+  size_t nodes_out_ = 0;
+  bool has_chars_out_ = false;
+  size_t chars_out_ = 0;
+};
+
+struct SuiteCase {
+  std::string name;
+  // Name and value of the size parameter, if any.
+  const char* param;
+  size_t value;
+  std::function<void(SuiteTimer*)> run;
+};
+
+size_t CountNodes(const Variable& var) {
+  std::unique_ptr<INode> value = var;
+  return INodeHelper::CountNodes(value.get());
+}
+
+void BacMinusCab(SuiteTimer* timer) {
+  auto a1 = Var(L"a1");
+  auto a2 = Var(L"a2");
+  auto a3 = Var(L"a3");
+  auto b1 = Var(L"b1");
+  auto b2 = Var(L"b2");
+  auto b3 = Var(L"b3");
+  auto c1 = Var(L"c1");
+  auto c2 = Var(L"c2");
+  auto c3 = Var(L"c3");
+  auto a = Var(L"a");
+  auto b = Var(L"b");
+  auto c = Var(L"c");
+  // The same steps and prints as in Numbers.cpp, the text is dropped.
+  timer->Start();
+  a = Vector3(a1, a2, a3);
+  a.Print();
+  b = Vector3(b1, b2, b3);
+  b.Print();
+  c = Vector3(c1, c2, c3);
+  c.Print();
+  Variable s_ab = a * b;
+  s_ab.Print(true);
+  Variable v_aa = VectorMult(b, c);
+  v_aa.Print(true);
+  Variable v_ab = VectorMult(a, b);
+  v_ab.Print(true);
+  Variable v_ba = VectorMult(b, a);
+  v_ba.Print(true);
+  Variable vv = v_ab + v_ba;
+  vv.Print(true);
+  Variable sv_abc = a * VectorMult(b, c);
+  sv_abc.Print(true);
+  Variable sv_bca = b * VectorMult(c, a);
+  sv_bca.Print(true);
+  Variable sv_cab = c * VectorMult(a, b);
+  sv_cab.Print(true);
+  Variable eq_sv =
+      Vector3(sv_abc == sv_bca, sv_bca == sv_cab, sv_cab == sv_abc);
+  eq_sv.Print(true);
+  Variable abc = VectorMult(a, VectorMult(b, c));
+  abc.Print(true);
+  Variable bac = (b * (a * c));
+  bac.Print(true);
+  Variable cab = (c * (a * b));
+  cab.Print(true);
+  Variable bac_cab = bac - cab;
+  bac_cab.Print(true);
+  Variable abc_bac_cab = abc == (bac - cab);
+  abc_bac_cab.Print(true);
+  timer->Stop();
+  timer->SetNodesOut(CountNodes(abc_bac_cab));
+}
+
+void EulerEquation(SuiteTimer* timer) {
+  auto x = Var(L"x");
+  timer->Start();
+  Variable t = (Sin(x) ^ 2) + (Cos(x) ^ 2);
+  t.Print(true);
+  t.ConvertToComplex();
+  t.OpenBrackets();
+  t.Print(true);
+  Variable t1 = 2 * Sin(x) * Cos(x);
+  t1.ConvertToComplex();
+  t1.OpenBrackets();
+  t1.Simplify();
+  Variable t2 = Sin(2 * x);
+  t2.ConvertToComplex();
+  t2.OpenBrackets();
+  t2.Simplify();
+  Variable t3 = Pow(Cos(x), 2) - Pow(Sin(x), 2);
+  t3.ConvertToComplex();
+  t3.OpenBrackets();
+  t3.Print(true);
+  Variable t4 = Cos(2 * x);
+  t4.ConvertToComplex();
+  t4.OpenBrackets();
+  t4.Print(true);
+  Variable t12 = t1 == t2;
+  t12.Print(true);
+  Variable t34 = t3 == t4;
+  t34.Print(true);
+  Variable dt = Diff(Sin(x), x);
+  dt.ConvertToComplex();
+  Variable cos_x = Cos(x);
+  cos_x.ConvertToComplex();
+  Variable cmp = dt == cos_x;
+  cmp.Print(true);
+  timer->Stop();
+  timer->SetNodesOut(CountNodes(t) + CountNodes(t12) + CountNodes(t34) +
+                     CountNodes(cmp));
+}
+
+void RationalDerivative(SuiteTimer* timer) {
+  auto x = Var(L"x");
+  timer->Start();
+  Variable t1 = -1 / (-1 + x) + 4 / x + (-1 - 3 * x) / (1 + x + (x ^ 2));
+  t1.OpenBrackets();
+  t1.Simplify();
+  t1 = Diff(t1, x);
+  t1.Print(true);
+  t1 = t1.SymCalc(SymCalcSettings::KeepNamedConstants);
+  t1.OpenBrackets();
+  t1.Simplify();
+  t1.Print(true);
+  timer->Stop();
+  timer->SetNodesOut(CountNodes(t1));
+}
+
+// Like terms spread over a sum of |n| terms.
+std::unique_ptr<INode> MakeSum(const Variable& x, const Variable& y, size_t n) {
+  std::vector<std::unique_ptr<INode>> terms;
+  for (size_t k = 0; k < n; ++k) {
+    terms.push_back(static_cast<double>(k % 7 + 1) *
+                    Pow(x, static_cast<double>(k % 5)) * (y ^ (k % 3)));
+  }
+  return INodeHelper::MakePlus(std::move(terms));
+}
+
+// (..((x + y) * (x - 2y) + 1) * (x + 3y) + 1) ..) with |depth| products.
+std::unique_ptr<INode> MakeNestedProduct(const Variable& x,
+                                         const Variable& y,
+                                         size_t depth) {
+  std::unique_ptr<INode> result = x + y;
+  for (size_t k = 2; k <= depth + 1; ++k) {
+    double sign = k % 2 ? 1 : -1;
+    result = std::move(result) * (x + sign * static_cast<double>(k) * y) + 1;
+  }
+  return result;
+}
+
+// sqrt(sqrt(x^2 + x)^2 + 2x ..) with |depth| levels.
+std::unique_ptr<INode> MakeNestedRoot(const Variable& x, size_t depth) {
+  std::unique_ptr<INode> result = x;
+  for (size_t k = 1; k <= depth; ++k) {
+    result = Sqrt(Pow(std::move(result), 2) + static_cast<double>(k) * x,
+                  k % 2 ? 2 : 3);
+  }
+  return result;
+}
+
+std::vector<SuiteCase> MakeSuiteCases() {
+  std::vector<SuiteCase> cases = {
+      {"scenario/BacMinusCab", nullptr, 0, &BacMinusCab},
+      {"scenario/EulerEquation", nullptr, 0, &EulerEquation},
+      {"scenario/RationalDerivative", nullptr, 0, &RationalDerivative},
+  };
+  for (size_t n : {16, 64, 256, 1024}) {
+    cases.push_back({"sum_length/Simplify", "n", n, [n](SuiteTimer* timer) {
+                       auto x = Var(L"x");
+                       auto y = Var(L"y");
+                       Variable s = MakeSum(x, y, n);
+                       size_t nodes_in = CountNodes(s);
+                       timer->Start();
+                       s.Simplify();
+                       timer->Stop();
+                       timer->SetNodes(nodes_in, CountNodes(s));
+                     }});
+    cases.push_back({"sum_length/Print", "n", n, [n](SuiteTimer* timer) {
+                       auto x = Var(L"x");
+                       auto y = Var(L"y");
+                       Variable s = MakeSum(x, y, n);
+                       timer->Start();
+                       std::wstring text = s.Print();
+                       timer->Stop();
+                       timer->SetNodes(CountNodes(s), 0);
+                       timer->SetCharsOut(text.size());
+                     }});
+  }
+  for (size_t depth : {2, 4, 8, 12}) {
+    cases.push_back(
+        {"product_depth/OpenBrackets", "depth", depth,
+         [depth](SuiteTimer* timer) {
+           auto x = Var(L"x");
+           auto y = Var(L"y");
+           Variable p = MakeNestedProduct(x, y, depth);
+           size_t nodes_in = CountNodes(p);
+           timer->Start();
+           p.OpenBrackets();
+           p.Simplify();
+           timer->Stop();
+           timer->SetNodes(nodes_in, CountNodes(p));
+         }});
+  }
+  for (size_t depth : {2, 4, 8, 16}) {
+    cases.push_back(
+        {"nested_pow_sqrt/Diff", "depth", depth, [depth](SuiteTimer* timer) {
+           auto x = Var(L"x");
+           Variable f = MakeNestedRoot(x, depth);
+           size_t nodes_in = CountNodes(f);
+           timer->Start();
+           Variable d = Diff(f, x);
+           Variable result = d.SymCalc(SymCalcSettings::KeepNamedConstants);
+           timer->Stop();
+           timer->SetNodes(nodes_in, CountNodes(result));
+         }});
+    cases.push_back(
+        {"nested_pow_sqrt/SymCalc", "depth", depth,
+         [depth](SuiteTimer* timer) {
+           auto x = Var(L"x", 0.75);
+           Variable f = MakeNestedRoot(x, depth);
+           size_t nodes_in = CountNodes(f);
+           timer->Start();
+           Variable result = f.SymCalc(SymCalcSettings::Full);
+           timer->Stop();
+           timer->SetNodes(nodes_in, CountNodes(result));
+         }});
+  }
+  for (size_t n : {3, 16, 64, 256}) {
+    cases.push_back(
+        {"vector_dimension/Expand", "n", n, [n](SuiteTimer* timer) {
+           std::vector<std::unique_ptr<Variable>> vars;
+           std::vector<std::unique_ptr<INode>> a;
+           std::vector<std::unique_ptr<INode>> b;
+           for (size_t i = 0; i < n; ++i) {
+             vars.push_back(
+                 std::make_unique<Variable>(L"a" + std::to_wstring(i)));
+             a.push_back(*vars.back());
+             vars.push_back(
+                 std::make_unique<Variable>(L"b" + std::to_wstring(i)));
+             b.push_back(*vars.back());
+           }
+           std::unique_ptr<INode> va = INodeHelper::MakeVector(std::move(a));
+           std::unique_ptr<INode> vb = INodeHelper::MakeVector(std::move(b));
+           std::unique_ptr<INode> sum = va->Clone() + vb->Clone();
+           Variable s = std::move(sum) * (std::move(va) - std::move(vb));
+           size_t nodes_in = CountNodes(s);
+           // SymCalc computes the scalar product per component.
+           timer->Start();
+           Variable result = s.SymCalc(SymCalcSettings::KeepNamedConstants);
+           result.OpenBrackets();
+           result.Simplify();
+           timer->Stop();
+           timer->SetNodes(nodes_in, CountNodes(result));
+         }});
+  }
+  return cases;
+}
+
+// What an operation of the sweep leaves to be measured once the timer stops:
+// a new expression in |node|, printed text in |text|, or neither if the
+// operation changed its input in place.
+struct SweepResult {
+  std::unique_ptr<INode> node;
+  std::wstring text;
+};
+
+struct SweepOperation {
+  const char* name;
+  SweepResult (*run)(Variable* expression, const Variable& var);
+};
+
+const SweepOperation kSweepOperations[] = {
+    {"Simplify",
+     [](Variable* expression, const Variable&) {
+       expression->Simplify();
+       return SweepResult();
+     }},
+    {"OpenBrackets",
+     [](Variable* expression, const Variable&) {
+       expression->OpenBrackets();
+       return SweepResult();
+     }},
+    {"Diff",
+     [](Variable* expression, const Variable& var) {
+       Variable d = Diff(*expression, var);
+       SweepResult result;
+       result.node = d.SymCalc(SymCalcSettings::KeepNamedConstants);
+       return result;
+     }},
+    {"Print",
+     [](Variable* expression, const Variable&) {
+       SweepResult result;
+       result.text = expression->Print();
+       return result;
+     }},
+};
+}  // namespace
+
+void Benchmarks::Run() {
+  for (auto benchmark : kBenchmarks)
+    benchmark();
+}
+
+// static
+void Benchmarks::RunSuite(std::ostream& out, std::string_view filter) {
+  // Every case runs at least kMinRuns times and until kMinMicroseconds have
+  // been measured, but no more than kMaxRuns times.
+  constexpr size_t kMinRuns = 3;
+  constexpr size_t kMaxRuns = 100;
+  constexpr double kMinMicroseconds = 200000;
+  const bool allocations_counted =
+      g_allocations.load(std::memory_order_relaxed) != 0;
+  out << "{\n  \"suite\": \"symmath\",\n  \"allocations_counted\": "
+      << (allocations_counted ? "true" : "false")
+      << ",\n  \"benchmarks\": [";
+  const char* separator = "\n";
+  for (const SuiteCase& suite_case : MakeSuiteCases()) {
+    if (suite_case.name.find(filter) == std::string::npos)
+      continue;
+    SuiteTimer timer;
+    while (timer.Runs() < kMinRuns ||
+           (timer.Runs() < kMaxRuns &&
+            timer.TotalMicroseconds() < kMinMicroseconds)) {
+      suite_case.run(&timer);
+    }
+    out << separator << "    {\"name\": \"" << suite_case.name << "\", ";
+    if (suite_case.param) {
+      out << "\"params\": {\"" << suite_case.param
+          << "\": " << suite_case.value << "}, ";
+    }
+    timer.WriteJson(out);
+    out << "}" << std::flush;
+    separator = ",\n";
+  }
+  out << "\n  ]\n}\n";
+}
+
+// static
+void Benchmarks::RunSweep(std::ostream& out, size_t max_depth, size_t samples) {
+  out << "operation,depth,sample,nodes_in,nodes_out,chars_out,time_us,"
+         "allocations,allocated_bytes\n";
+  VariableScope scope;
+  for (size_t depth = 1; depth <= max_depth; ++depth) {
+    RandomExpressionOptions options;
+    options.seed = depth;
+    options.max_depth = depth;
+    options.max_exponent = 2;
+    RandomExpression generator(options, &scope);
+    const Variable& x0 = *scope.Get(L"x0");
+    for (size_t sample = 0; sample < samples; ++sample) {
+      std::unique_ptr<INode> expression = generator.Generate();
+      size_t nodes_in = INodeHelper::CountNodes(expression.get());
+      for (const SweepOperation& operation : kSweepOperations) {
+        Variable value = expression->Clone();
+        SuiteTimer timer;
+        timer.Start();
+        SweepResult result = operation.run(&value, x0);
+        timer.Stop();
+        if (result.node) {
+          timer.SetNodes(nodes_in, INodeHelper::CountNodes(result.node.get()));
+        } else if (!result.text.empty()) {
+          timer.SetNodes(nodes_in, 0);
+          timer.SetCharsOut(result.text.size());
+        } else {
+          timer.SetNodes(nodes_in, CountNodes(value));
+        }
+        out << operation.name << ',' << depth << ',' << sample << ',';
+        timer.WriteCsv(out);
+        out << '\n';
+      }
+      out << std::flush;
+    }
+  }
+}
+
+// static
+void Benchmarks::CountAllocation(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+// static
+void Benchmarks::BenchmarkGradient() {
+  constexpr size_t kVariables = 32;
+  constexpr size_t kRepeats = 200;
+  std::vector<std::unique_ptr<Variable>> vars;
+  std::vector<Symbol> symbols;
+  for (size_t i = 0; i < kVariables; ++i) {
+    vars.push_back(std::make_unique<Variable>(L"x" + std::to_wstring(i)));
+    symbols.push_back(vars.back()->GetSymbol());
+  }
+  auto objective = [&vars]() {
+    std::unique_ptr<INode> result = Const(0);
+    for (size_t i = 0; i + 1 < vars.size(); ++i) {
+      const Variable& x = *vars[i];
+      const Variable& y = *vars[i + 1];
+      result = std::move(result) + Sin(x) * y +
+               Pow(x - y, 2) / (Pow(y, 2) + 1) + Log(x * x + 1) +
+               Sqrt(y * y + 2, 3) * Cos(x);
+    }
+    return result;
+  };
+  auto point = [](size_t repeat, size_t i) {
+    return std::sin(repeat * 0.37 + i * 1.3);
+  };
+
+  // Symbolic: one derivative per variable, evaluated by SymCalc.
+  std::vector<std::unique_ptr<Variable>> derivatives;
+  double symbolic_setup = MeasureMicroseconds(1, [&](size_t) {
+    for (auto& var : vars) {
+      Variable diff = Diff(objective(), *var);
+      derivatives.push_back(std::make_unique<Variable>(
+          diff.SymCalc(SymCalcSettings::KeepNamedConstants)));
+    }
+  });
+  std::vector<double> symbolic_gradient(kVariables);
+  double symbolic = MeasureMicroseconds(kRepeats, [&](size_t repeat) {
+    for (size_t i = 0; i < kVariables; ++i)
+      *vars[i] = point(repeat, i);
+    for (size_t i = 0; i < kVariables; ++i) {
+      auto value = derivatives[i]->SymCalc(SymCalcSettings::Full);
+      const Constant* constant = INodeHelper::AsConstant(value.get());
+      symbolic_gradient[i] = constant ? constant->Value() : NAN;
+    }
+  });
+
+  std::unique_ptr<INode> node = objective();
+  std::shared_ptr<const CompiledExpression> compiled =
+      CompiledExpression::Compile(node.get(), symbols);
+  EvaluationContext context(compiled);
+  std::vector<double> values(kVariables);
+  std::vector<double> gradient(kVariables);
+  double reverse = MeasureMicroseconds(kRepeats, [&](size_t repeat) {
+    for (size_t i = 0; i < kVariables; ++i)
+      values[i] = point(repeat, i);
+    context.BindAll(values.data());
+    context.EvaluateGradient(gradient.data());
+  });
+
+  std::vector<double> directions(kVariables * kVariables, 0.0);
+  for (size_t i = 0; i < kVariables; ++i)
+    directions[i * kVariables + i] = 1.0;
+  std::vector<double> forward_gradient(kVariables);
+  double forward = MeasureMicroseconds(kRepeats, [&](size_t repeat) {
+    for (size_t i = 0; i < kVariables; ++i)
+      values[i] = point(repeat, i);
+    context.BindAll(values.data());
+    context.EvaluateDerivatives(directions.data(), kVariables,
+                                forward_gradient.data());
+  });
+
+  // The last repeat of every method evaluated the same point.
+  double max_difference = 0.0;
+  for (size_t i = 0; i < kVariables; ++i) {
+    max_difference = std::max(
+        {max_difference, std::abs(gradient[i] - symbolic_gradient[i]),
+         std::abs(gradient[i] - forward_gradient[i])});
+  }
+  std::wcout << L"BenchmarkGradient: " << kVariables << L" variables, "
+             << compiled->InstructionsCount() << L" instructions\n"
+             << L"  symbolic Diff: " << symbolic_setup << L" us once, "
+             << symbolic << L" us per gradient\n"
+             << L"  forward mode: " << forward << L" us per gradient\n"
+             << L"  reverse mode: " << reverse << L" us per gradient\n"
+             << L"  max difference: " << max_difference << std::endl;
+}
+
+// static
+void Benchmarks::BenchmarkPrint() {
+  constexpr size_t kTerms = 40;
+  constexpr size_t kRepeats = 50;
+  auto x = Var(L"x", 0.5);
+  auto y = Var(L"y", 2);
+  std::vector<std::unique_ptr<Variable>> expressions;
+  for (size_t repeat = 0; repeat < kRepeats; ++repeat) {
+    std::unique_ptr<INode> sum = Const(0);
+    for (size_t i = 1; i <= kTerms; ++i) {
+      sum = std::move(sum) +
+            Pow(x, static_cast<double>(i)) / (y + static_cast<double>(i)) +
+            Sqrt(Sin(x * static_cast<double>(i)) + 2, 3);
+    }
+    expressions.push_back(std::make_unique<Variable>(std::move(sum)));
+  }
+
+  size_t length = 0;
+  // The first print of an expression lays it out.
+  double layout = MeasureMicroseconds(kRepeats, [&](size_t repeat) {
+    length += expressions[repeat]->Print().size();
+  });
+  double paint = MeasureMicroseconds(kRepeats, [&](size_t) {
+    length += expressions.front()->Print().size();
+  });
+  std::wcout << L"BenchmarkPrint: " << kTerms * 2 << L" terms, "
+             << length / (2 * kRepeats) << L" characters\n"
+             << L"  layout and paint: " << layout << L" us per print\n"
+             << L"  paint only: " << paint << L" us per print" << std::endl;
+}
+
+// static
+void Benchmarks::BenchmarkSerialize() {
+  constexpr size_t kTerms = 100000;
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  std::vector<std::unique_ptr<INode>> terms;
+  terms.reserve(kTerms);
+  for (size_t i = 1; i <= kTerms; ++i) {
+    double k = static_cast<double>(i);
+    terms.push_back(Pow(x, k) / (y + k) - Sin(x * k));
+  }
+  Variable s(INodeHelper::MakePlus(std::move(terms)));
+
+  const std::pair<SerializeFormat, const wchar_t*> kFormats[] = {
+      {SerializeFormat::Infix, L"infix"},
+      {SerializeFormat::Latex, L"LaTeX"},
+      {SerializeFormat::MathMl, L"MathML"},
+  };
+  std::wcout << L"BenchmarkSerialize: " << kTerms * 13 << L" nodes\n";
+  for (const auto& format : kFormats) {
+    size_t length = 0;
+    double elapsed = MeasureMicroseconds(1, [&](size_t) {
+      std::wostringstream out;
+      Serializer(format.first, out).Write(s);
+      length = out.str().size();
+    });
+    std::wcout << L"  " << format.second << L": " << elapsed / 1000
+               << L" ms, " << length / elapsed << L" characters per us\n";
+  }
+  std::wcout << std::flush;
+}
+
+// static
+void Benchmarks::BenchmarkParse() {
+  constexpr size_t kExpressions = 20000;
+  constexpr size_t kRepeats = 5;
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  // One expression per line, as Serializer writes them.
+  std::string corpus;
+  std::vector<std::pair<size_t, size_t>> lines;
+  for (size_t i = 1; i <= kExpressions; ++i) {
+    double k = static_cast<double>(i);
+    Variable expression = Pow(x, k) / (y + k) - Sin(x * k) * Cos(y / k) +
+                          Sqrt(y * k + x, 3) * Log(x + k);
+    std::string text =
+        ToUtf8(Serializer::ToString(expression, SerializeFormat::Infix));
+    lines.emplace_back(corpus.size(), text.size());
+    corpus += text;
+    corpus.push_back('\n');
+  }
+
+  VariableScope scope;
+  Parser parser(&scope);
+  size_t failed = 0;
+  double elapsed = MeasureMicroseconds(kRepeats, [&](size_t) {
+    for (const auto& line : lines) {
+      if (!parser.Parse({corpus.data() + line.first, line.second}))
+        ++failed;
+    }
+  });
+  std::wcout << L"BenchmarkParse: " << kExpressions << L" expressions, "
+             << corpus.size() << L" bytes\n"
+             << L"  " << corpus.size() / elapsed << L" MB/s, "
+             << kExpressions / elapsed * 1e6 << L" expressions/s, " << failed
+             << L" failed" << std::endl;
+}
+
+// static
+void Benchmarks::BenchmarkBinary() {
+  constexpr size_t kExpressions = 20000;
+  constexpr size_t kRepeats = 5;
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  std::string corpus;
+  std::vector<std::pair<size_t, size_t>> lines;
+  for (size_t i = 1; i <= kExpressions; ++i) {
+    double k = static_cast<double>(i);
+    Variable expression = Pow(x, k) / (y + k) - Sin(x * k) * Cos(y / k) +
+                          Sqrt(y * k + x, 3) * Log(x + k);
+    std::string text =
+        ToUtf8(Serializer::ToString(expression, SerializeFormat::Infix));
+    lines.emplace_back(corpus.size(), text.size());
+    corpus += text;
+  }
+  VariableScope scope;
+  Parser parser(&scope);
+  std::vector<std::unique_ptr<INode>> expressions;
+  for (const auto& line : lines)
+    expressions.push_back(
+        parser.Parse({corpus.data() + line.first, line.second}));
+
+  std::string image;
+  double write = MeasureMicroseconds(kRepeats, [&](size_t) {
+    BinaryWriter writer;
+    for (const auto& expression : expressions)
+      writer.Add(expression.get());
+    image = writer.Image();
+  });
+  auto binary_image = BinaryImage::Open(image);
+  size_t nodes_count = 0;
+  for (size_t i = 0; i < binary_image->Size(); ++i)
+    nodes_count += binary_image->NodesCount(i);
+
+  double load = MeasureMicroseconds(kRepeats, [&](size_t) {
+    auto loaded = BinaryImage::Open(image);
+    for (size_t i = 0; i < loaded->Size(); ++i)
+      loaded->Load(i, &scope);
+  });
+  double parse = MeasureMicroseconds(kRepeats, [&](size_t) {
+    for (const auto& line : lines)
+      parser.Parse({corpus.data() + line.first, line.second});
+  });
+  std::wcout << L"BenchmarkBinary: " << kExpressions << L" expressions, "
+             << nodes_count << L" nodes, " << image.size() << L" bytes, text "
+             << corpus.size() << L" bytes\n"
+             << L"  write " << write / 1000 << L" ms, load " << load / 1000
+             << L" ms, parse " << parse / 1000 << L" ms" << std::endl;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stddef.h>
+
+#include <iosfwd>
+#include <string_view>
+
+class Benchmarks {
+ public:
+  static void Run();
+  // Times the Numbers.cpp scenarios and parameterized cases whose names
+  // contain |filter| and writes wall time, allocations and node counts to
+  // |out| as JSON.
+  static void RunSuite(std::ostream& out, std::string_view filter = {});
+  // Times Simplify, OpenBrackets, Diff and Print on |samples| random
+  // expressions of every depth up to |max_depth| and writes one CSV row per
+  // expression and operation, to plot time and allocations by node count.
+  // OpenBrackets grows exponentially with the depth, 8 takes seconds.
+  static void RunSweep(std::ostream& out, size_t max_depth, size_t samples);
+  // Called by executables that replace the global operator new, like
+  // BenchmarkMain.cpp, so the suite can report allocations.
+  static void CountAllocation(size_t size);
+  static void BenchmarkGradient();
+  static void BenchmarkPrint();
+  static void BenchmarkSerialize();
+  static void BenchmarkParse();
+  static void BenchmarkBinary();
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Layout of the images written by BinaryWriter and read by BinaryImage:
+//   magic
+//   expressions, each a postfix stream of nodes: operands precede the node
+//   names: varint count, then varint size and UTF-8 bytes of each name
+//   directory: varint count, then varint offset, size and nodes count of
+//     each expression; offsets are counted from the start of the image
+//   footer: uint64 offset of names, uint64 offset of directory, magic
+// Every node starts with a BinaryTag byte. Counts and name indices are
+// LEB128 varints, doubles are stored as 8 raw bytes in host order.
+enum class BinaryTag : uint8_t {
+  Number,         // double
+  Integer,        // zigzag varint of an integral Number
+  NamedConstant,  // name index, double
+  False,
+  True,
+  Variable,  // name index
+  Imaginary,
+  Error,      // name index of the text
+  Operation,  // Op byte, operands count
+  Vector,     // values count
+  Sequence,   // values count
+  Brackets,   // BracketType byte
+  Last = Brackets,
+};
+
+constexpr char kBinaryMagic[4] = {'S', 'Y', 'M', '1'};
+constexpr size_t kBinaryFooterSize =
+    2 * sizeof(uint64_t) + sizeof(kBinaryMagic);
@@ -0,0 +1,314 @@
+#include "BinaryImage.h"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "BinaryFormat.h"
+#include "Brackets.h"
+#include "CompareOperation.h"
+#include "Constant.h"
+#include "DiffOperation.h"
+#include "DivOperation.h"
+#include "INodeHelper.h"
+#include "Imaginary.h"
+#include "LogOperation.h"
+#include "MultOperation.h"
+#include "OpInfo.h"
+#include "PlusOperation.h"
+#include "PowOperation.h"
+#include "Sequence.h"
+#include "SqrtOperation.h"
+#include "TrigonometricOperation.h"
+#include "UnMinusOperation.h"
+#include "Utf8.h"
+#include "Variable.h"
+#include "VariableRef.h"
+#include "VariableScope.h"
+#include "Vector.h"
+#include "VectorMultOperation.h"
+
+namespace {
+// Reads the image front to back, every read checks the bounds.
+class Reader {
+ public:
+  explicit Reader(std::string_view data)
+      : pos_(data.data()), end_(data.data() + data.size()) {}
+
+  bool AtEnd() const { return pos_ == end_; }
+  const char* Position() const { return pos_; }
+
+  bool ReadByte(uint8_t* value) {
+    if (pos_ == end_)
+      return false;
+    *value = static_cast<uint8_t>(*pos_++);
+    return true;
+  }
+
+  bool ReadVarint(uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (!ReadByte(&byte))
+        return false;
+      *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool ReadDouble(double* value) {
+    if (static_cast<size_t>(end_ - pos_) < sizeof(*value))
+      return false;
+    std::memcpy(value, pos_, sizeof(*value));
+    pos_ += sizeof(*value);
+    return true;
+  }
+
+  bool ReadBytes(uint64_t size, std::string_view* value) {
+    if (static_cast<uint64_t>(end_ - pos_) < size)
+      return false;
+    *value = std::string_view(pos_, static_cast<size_t>(size));
+    pos_ += size;
+    return true;
+  }
+
+ private:
+  const char* pos_;
+  const char* end_;
+};
+
+std::unique_ptr<INode> MakeOperation(
+    Op op,
+    std::vector<std::unique_ptr<INode>> operands) {
+  switch (op) {
+    case Op::UnMinus:
+      return INodeHelper::MakeUnMinus(std::move(operands[0]));
+    case Op::Plus:
+      return INodeHelper::MakePlus(std::move(operands));
+    case Op::Mult:
+      return INodeHelper::MakeMult(std::move(operands));
+    case Op::VectorMult:
+      return INodeHelper::MakeVectorMult(std::move(operands[0]),
+                                         std::move(operands[1]));
+    case Op::Div:
+      return INodeHelper::MakeDiv(std::move(operands[0]),
+                                  std::move(operands[1]));
+    case Op::Pow:
+      return INodeHelper::MakePow(std::move(operands[0]),
+                                  std::move(operands[1]));
+    case Op::Sqrt:
+      return INodeHelper::MakeSqrt(std::move(operands[0]),
+                                   std::move(operands[1]));
+    case Op::Sin:
+    case Op::Cos:
+      return INodeHelper::MakeTrigonometric(op, std::move(operands[0]));
+    case Op::Log:
+      return INodeHelper::MakeLog(std::move(operands[0]),
+                                  std::move(operands[1]));
+    case Op::Equal:
+      return INodeHelper::MakeCompare(op, std::move(operands[0]),
+                                      std::move(operands[1]));
+    case Op::Diff: {
+      const Variable* var = operands[1]->AsNodeImpl()->AsVariable();
+      if (!var || var->GetName().empty())
+        return nullptr;
+      return INodeHelper::MakeDiff(std::move(operands[0]),
+                                   std::make_unique<VariableRef>(var));
+    }
+    case Op::Minus:
+      break;
+  }
+  return nullptr;
+}
+}  // namespace
+
+BinaryImage::BinaryImage() {}
+
+BinaryImage::~BinaryImage() {}
+
+// static
+std::unique_ptr<BinaryImage> BinaryImage::Open(std::string_view data) {
+  if (data.size() < sizeof(kBinaryMagic) + kBinaryFooterSize)
+    return nullptr;
+  if (std::memcmp(data.data(), kBinaryMagic, sizeof(kBinaryMagic)) != 0)
+    return nullptr;
+  const char* footer = data.data() + data.size() - kBinaryFooterSize;
+  uint64_t names_offset;
+  uint64_t directory_offset;
+  std::memcpy(&names_offset, footer, sizeof(names_offset));
+  std::memcpy(&directory_offset, footer + sizeof(names_offset),
+              sizeof(directory_offset));
+  if (std::memcmp(footer + 2 * sizeof(uint64_t), kBinaryMagic,
+                  sizeof(kBinaryMagic)) != 0) {
+    return nullptr;
+  }
+  const uint64_t footer_offset = data.size() - kBinaryFooterSize;
+  if (names_offset < sizeof(kBinaryMagic) || names_offset > directory_offset ||
+      directory_offset > footer_offset) {
+    return nullptr;
+  }
+
+  std::unique_ptr<BinaryImage> result(new BinaryImage());
+  Reader names(data.substr(names_offset, directory_offset - names_offset));
+  uint64_t count;
+  if (!names.ReadVarint(&count) || count > directory_offset - names_offset)
+    return nullptr;
+  result->names_.resize(count);
+  for (auto& name : result->names_) {
+    uint64_t size;
+    if (!names.ReadVarint(&size) || !names.ReadBytes(size, &name))
+      return nullptr;
+  }
+
+  Reader directory(
+      data.substr(directory_offset, footer_offset - directory_offset));
+  if (!directory.ReadVarint(&count) ||
+      count > footer_offset - directory_offset) {
+    return nullptr;
+  }
+  result->expressions_.resize(count);
+  for (Entry& entry : result->expressions_) {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t nodes_count;
+    if (!directory.ReadVarint(&offset) || !directory.ReadVarint(&size) ||
+        !directory.ReadVarint(&nodes_count)) {
+      return nullptr;
+    }
+    // Every node takes at least one byte.
+    if (offset < sizeof(kBinaryMagic) || offset > names_offset ||
+        size > names_offset - offset || nodes_count > size) {
+      return nullptr;
+    }
+    entry.nodes = data.substr(offset, size);
+    entry.nodes_count = nodes_count;
+  }
+  return result;
+}
+
+std::unique_ptr<INode> BinaryImage::Load(size_t indx,
+                                         VariableScope* scope) const {
+  if (indx >= expressions_.size())
+    return nullptr;
+  const Entry& entry = expressions_[indx];
+  Reader reader(entry.nodes);
+  std::vector<std::unique_ptr<INode>> stack;
+  stack.reserve(16);
+  std::unordered_map<uint64_t, Variable*> variables;
+
+  auto take = [&stack](size_t count) {
+    std::vector<std::unique_ptr<INode>> values;
+    values.reserve(count);
+    for (size_t i = stack.size() - count; i < stack.size(); ++i)
+      values.push_back(std::move(stack[i]));
+    stack.resize(stack.size() - count);
+    return values;
+  };
+  auto read_name = [this, &reader](std::string_view* name) {
+    uint64_t name_indx;
+    if (!reader.ReadVarint(&name_indx) || name_indx >= names_.size())
+      return false;
+    *name = names_[name_indx];
+    return true;
+  };
+
+  for (size_t nodes_count = 0; !reader.AtEnd(); ++nodes_count) {
+    if (nodes_count == entry.nodes_count)
+      return nullptr;
+    uint8_t tag;
+    reader.ReadByte(&tag);
+    if (tag > static_cast<uint8_t>(BinaryTag::Last))
+      return nullptr;
+    std::unique_ptr<INode> node;
+    std::string_view name;
+    double value;
+    uint64_t count;
+    uint8_t byte;
+    switch (static_cast<BinaryTag>(tag)) {
+      case BinaryTag::Number:
+        if (!reader.ReadDouble(&value))
+          return nullptr;
+        node = INodeHelper::MakeConst(value);
+        break;
+      case BinaryTag::Integer:
+        if (!reader.ReadVarint(&count))
+          return nullptr;
+        node = INodeHelper::MakeConst(
+            static_cast<double>(static_cast<int64_t>(count >> 1) ^
+                                -static_cast<int64_t>(count & 1)));
+        break;
+      case BinaryTag::NamedConstant:
+        if (!read_name(&name) || !reader.ReadDouble(&value))
+          return nullptr;
+        node = INodeHelper::MakeConst(value, FromUtf8(name));
+        break;
+      case BinaryTag::False:
+      case BinaryTag::True:
+        node = INodeHelper::MakeConst(tag ==
+                                      static_cast<uint8_t>(BinaryTag::True));
+        break;
+      case BinaryTag::Variable: {
+        if (!reader.ReadVarint(&count) || count >= names_.size())
+          return nullptr;
+        Variable*& var = variables[count];
+        if (!var)
+          var = scope->Get(FromUtf8(names_[count]));
+        node = std::make_unique<VariableRef>(var);
+        break;
+      }
+      case BinaryTag::Imaginary:
+        node = INodeHelper::MakeImaginary();
+        break;
+      case BinaryTag::Error:
+        if (!read_name(&name))
+          return nullptr;
+        node = INodeHelper::MakeError(FromUtf8(name));
+        break;
+      case BinaryTag::Operation: {
+        if (!reader.ReadByte(&byte) ||
+            byte > static_cast<uint8_t>(Op::Diff) ||
+            !reader.ReadVarint(&count) || count > stack.size()) {
+          return nullptr;
+        }
+        const OpInfo* op_info = GetOpInfo(static_cast<Op>(byte));
+        if (op_info->operands_count < 0 ? count < 2
+                                        : count != static_cast<uint64_t>(
+                                                       op_info->operands_count))
+          return nullptr;
+        node = MakeOperation(op_info->op, take(count));
+        if (!node)
+          return nullptr;
+        break;
+      }
+      case BinaryTag::Vector:
+        if (!reader.ReadVarint(&count) || count > stack.size())
+          return nullptr;
+        node = INodeHelper::MakeVector(take(count));
+        break;
+      case BinaryTag::Sequence: {
+        if (!reader.ReadVarint(&count) || count > stack.size())
+          return nullptr;
+        auto sequence = INodeHelper::MakeSequence();
+        for (auto& value : take(count))
+          sequence->AddValue(std::move(value));
+        node = std::move(sequence);
+        break;
+      }
+      case BinaryTag::Brackets:
+        if (!reader.ReadByte(&byte) ||
+            byte > static_cast<uint8_t>(BracketType::Sqrt) || stack.empty()) {
+          return nullptr;
+        }
+        node = INodeHelper::MakeBrackets(static_cast<BracketType>(byte),
+                                         std::move(stack.back()));
+        stack.pop_back();
+        break;
+    }
+    stack.push_back(std::move(node));
+  }
+  if (stack.size() != 1)
+    return nullptr;
+  return std::move(stack.back());
+}
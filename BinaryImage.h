@@ -0,0 +1,41 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+class INode;
+class VariableScope;
+
+// Read access to an image written by BinaryWriter. The image is not copied:
+// Open() checks the footer and reads the directory and the names, and every
+// Load() decodes one expression straight from |data|, which must outlive the
+// BinaryImage. Malformed data makes Open() or Load() return nullptr.
+class BinaryImage {
+ public:
+  BinaryImage(const BinaryImage&) = delete;
+  ~BinaryImage();
+
+  static std::unique_ptr<BinaryImage> Open(std::string_view data);
+
+  size_t Size() const { return expressions_.size(); }
+  size_t NodesCount(size_t indx) const {
+    return expressions_[indx].nodes_count;
+  }
+  // Variables are taken from |scope| by name.
+  std::unique_ptr<INode> Load(size_t indx, VariableScope* scope) const;
+
+ private:
+  struct Entry {
+    std::string_view nodes;
+    size_t nodes_count;
+  };
+
+  BinaryImage();
+
+  std::vector<Entry> expressions_;
+  // UTF-8 names, pointing into the image.
+  std::vector<std::string_view> names_;
+};
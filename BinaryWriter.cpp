@@ -0,0 +1,190 @@
+#include "BinaryWriter.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "AbstractSequence.h"
+#include "BinaryFormat.h"
+#include "Brackets.h"
+#include "Constant.h"
+#include "ErrorNode.h"
+#include "Operation.h"
+#include "SharedNode.h"
+#include "Utf8.h"
+#include "Variable.h"
+#include "VariableRef.h"
+
+namespace {
+void WriteTag(BinaryTag tag, std::string* out) {
+  out->push_back(static_cast<char>(tag));
+}
+
+// Integers are exact in a double up to 2^53, -0 keeps its sign as a Number.
+bool IsSmallInteger(double value) {
+  return value >= -9007199254740992.0 && value <= 9007199254740992.0 &&
+         value == std::trunc(value) && !(value == 0 && std::signbit(value));
+}
+
+void WriteDouble(double value, std::string* out) {
+  char bytes[sizeof(value)];
+  std::memcpy(bytes, &value, sizeof(value));
+  out->append(bytes, sizeof(bytes));
+}
+
+void WriteUint64(uint64_t value, std::string* out) {
+  char bytes[sizeof(value)];
+  std::memcpy(bytes, &value, sizeof(value));
+  out->append(bytes, sizeof(bytes));
+}
+}  // namespace
+
+BinaryWriter::BinaryWriter() {
+  nodes_.append(kBinaryMagic, sizeof(kBinaryMagic));
+}
+
+BinaryWriter::~BinaryWriter() {}
+
+size_t BinaryWriter::Add(const INode* node) {
+  return AddImpl(node->AsNodeImpl());
+}
+
+size_t BinaryWriter::Add(const Variable& var) {
+  if (var.GetValue())
+    return AddImpl(var.GetValue()->AsNodeImpl());
+  VariableRef ref(&var);
+  return AddImpl(&ref);
+}
+
+std::string BinaryWriter::Image() const {
+  std::string image = nodes_;
+  uint64_t names_offset = image.size();
+  WriteVarint(names_.size(), &image);
+  for (const auto& name : names_) {
+    std::string utf8 = ToUtf8(name);
+    WriteVarint(utf8.size(), &image);
+    image += utf8;
+  }
+  uint64_t directory_offset = image.size();
+  WriteVarint(expressions_.size(), &image);
+  for (const Entry& entry : expressions_) {
+    WriteVarint(entry.offset, &image);
+    WriteVarint(entry.size, &image);
+    WriteVarint(entry.nodes_count, &image);
+  }
+  WriteUint64(names_offset, &image);
+  WriteUint64(directory_offset, &image);
+  image.append(kBinaryMagic, sizeof(kBinaryMagic));
+  return image;
+}
+
+size_t BinaryWriter::AddImpl(const INodeImpl* root) {
+  Entry entry = {nodes_.size(), 0, 0};
+  // Operands are written before the node, the tree is walked with an
+  // explicit stack so deep trees do not exhaust the call stack.
+  struct Frame {
+    const INodeImpl* node;
+    bool operands_written;
+  };
+  std::vector<Frame> stack = {{root, false}};
+  while (!stack.empty()) {
+    Frame frame = stack.back();
+    stack.pop_back();
+    const INodeImpl* node = frame.node;
+    if (frame.operands_written) {
+      WriteNode(node);
+      ++entry.nodes_count;
+      continue;
+    }
+    for (;;) {
+      if (const SharedNode* shared = node->AsSharedNode()) {
+        node = shared->Target();
+      } else if (const Variable* var = node->AsVariable()) {
+        if (!var->GetSymbol().IsEmpty() || !var->GetValue())
+          break;
+        node = var->GetValue()->AsNodeImpl();
+      } else {
+        break;
+      }
+    }
+    stack.push_back({node, true});
+    if (const Operation* operation = node->AsOperation()) {
+      for (size_t i = operation->OperandsCount(); i-- > 0;)
+        stack.push_back({operation->Operand(i), false});
+    } else if (node->AsVariable() || node->AsConstant()) {
+      // Leaves; checked first as they forward the other casts.
+    } else if (const AbstractSequence* sequence = node->AsAbstractSequence()) {
+      for (size_t i = sequence->Size(); i-- > 0;)
+        stack.push_back({sequence->Value(i)->AsNodeImpl(), false});
+    } else if (const Brackets* brackets = node->AsBrackets()) {
+      stack.push_back({brackets->Value(), false});
+    }
+  }
+  entry.size = nodes_.size() - entry.offset;
+  expressions_.push_back(entry);
+  return expressions_.size() - 1;
+}
+
+void BinaryWriter::WriteNode(const INodeImpl* node) {
+  if (const Operation* operation = node->AsOperation()) {
+    WriteTag(BinaryTag::Operation, &nodes_);
+    nodes_.push_back(static_cast<char>(operation->op()));
+    WriteVarint(operation->OperandsCount(), &nodes_);
+  } else if (const Constant* constant = node->AsConstant()) {
+    if (constant->IsNamed()) {
+      WriteTag(BinaryTag::NamedConstant, &nodes_);
+      WriteVarint(NameIndex(constant->Name()), &nodes_);
+      WriteDouble(constant->Value(), &nodes_);
+    } else if (constant->IsBool()) {
+      WriteTag(constant->Value() != 0.0 ? BinaryTag::True : BinaryTag::False,
+               &nodes_);
+    } else if (IsSmallInteger(constant->Value())) {
+      WriteTag(BinaryTag::Integer, &nodes_);
+      int64_t value = static_cast<int64_t>(constant->Value());
+      WriteVarint((static_cast<uint64_t>(value) << 1) ^ (value < 0 ? ~0ull : 0),
+                  &nodes_);
+    } else {
+      WriteTag(BinaryTag::Number, &nodes_);
+      WriteDouble(constant->Value(), &nodes_);
+    }
+  } else if (const Variable* var = node->AsVariable()) {
+    if (var->GetSymbol().IsEmpty()) {
+      // A variable without name and value.
+      WriteTag(BinaryTag::Error, &nodes_);
+      WriteVarint(NameIndex(std::wstring()), &nodes_);
+    } else {
+      WriteTag(BinaryTag::Variable, &nodes_);
+      WriteVarint(NameIndex(var->GetName()), &nodes_);
+    }
+  } else if (node->AsImaginary()) {
+    WriteTag(BinaryTag::Imaginary, &nodes_);
+  } else if (const ErrorNode* error = node->AsError()) {
+    WriteTag(BinaryTag::Error, &nodes_);
+    WriteVarint(NameIndex(error->Error()), &nodes_);
+  } else if (const AbstractSequence* sequence = node->AsAbstractSequence()) {
+    WriteTag(node->AsVector() ? BinaryTag::Vector : BinaryTag::Sequence,
+             &nodes_);
+    WriteVarint(sequence->Size(), &nodes_);
+  } else if (const Brackets* brackets = node->AsBrackets()) {
+    WriteTag(BinaryTag::Brackets, &nodes_);
+    nodes_.push_back(static_cast<char>(brackets->GetBracketType()));
+  }
+}
+
+uint32_t BinaryWriter::NameIndex(const std::wstring& name) {
+  auto it = name_indices_.find(name);
+  if (it != name_indices_.end())
+    return it->second;
+  names_.push_back(name);
+  uint32_t indx = static_cast<uint32_t>(names_.size() - 1);
+  name_indices_.emplace(name, indx);
+  return indx;
+}
+
+// static
+void BinaryWriter::WriteVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class INode;
+class INodeImpl;
+class Variable;
+
+// Collects expressions into one binary image, see BinaryFormat.h. Shared
+// subtrees are written out in full and variables are stored by name.
+class BinaryWriter {
+ public:
+  BinaryWriter();
+  BinaryWriter(const BinaryWriter&) = delete;
+  ~BinaryWriter();
+
+  // Returns the index of the expression in the image.
+  size_t Add(const INode* node);
+  // Writes the value of |var|.
+  size_t Add(const Variable& var);
+
+  std::string Image() const;
+
+ private:
+  struct Entry {
+    size_t offset;
+    size_t size;
+    size_t nodes_count;
+  };
+
+  size_t AddImpl(const INodeImpl* root);
+  void WriteNode(const INodeImpl* node);
+  uint32_t NameIndex(const std::wstring& name);
+  static void WriteVarint(uint64_t value, std::string* out);
+
+  // Node streams of all expressions, following the magic.
+  std::string nodes_;
+  std::vector<Entry> expressions_;
+  std::vector<std::wstring> names_;
+  std::unordered_map<std::wstring, uint32_t> name_indices_;
+};
@@ -49,10 +49,23 @@ std::unique_ptr<INode> Brackets::Clone() const {
   return std::make_unique<Brackets>(bracket_type_, value_->Clone());
 }
 
-PrintSize Brackets::Render(Canvas* canvas,
-                           PrintBox print_box,
-                           bool dry_run,
-                           RenderBehaviour render_behaviour) const {
+void Brackets::CollectFreeVariables(SymbolSet* result) const {
+  result->InsertAll(ChildFreeVariables(value_.get()));
+}
+
+void Brackets::ForgetChildren() const {
+  ForgetChild(value_.get());
+}
+
+bool Brackets::TrackLayout() const {
+  // The hash leaves the value out, like Compare().
+  return INodeImpl::TrackLayout() && TrackChild(value_.get());
+}
+
+PrintSize Brackets::RenderImpl(Canvas* canvas,
+                               PrintBox print_box,
+                               bool dry_run,
+                               RenderBehaviour render_behaviour) const {
   return print_size_ =
              RenderBrackets(value_->AsNodeImpl(), bracket_type_, canvas,
                             std::move(print_box), dry_run, render_behaviour);
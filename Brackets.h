@@ -31,10 +31,10 @@ class Brackets : public INodeImpl {
 
   // INodeImpl implementation
   NodeType GetNodeType() const override { return NodeType::Brackets; }
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   PrintSize LastPrintSize() const override;
   int Priority() const override { return 1000; }
   bool HasFrontMinus() const override { return false; }
@@ -56,6 +56,12 @@ class Brackets : public INodeImpl {
 
   INodeImpl* Value();
   const INodeImpl* Value() const;
+  BracketType GetBracketType() const { return bracket_type_; }
+
+ protected:
+  void CollectFreeVariables(SymbolSet* result) const override;
+  void ForgetChildren() const override;
+  bool TrackLayout() const override;
 
  private:
   mutable PrintSize print_size_;
@@ -82,7 +82,8 @@ PrintBox& PrintBox::operator=(const PrintBox& rh) = default;
 PrintBox& PrintBox::operator=(PrintBox&& rh) noexcept = default;
 
 PrintBox PrintBox ::Infinite() {
-  return PrintBox(0, 0, 1000, 10000, 0);
+  // Large enough for any expression, far enough from overflow for offsets.
+  return PrintBox(0, 0, 0x3FFFFFFF, 0x3FFFFFFF, 0);
 }
 
 PrintBox PrintBox::ShrinkTop(uint32_t delta_height) const {
@@ -150,11 +151,20 @@ PrintSize PrintSize::GrowDown(const PrintSize& other,
 //=============================================================================
 
 void Canvas::Resize(const PrintSize& print_size) {
+  SetBand(print_size, 0, print_size.height);
+}
+
+void Canvas::SetBand(const PrintSize& print_size,
+                     uint32_t first_row,
+                     uint32_t rows) {
+  assert(first_row + rows <= print_size.height);
   print_size_ = print_size;
-  uint32_t new_size = (print_size.width + 1) * print_size.height;
+  first_row_ = first_row;
+  rows_ = rows;
+  uint32_t new_size = (print_size.width + 1) * rows;
   data_.resize(static_cast<size_t>(new_size));
   std::fill(std::begin(data_), std::end(data_), ' ');
-  for (uint32_t row = 0; row < print_size.height; ++row) {
+  for (uint32_t row = first_row; row < first_row + rows; ++row) {
     data_[GetIndex(print_size.width - 1, row) + 1] = '\n';
   }
 }
@@ -179,6 +189,8 @@ PrintSize Canvas::PrintAt(const PrintBox& print_box,
   if (!dry_run) {
     assert(print_size_ != PrintSize{});
     assert(print_box.x + str.size() <= print_size_.width);
+  }
+  if (!dry_run && IsInBand(print_box.base_line)) {
     size_t indx = GetIndex(print_box.x, print_box.base_line);
     auto data_start = std::begin(data_) + indx;
     for (size_t i = 0; i < str.size(); ++i)
@@ -279,9 +291,11 @@ PrintSize Canvas::RenderBracketLR(const PrintBox& print_box,
   if (height == 1 && bracket_type != BracketType::Sqrt) {
     if (!dry_run) {
       uint32_t y = print_box.base_line - height / 2;
-      data_[GetIndex(print_box.x, y)] =
-          (side == BracketSide::Left ? brackets[BracketsParts::SmallLeft]
-                                     : brackets[BracketsParts::SmallRight]);
+      if (IsInBand(y)) {
+        data_[GetIndex(print_box.x, y)] =
+            (side == BracketSide::Left ? brackets[BracketsParts::SmallLeft]
+                                       : brackets[BracketsParts::SmallRight]);
+      }
     }
     return {1, 1, 0};
   }
@@ -313,9 +327,11 @@ PrintSize Canvas::RenderBracketLR(const PrintBox& print_box,
         s = side == BracketSide::Left ? brackets[BracketsParts::StrightLeft]
                                       : brackets[BracketsParts::StrightRight];
       }
-      data_[GetIndex(print_box.x + width - 1, y + i)] = s;
+      if (IsInBand(y + i))
+        data_[GetIndex(print_box.x + width - 1, y + i)] = s;
     }
-    if (bracket_type == BracketType::Sqrt && side == BracketSide::Left) {
+    if (bracket_type == BracketType::Sqrt && side == BracketSide::Left &&
+        IsInBand(y + height - 1)) {
       data_[GetIndex(print_box.x + width - 2, y + height - 1)] =
           brackets[BracketsParts::AdditionalBottomLeft];
     }
@@ -348,7 +364,11 @@ void Canvas::SetDryRun(bool dry_run) {
 size_t Canvas::GetIndex(uint32_t x, uint32_t y) const {
   assert(print_size_ != PrintSize{});
   assert(x < print_size_.width);
-  assert(y < print_size_.height);
-  uint32_t indx = y * (print_size_.width + 1) + x;
+  assert(IsInBand(y));
+  uint32_t indx = (y - first_row_) * (print_size_.width + 1) + x;
   return static_cast<size_t>(indx);
+}
+
+bool Canvas::IsInBand(uint32_t y) const {
+  return y >= first_row_ && y < first_row_ + rows_;
 }
\ No newline at end of file
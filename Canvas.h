@@ -52,6 +52,10 @@ struct PrintBox {
 class Canvas {
  public:
   void Resize(const PrintSize& print_size);
+  // Keeps only |rows| rows starting at |first_row| of a |print_size| canvas,
+  // drawing outside of them is dropped.
+  void SetBand(const PrintSize& print_size, uint32_t first_row, uint32_t rows);
+  // The rows of the current band.
   const std::wstring& ToString() const;
 
   PrintSize PrintAt(const PrintBox& print_box,
@@ -82,6 +86,7 @@ class Canvas {
     Top,
   };
   size_t GetIndex(uint32_t x, uint32_t y) const;
+  bool IsInBand(uint32_t y) const;
   PrintSize RenderBracket(const PrintBox& print_box,
                           BracketSide side,
                           BracketType bracket_type,
@@ -100,5 +105,7 @@ class Canvas {
 
   bool dry_run_ = false;
   PrintSize print_size_;
+  uint32_t first_row_ = 0;
+  uint32_t rows_ = 0;
   std::wstring data_;
 };
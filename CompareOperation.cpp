@@ -39,10 +39,10 @@ std::unique_ptr<INode> CompareOperation::Clone() const {
                                   Operand(1)->Clone());
 }
 
-PrintSize CompareOperation::Render(Canvas* canvas,
-                                   PrintBox print_box,
-                                   bool dry_run,
-                                   RenderBehaviour render_behaviour) const {
+PrintSize CompareOperation::RenderImpl(Canvas* canvas,
+                                       PrintBox print_box,
+                                       bool dry_run,
+                                       RenderBehaviour render_behaviour) const {
   return print_size_ =
              RenderOperandChain(canvas, print_box, dry_run, render_behaviour);
 }
\ No newline at end of file
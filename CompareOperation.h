@@ -14,10 +14,10 @@ class CompareOperation : public Operation {
   std::unique_ptr<INode> Clone() const override;
 
   // INodeImpl interface
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   bool HasFrontMinus() const override { return false; }
 
   // IOperation implementation
@@ -0,0 +1,782 @@
+#include "CompiledExpression.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <map>
+
+#include "Brackets.h"
+#include "Constant.h"
+#include "INodeImpl.h"
+#include "LogOperation.h"
+#include "Operation.h"
+#include "SqrtOperation.h"
+#include "Variable.h"
+#include "Vector.h"
+
+namespace {
+// Slots are numbered per kind while compiling and relocated to one register
+// file [variables | constants | temporaries] at the end.
+constexpr uint32_t kConstBase = 1u << 30;
+constexpr uint32_t kTempBase = 1u << 31;
+constexpr double kE = 2.71828182845904523536;
+
+std::complex<double> ComplexSqrt(std::complex<double> lh, double rh) {
+  if (rh == 2.0)
+    return std::sqrt(lh);
+  return std::pow(lh, 1.0 / rh);
+}
+
+std::complex<double> ComplexLog(std::complex<double> lh,
+                                std::complex<double> rh) {
+  if (lh == kE)
+    return std::log(rh);
+  if (lh == 10.0)
+    return std::log10(rh);
+  return std::log(rh) / std::log(lh);
+}
+
+// Derivatives follow the cases of DoDiffOperation(), a zero tangent stands
+// for an operand that does not depend on the direction.
+double PowDerivative(double f, double g, double value, double df, double dg) {
+  if (df == 0.0 && dg == 0.0)
+    return 0.0;
+  if (df == 0.0)
+    return dg * value * std::log(f);
+  if (dg == 0.0)
+    return df * g * std::pow(f, g - 1.0);
+  return std::pow(f, g - 1.0) * (g * df + f * std::log(f) * dg);
+}
+
+double SqrtDerivative(double f, double g, double value, double df, double dg) {
+  if (df == 0.0 && dg == 0.0)
+    return 0.0;
+  if (df == 0.0)
+    return -(std::log(f) * value * dg) / (g * g);
+  if (dg == 0.0)
+    return df / (g * TrivialSqrt(std::pow(f, g - 1.0), g));
+  return std::pow(f, 1.0 / g - 1.0) * (g * df - f * std::log(f) * dg) /
+         (g * g);
+}
+
+double EvaluateOp(Op op, double lh, double rh) {
+  switch (op) {
+    case Op::UnMinus:
+      return -lh;
+    case Op::Minus:
+      return lh - rh;
+    case Op::Plus:
+      return lh + rh;
+    case Op::Mult:
+      return lh * rh;
+    case Op::Div:
+      return lh / rh;
+    case Op::Pow:
+      return std::pow(lh, rh);
+    case Op::Sqrt:
+      return TrivialSqrt(lh, rh);
+    case Op::Sin:
+      return std::sin(lh);
+    case Op::Cos:
+      return std::cos(lh);
+    case Op::Log:
+      return TrivialLogCalc(lh, rh);
+    default:
+      assert(false);
+      return NAN;
+  }
+}
+
+// d log_b f = df/(f ln b) - d_base ln f/(b ln^2 b)
+double LogDerivative(double base, double f, double d_base, double df) {
+  double log_base = std::log(base);
+  double result = df == 0.0 ? 0.0 : df / (f * log_base);
+  if (d_base != 0.0)
+    result -= d_base * std::log(f) / (base * log_base * log_base);
+  return result;
+}
+}  // namespace
+
+struct CompiledExpression::CompileState {
+  uint32_t AddConst(std::complex<double> value) {
+    auto it = const_slots.find({value.real(), value.imag()});
+    if (it != const_slots.end())
+      return it->second;
+    uint32_t slot = kConstBase + static_cast<uint32_t>(constants.size());
+    constants.push_back(value);
+    const_slots.emplace(std::make_pair(value.real(), value.imag()), slot);
+    return slot;
+  }
+
+  uint32_t Emit(std::vector<Instruction>* code,
+                Op op,
+                uint32_t lh,
+                uint32_t rh) {
+    bool lh_active = IsActive(lh);
+    bool rh_active = IsActive(rh);
+    Release(lh);
+    if (rh != lh)
+      Release(rh);
+    uint32_t dst;
+    if (free_temps.empty()) {
+      dst = kTempBase + temps_count++;
+      active_temps.push_back(false);
+    } else {
+      dst = free_temps.back();
+      free_temps.pop_back();
+    }
+    active_temps[dst - kTempBase] = lh_active || rh_active;
+    code->push_back({op, dst, lh, rh, lh_active, rh_active});
+    return dst;
+  }
+
+  // Keeps |slot| allocated for |uses| more operands than one.
+  void Retain(uint32_t slot, size_t uses) {
+    if (slot >= kTempBase)
+      extra_uses[slot] += uses;
+  }
+
+  void Release(uint32_t slot) {
+    if (slot < kTempBase)
+      return;
+    auto it = extra_uses.find(slot);
+    if (it != extra_uses.end() && it->second > 0) {
+      --it->second;
+      return;
+    }
+    free_temps.push_back(slot);
+  }
+
+  bool IsActive(uint32_t slot) const {
+    if (slot >= kTempBase)
+      return active_temps[slot - kTempBase];
+    return slot < kConstBase;
+  }
+
+  std::vector<std::complex<double>> constants;
+  std::map<std::pair<double, double>, uint32_t> const_slots;
+  std::vector<uint32_t> free_temps;
+  std::map<uint32_t, size_t> extra_uses;
+  std::vector<bool> active_temps;
+  uint32_t temps_count = 0;
+};
+
+CompiledExpression::CompiledExpression() {}
+
+// static
+std::unique_ptr<CompiledExpression> CompiledExpression::Compile(
+    const INode* node,
+    std::vector<Symbol> variables) {
+  std::unique_ptr<CompiledExpression> result(new CompiledExpression());
+  result->variables_ = std::move(variables);
+  CompileState state;
+  auto result_slot = result->CompileNode(node, &state);
+  if (!result_slot)
+    return nullptr;
+
+  uint32_t const_offset = static_cast<uint32_t>(result->variables_.size());
+  uint32_t temp_offset =
+      const_offset + static_cast<uint32_t>(state.constants.size());
+  auto relocate = [const_offset, temp_offset](uint32_t slot) {
+    if (slot >= kTempBase)
+      return slot - kTempBase + temp_offset;
+    if (slot >= kConstBase)
+      return slot - kConstBase + const_offset;
+    return slot;
+  };
+  for (auto& instruction : result->code_) {
+    instruction.dst = relocate(instruction.dst);
+    instruction.lh = relocate(instruction.lh);
+    instruction.rh = relocate(instruction.rh);
+  }
+  result->result_ = relocate(*result_slot);
+  result->temps_offset_ = temp_offset;
+
+  size_t registers_count = temp_offset + state.temps_count;
+  result->registers_.resize(registers_count);
+  result->complex_registers_.resize(registers_count);
+  for (size_t i = 0; i < state.constants.size(); ++i) {
+    result->registers_[const_offset + i] = state.constants[i].real();
+    result->complex_registers_[const_offset + i] = state.constants[i];
+  }
+  return result;
+}
+
+double CompiledExpression::Evaluate(double* r) const {
+  assert(!is_complex_);
+  for (const Instruction& instruction : code_) {
+    r[instruction.dst] =
+        EvaluateOp(instruction.op, r[instruction.lh], r[instruction.rh]);
+  }
+  return r[result_];
+}
+
+std::complex<double> CompiledExpression::EvaluateComplex(
+    std::complex<double>* r) const {
+  for (const Instruction& instruction : code_) {
+    std::complex<double> lh = r[instruction.lh];
+    std::complex<double> rh = r[instruction.rh];
+    std::complex<double> result;
+    switch (instruction.op) {
+      case Op::UnMinus:
+        result = -lh;
+        break;
+      case Op::Minus:
+        result = lh - rh;
+        break;
+      case Op::Plus:
+        result = lh + rh;
+        break;
+      case Op::Mult:
+        result = lh * rh;
+        break;
+      case Op::Div:
+        result = lh / rh;
+        break;
+      case Op::Pow:
+        result = std::pow(lh, rh);
+        break;
+      case Op::Sqrt:
+        result = ComplexSqrt(lh, rh.real());
+        break;
+      case Op::Sin:
+        result = std::sin(lh);
+        break;
+      case Op::Cos:
+        result = std::cos(lh);
+        break;
+      case Op::Log:
+        result = ComplexLog(lh, rh);
+        break;
+      default:
+        assert(false);
+        result = NAN;
+    }
+    r[instruction.dst] = result;
+  }
+  return r[result_];
+}
+
+double CompiledExpression::EvaluateTangents(double* r,
+                                            double* t,
+                                            size_t directions) const {
+  assert(!is_complex_);
+  for (const Instruction& instruction : code_) {
+    double lh = r[instruction.lh];
+    double rh = r[instruction.rh];
+    // |d_dst| may alias an operand row, every direction reads before writing.
+    const double* d_lh = t + instruction.lh * directions;
+    const double* d_rh = t + instruction.rh * directions;
+    double* d_dst = t + instruction.dst * directions;
+    double result;
+    switch (instruction.op) {
+      case Op::UnMinus:
+        result = -lh;
+        for (size_t k = 0; k < directions; ++k)
+          d_dst[k] = -d_lh[k];
+        break;
+      case Op::Minus:
+        result = lh - rh;
+        for (size_t k = 0; k < directions; ++k)
+          d_dst[k] = d_lh[k] - d_rh[k];
+        break;
+      case Op::Plus:
+        result = lh + rh;
+        for (size_t k = 0; k < directions; ++k)
+          d_dst[k] = d_lh[k] + d_rh[k];
+        break;
+      case Op::Mult:
+        result = lh * rh;
+        for (size_t k = 0; k < directions; ++k)
+          d_dst[k] = d_lh[k] * rh + lh * d_rh[k];
+        break;
+      case Op::Div:
+        result = lh / rh;
+        for (size_t k = 0; k < directions; ++k)
+          d_dst[k] = (d_lh[k] * rh - lh * d_rh[k]) / (rh * rh);
+        break;
+      case Op::Pow:
+        result = std::pow(lh, rh);
+        for (size_t k = 0; k < directions; ++k)
+          d_dst[k] = PowDerivative(lh, rh, result, d_lh[k], d_rh[k]);
+        break;
+      case Op::Sqrt:
+        result = TrivialSqrt(lh, rh);
+        for (size_t k = 0; k < directions; ++k)
+          d_dst[k] = SqrtDerivative(lh, rh, result, d_lh[k], d_rh[k]);
+        break;
+      case Op::Sin: {
+        result = std::sin(lh);
+        double cos_lh = std::cos(lh);
+        for (size_t k = 0; k < directions; ++k)
+          d_dst[k] = d_lh[k] * cos_lh;
+        break;
+      }
+      case Op::Cos: {
+        result = std::cos(lh);
+        double sin_lh = std::sin(lh);
+        for (size_t k = 0; k < directions; ++k)
+          d_dst[k] = -d_lh[k] * sin_lh;
+        break;
+      }
+      case Op::Log:
+        result = TrivialLogCalc(lh, rh);
+        for (size_t k = 0; k < directions; ++k)
+          d_dst[k] = LogDerivative(lh, rh, d_lh[k], d_rh[k]);
+        break;
+      default:
+        assert(false);
+        result = NAN;
+    }
+    r[instruction.dst] = result;
+  }
+  return r[result_];
+}
+
+double CompiledExpression::EvaluateAdjoints(double* r,
+                                            double* tape,
+                                            double* a) const {
+  assert(!is_complex_);
+  double* record = tape;
+  for (const Instruction& instruction : code_) {
+    record[0] = r[instruction.lh];
+    record[1] = r[instruction.rh];
+    record[2] = EvaluateOp(instruction.op, record[0], record[1]);
+    r[instruction.dst] = record[2];
+    record += 3;
+  }
+  double result = r[result_];
+
+  a[result_] = 1.0;
+  for (size_t i = code_.size(); i-- > 0;) {
+    const Instruction& instruction = code_[i];
+    double f = tape[i * 3];
+    double g = tape[i * 3 + 1];
+    double value = tape[i * 3 + 2];
+    // |dst| may alias an operand, its adjoint is taken before accumulating.
+    double adjoint = a[instruction.dst];
+    a[instruction.dst] = 0.0;
+    bool lh_active = instruction.lh_active;
+    bool rh_active = instruction.rh_active;
+    double d_lh = 0.0;
+    double d_rh = 0.0;
+    switch (instruction.op) {
+      case Op::UnMinus:
+        d_lh = -adjoint;
+        rh_active = false;
+        break;
+      case Op::Minus:
+        d_lh = adjoint;
+        d_rh = -adjoint;
+        break;
+      case Op::Plus:
+        d_lh = adjoint;
+        d_rh = adjoint;
+        break;
+      case Op::Mult:
+        d_lh = adjoint * g;
+        d_rh = adjoint * f;
+        break;
+      case Op::Div:
+        d_lh = adjoint / g;
+        d_rh = -adjoint * f / (g * g);
+        break;
+      case Op::Pow:
+        if (lh_active && rh_active) {
+          double common = adjoint * std::pow(f, g - 1.0);
+          d_lh = common * g;
+          d_rh = common * f * std::log(f);
+        } else if (lh_active) {
+          d_lh = adjoint * g * std::pow(f, g - 1.0);
+        } else if (rh_active) {
+          d_rh = adjoint * value * std::log(f);
+        }
+        break;
+      case Op::Sqrt:
+        if (lh_active && rh_active) {
+          double common = adjoint * std::pow(f, 1.0 / g - 1.0) / (g * g);
+          d_lh = common * g;
+          d_rh = -common * f * std::log(f);
+        } else if (lh_active) {
+          d_lh = adjoint / (g * TrivialSqrt(std::pow(f, g - 1.0), g));
+        } else if (rh_active) {
+          d_rh = -adjoint * std::log(f) * value / (g * g);
+        }
+        break;
+      case Op::Sin:
+        d_lh = adjoint * std::cos(f);
+        rh_active = false;
+        break;
+      case Op::Cos:
+        d_lh = -adjoint * std::sin(f);
+        rh_active = false;
+        break;
+      case Op::Log: {
+        double log_base = std::log(f);
+        d_lh = -adjoint * std::log(g) / (f * log_base * log_base);
+        d_rh = adjoint / (g * log_base);
+        break;
+      }
+      default:
+        assert(false);
+        d_lh = NAN;
+        d_rh = NAN;
+    }
+    if (lh_active)
+      a[instruction.lh] += d_lh;
+    if (rh_active)
+      a[instruction.rh] += d_rh;
+  }
+  return result;
+}
+
+void CompiledExpression::EvaluateBatchBlock(const BatchKernels& kernels,
+                                            double* registers,
+                                            size_t count) const {
+  for (const Instruction& instruction : code_) {
+    const double* lh = registers + instruction.lh * kBatchBlock;
+    const double* rh = registers + instruction.rh * kBatchBlock;
+    double* dst = registers + instruction.dst * kBatchBlock;
+    switch (instruction.op) {
+      case Op::UnMinus:
+        kernels.un_minus(lh, dst, count);
+        break;
+      case Op::Minus:
+        kernels.minus(lh, rh, dst, count);
+        break;
+      case Op::Plus:
+        kernels.plus(lh, rh, dst, count);
+        break;
+      case Op::Mult:
+        kernels.mult(lh, rh, dst, count);
+        break;
+      case Op::Div:
+        kernels.div(lh, rh, dst, count);
+        break;
+      case Op::Pow: {
+        double exp = rh[0];
+        if (IsConstSlot(instruction.rh) && exp == std::trunc(exp) &&
+            std::abs(exp) <= BatchKernels::kMaxPowInt) {
+          kernels.pow_int(lh, static_cast<int>(exp), dst, count);
+        } else if (IsConstSlot(instruction.rh) && exp == 0.5) {
+          kernels.sqrt(lh, dst, count);
+          // std::pow gives +0 for -0 and +inf for -inf, where sqrt doesn't.
+          for (size_t i = 0; i < count; ++i) {
+            if (!(lh[i] > 0))
+              dst[i] = std::pow(lh[i], 0.5);
+          }
+        } else {
+          for (size_t i = 0; i < count; ++i)
+            dst[i] = std::pow(lh[i], rh[i]);
+        }
+        break;
+      }
+      case Op::Sqrt:
+        if (IsConstSlot(instruction.rh) && rh[0] == 2.0) {
+          kernels.sqrt(lh, dst, count);
+        } else {
+          for (size_t i = 0; i < count; ++i)
+            dst[i] = TrivialSqrt(lh[i], rh[i]);
+        }
+        break;
+      case Op::Sin:
+        kernels.sin(lh, dst, count);
+        break;
+      case Op::Cos:
+        kernels.cos(lh, dst, count);
+        break;
+      case Op::Log:
+        if (IsConstSlot(instruction.lh)) {
+          double base = lh[0];
+          kernels.log(rh, dst, count);
+          if (base != kE) {
+            double scale = 1.0 / std::log(base);
+            for (size_t i = 0; i < count; ++i)
+              dst[i] *= scale;
+          }
+        } else {
+          for (size_t i = 0; i < count; ++i)
+            dst[i] = TrivialLogCalc(lh[i], rh[i]);
+        }
+        break;
+      default:
+        assert(false);
+        std::fill_n(dst, count, NAN);
+    }
+  }
+}
+
+bool CompiledExpression::IsConstSlot(uint32_t slot) const {
+  return slot >= variables_.size() && slot < temps_offset_;
+}
+
+std::optional<uint32_t> CompiledExpression::CompileNode(const INode* node,
+                                                        CompileState* state) {
+  const INodeImpl* impl = node->AsNodeImpl();
+  if (impl->AsError())
+    return std::nullopt;
+  const Operation* operation = impl->AsOperation();
+  // The value type of a product does not see vectors inside sums.
+  bool is_scalar = operation && operation->op() == Op::Mult
+                       ? !IsVectorValued(node)
+                       : impl->GetValueType() == ValueType::Scalar;
+  if (!is_scalar)
+    return std::nullopt;
+  if (operation)
+    return CompileOperation(operation, state);
+  if (const Brackets* brackets = impl->AsBrackets())
+    return CompileNode(brackets->Value(), state);
+  if (const Variable* variable = impl->AsVariable()) {
+    if (auto slot = BoundSlot(variable))
+      return slot;
+    if (!variable->Value())
+      return std::nullopt;
+    return CompileNode(variable->Value(), state);
+  }
+  if (const Constant* constant = impl->AsConstant())
+    return state->AddConst(constant->Value());
+  if (impl->AsImaginary()) {
+    is_complex_ = true;
+    return state->AddConst({0.0, 1.0});
+  }
+  return std::nullopt;
+}
+
+std::optional<uint32_t> CompiledExpression::CompileOperation(
+    const Operation* operation,
+    CompileState* state) {
+  switch (operation->op()) {
+    case Op::UnMinus:
+    case Op::Sin:
+    case Op::Cos: {
+      if (operation->OperandsCount() != 1)
+        return std::nullopt;
+      auto value = CompileNode(operation->Operand(0), state);
+      if (!value)
+        return std::nullopt;
+      return state->Emit(&code_, operation->op(), *value, *value);
+    }
+    case Op::Mult: {
+      bool has_vectors = false;
+      for (size_t i = 0; i < operation->OperandsCount(); ++i)
+        has_vectors = has_vectors || IsVectorValued(operation->Operand(i));
+      if (!has_vectors)
+        break;
+      bool is_vector = false;
+      auto result = CompileMultChain(operation, state, &is_vector);
+      if (!result || is_vector)
+        return std::nullopt;
+      return result->front();
+    }
+    case Op::Minus:
+    case Op::Div:
+    case Op::Pow:
+    case Op::Sqrt:
+    case Op::Log:
+    case Op::Plus:
+      break;
+    default:
+      return std::nullopt;
+  }
+  if (operation->OperandsCount() == 0)
+    return std::nullopt;
+  auto result = CompileNode(operation->Operand(0), state);
+  if (!result)
+    return std::nullopt;
+  // Chains of transitive operations fold left to right, like SymCalc.
+  for (size_t i = 1; i < operation->OperandsCount(); ++i) {
+    auto operand = CompileNode(operation->Operand(i), state);
+    if (!operand)
+      return std::nullopt;
+    result = state->Emit(&code_, operation->op(), *result, *operand);
+  }
+  return result;
+}
+
+std::optional<CompiledExpression::Components>
+CompiledExpression::CompileVector(const INode* node, CompileState* state) {
+  const INodeImpl* impl = node->AsNodeImpl();
+  if (const Vector* vector = impl->AsVector()) {
+    if (vector->Size() == 0)
+      return std::nullopt;
+    Components result;
+    for (size_t i = 0; i < vector->Size(); ++i) {
+      auto component = CompileNode(vector->Value(i), state);
+      if (!component)
+        return std::nullopt;
+      result.push_back(*component);
+    }
+    return result;
+  }
+  if (const Brackets* brackets = impl->AsBrackets())
+    return CompileVector(brackets->Value(), state);
+  if (const Variable* variable = impl->AsVariable()) {
+    if (BoundSlot(variable) || !variable->Value())
+      return std::nullopt;
+    return CompileVector(variable->Value(), state);
+  }
+  const Operation* operation = impl->AsOperation();
+  if (!operation || operation->OperandsCount() == 0)
+    return std::nullopt;
+  switch (operation->op()) {
+    case Op::UnMinus: {
+      auto result = CompileVector(operation->Operand(0), state);
+      if (!result)
+        return std::nullopt;
+      for (uint32_t& component : *result)
+        component = state->Emit(&code_, Op::UnMinus, component, component);
+      return result;
+    }
+    case Op::Plus: {
+      auto result = CompileVector(operation->Operand(0), state);
+      if (!result)
+        return std::nullopt;
+      for (size_t i = 1; i < operation->OperandsCount(); ++i) {
+        auto operand = CompileVector(operation->Operand(i), state);
+        if (!operand || operand->size() != result->size())
+          return std::nullopt;
+        for (size_t k = 0; k < result->size(); ++k) {
+          (*result)[k] =
+              state->Emit(&code_, Op::Plus, (*result)[k], (*operand)[k]);
+        }
+      }
+      return result;
+    }
+    case Op::Mult: {
+      bool is_vector = false;
+      auto result = CompileMultChain(operation, state, &is_vector);
+      if (!result || !is_vector)
+        return std::nullopt;
+      return result;
+    }
+    case Op::VectorMult: {
+      if (operation->OperandsCount() != 2)
+        return std::nullopt;
+      auto lh = CompileVector(operation->Operand(0), state);
+      auto rh = CompileVector(operation->Operand(1), state);
+      if (!lh || !rh || lh->size() != 3 || rh->size() != 3)
+        return std::nullopt;
+      // Every component takes part in two products of the cross product.
+      for (size_t k = 0; k < 3; ++k) {
+        state->Retain((*lh)[k], 1);
+        state->Retain((*rh)[k], 1);
+      }
+      Components result;
+      for (size_t k = 0; k < 3; ++k) {
+        size_t i = (k + 1) % 3;
+        size_t j = (k + 2) % 3;
+        uint32_t a = state->Emit(&code_, Op::Mult, (*lh)[i], (*rh)[j]);
+        uint32_t b = state->Emit(&code_, Op::Mult, (*lh)[j], (*rh)[i]);
+        result.push_back(state->Emit(&code_, Op::Minus, a, b));
+      }
+      return result;
+    }
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<CompiledExpression::Components>
+CompiledExpression::CompileMultChain(const Operation* operation,
+                                     CompileState* state,
+                                     bool* is_vector) {
+  Components result;
+  bool result_vector = false;
+  // Left fold like MultOperation: a scalar scales a vector, two vectors give
+  // their scalar product.
+  for (size_t i = 0; i < operation->OperandsCount(); ++i) {
+    const INode* node = operation->Operand(i);
+    bool operand_vector = IsVectorValued(node);
+    Components operand;
+    if (operand_vector) {
+      auto components = CompileVector(node, state);
+      if (!components)
+        return std::nullopt;
+      operand = std::move(*components);
+    } else {
+      auto value = CompileNode(node, state);
+      if (!value)
+        return std::nullopt;
+      operand.push_back(*value);
+    }
+    if (i == 0) {
+      result = std::move(operand);
+      result_vector = operand_vector;
+    } else if (!result_vector && !operand_vector) {
+      result[0] = state->Emit(&code_, Op::Mult, result[0], operand[0]);
+    } else if (result_vector != operand_vector) {
+      uint32_t scalar = result_vector ? operand[0] : result[0];
+      Components vector =
+          result_vector ? std::move(result) : std::move(operand);
+      state->Retain(scalar, vector.size() - 1);
+      for (uint32_t& component : vector) {
+        component = result_vector
+                        ? state->Emit(&code_, Op::Mult, component, scalar)
+                        : state->Emit(&code_, Op::Mult, scalar, component);
+      }
+      result = std::move(vector);
+      result_vector = true;
+    } else {
+      if (result.size() != operand.size())
+        return std::nullopt;
+      uint32_t sum = state->Emit(&code_, Op::Mult, result[0], operand[0]);
+      for (size_t k = 1; k < result.size(); ++k) {
+        uint32_t product =
+            state->Emit(&code_, Op::Mult, result[k], operand[k]);
+        sum = state->Emit(&code_, Op::Plus, sum, product);
+      }
+      result = {sum};
+      result_vector = false;
+    }
+  }
+  *is_vector = result_vector;
+  return result;
+}
+
+bool CompiledExpression::IsVectorValued(const INode* node) const {
+  const INodeImpl* impl = node->AsNodeImpl();
+  if (impl->AsVector())
+    return true;
+  if (const Brackets* brackets = impl->AsBrackets())
+    return IsVectorValued(brackets->Value());
+  if (const Variable* variable = impl->AsVariable()) {
+    if (BoundSlot(variable) || !variable->Value())
+      return false;
+    return IsVectorValued(variable->Value());
+  }
+  const Operation* operation = impl->AsOperation();
+  if (!operation || operation->OperandsCount() == 0)
+    return false;
+  switch (operation->op()) {
+    case Op::VectorMult:
+      return true;
+    case Op::UnMinus:
+      return IsVectorValued(operation->Operand(0));
+    case Op::Plus:
+      for (size_t i = 0; i < operation->OperandsCount(); ++i) {
+        if (IsVectorValued(operation->Operand(i)))
+          return true;
+      }
+      return false;
+    case Op::Mult: {
+      // Scalar products of pairs of vectors are scalars.
+      bool result = false;
+      for (size_t i = 0; i < operation->OperandsCount(); ++i) {
+        if (IsVectorValued(operation->Operand(i)))
+          result = !result;
+      }
+      return result;
+    }
+    default:
+      return false;
+  }
+}
+
+std::optional<uint32_t> CompiledExpression::BoundSlot(
+    const Variable* variable) const {
+  const Symbol& symbol = variable->GetSymbol();
+  auto it = std::find(variables_.begin(), variables_.end(), symbol);
+  if (symbol.IsEmpty() || it == variables_.end())
+    return std::nullopt;
+  return static_cast<uint32_t>(it - variables_.begin());
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <complex>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "BatchKernels.h"
+#include "OpInfo.h"
+#include "Symbol.h"
+
+class INode;
+class Operation;
+class Variable;
+
+// Scalar expression compiled to flat register code for repeated numeric
+// evaluation. Free variables are bound in the order given to Compile();
+// variables that are not bound are replaced by their values at compile time.
+// Vector subexpressions are compiled per component. Roots take their
+// principal value. The compiled code is immutable and is
+// evaluated through EvaluationContext, which owns the bindings and registers,
+// so one expression may be evaluated by many threads at once.
+class CompiledExpression {
+ public:
+  // Returns nullptr if |node| is not a scalar expression, uses an operation
+  // without a numeric value or depends on a variable that is neither bound
+  // nor assigned.
+  static std::unique_ptr<CompiledExpression> Compile(
+      const INode* node,
+      std::vector<Symbol> variables);
+
+  const std::vector<Symbol>& Variables() const { return variables_; }
+  // True if the expression contains the imaginary unit, then only
+  // EvaluationContext::EvaluateComplex() may be used.
+  bool IsComplex() const { return is_complex_; }
+  size_t InstructionsCount() const { return code_.size(); }
+
+ private:
+  friend class EvaluationContext;
+
+  struct Instruction {
+    Op op;
+    uint32_t dst;
+    uint32_t lh;
+    uint32_t rh;
+    // The operands depend on bound variables.
+    bool lh_active;
+    bool rh_active;
+  };
+  struct CompileState;
+  using Components = std::vector<uint32_t>;
+
+  // Points evaluated per pass of EvaluationContext::EvaluateBatch(), keeps
+  // the register rows in cache.
+  static constexpr size_t kBatchBlock = 256;
+
+  CompiledExpression();
+
+  std::optional<uint32_t> CompileNode(const INode* node, CompileState* state);
+  std::optional<uint32_t> CompileOperation(const Operation* operation,
+                                           CompileState* state);
+  std::optional<Components> CompileVector(const INode* node,
+                                          CompileState* state);
+  // Mult chain with vector operands, |is_vector| receives the result shape.
+  std::optional<Components> CompileMultChain(const Operation* operation,
+                                             CompileState* state,
+                                             bool* is_vector);
+  bool IsVectorValued(const INode* node) const;
+  std::optional<uint32_t> BoundSlot(const Variable* variable) const;
+  double Evaluate(double* registers) const;
+  std::complex<double> EvaluateComplex(
+      std::complex<double>* registers) const;
+  // Forward-mode differentiation with dual numbers. |tangents| holds
+  // |directions| derivatives per slot; the rows of constants must be zero.
+  double EvaluateTangents(double* registers,
+                          double* tangents,
+                          size_t directions) const;
+  // Reverse-mode differentiation. The forward pass records the operands and
+  // the result of every instruction to |tape|, three values per instruction,
+  // the backward sweep accumulates the derivatives of the result by every
+  // slot to |adjoints|, which must be zero on entry.
+  double EvaluateAdjoints(double* registers,
+                          double* tape,
+                          double* adjoints) const;
+  // |registers| holds one row of kBatchBlock values per slot.
+  void EvaluateBatchBlock(const BatchKernels& kernels,
+                          double* registers,
+                          size_t count) const;
+  bool IsConstSlot(uint32_t slot) const;
+
+  std::vector<Symbol> variables_;
+  std::vector<Instruction> code_;
+  uint32_t result_ = 0;
+  uint32_t temps_offset_ = 0;
+  bool is_complex_ = false;
+  // Initial register files, the constants are in place.
+  std::vector<double> registers_;
+  std::vector<std::complex<double>> complex_registers_;
+};
@@ -9,10 +9,10 @@ Constant::Constant(bool val) : bool_value_(val), value_(val ? 1.0 : 0.0) {}
 Constant::Constant(double val, std::wstring name)
     : value_(val), name_(std::move(name)) {}
 
-PrintSize Constant::Render(Canvas* canvas,
-                           PrintBox print_box,
-                           bool dry_run,
-                           RenderBehaviour render_behaviour) const {
+PrintSize Constant::RenderImpl(Canvas* canvas,
+                               PrintBox print_box,
+                               bool dry_run,
+                               RenderBehaviour render_behaviour) const {
   bool has_front_minus = HasFrontMinus();
   auto minus_behaviour = render_behaviour.TakeMinus();
 
@@ -72,6 +72,11 @@ CompareResult Constant::Compare(const INode* rh) const {
   return result;
 }
 
+uint64_t Constant::ComputeHash() const {
+  uint64_t result = HashCombine(INodeImpl::ComputeHash(), HashString(name_));
+  return HashCombine(result, HashDouble(value_));
+}
+
 std::unique_ptr<INode> Constant::SymCalc(SymCalcSettings settings) const {
   return Clone();
 }
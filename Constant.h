@@ -19,14 +19,14 @@ class Constant : public INodeImpl {
 
   // INodeImpl interface
   NodeType GetNodeType() const override { return NodeType::Constant; }
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   PrintSize LastPrintSize() const override;
   int Priority() const override { return 100; }
   bool HasFrontMinus() const override;
-  bool CheckCircular(const INodeImpl* other) const override { return false; }
+  bool CheckCircular(const INodeImpl*) const override { return false; }
   Constant* AsConstant() override { return this; }
   const Constant* AsConstant() const override { return this; }
 
@@ -39,6 +39,10 @@ class Constant : public INodeImpl {
   double Value() const { return value_; }
   const std::wstring& Name() const { return name_; }
   bool IsNamed() const { return !name_.empty(); }
+  bool IsBool() const { return bool_value_.has_value(); }
+
+ protected:
+  uint64_t ComputeHash() const override;
 
  private:
   mutable PrintSize print_size_;
@@ -1,6 +1,7 @@
 ﻿#include "DiffOperation.h"
 
 #include <cassert>
+#include <unordered_map>
 
 #include "Brackets.h"
 #include "Constant.h"
@@ -8,6 +9,7 @@
 #include "INodeHelper.h"
 #include "LogOperation.h"
 #include "MultOperation.h"
+#include "NodeTable.h"
 #include "PlusOperation.h"
 #include "PowOperation.h"
 #include "SqrtOperation.h"
@@ -18,64 +20,78 @@
 #include "VariableRef.h"
 
 namespace {
-std::unique_ptr<INode> DoDiffNode(const INode* node, const Variable& by_var);
+struct DiffContext {
+  explicit DiffContext(const Variable& by_var) : by_var(by_var) {}
+
+  // Subtrees of the source expression get reused many times in a derivative.
+  std::unique_ptr<INode> Share(const INode* node) { return nodes.Share(node); }
+
+  const Variable& by_var;
+  NodeTable nodes;
+  // Derivatives of the interned source operations. Repeated subtrees of the
+  // source are differentiated once and share one derivative.
+  std::unordered_map<const INode*, std::shared_ptr<const INode>> derivatives;
+};
+
+std::unique_ptr<INode> DoDiffNode(const INode* node, DiffContext* context);
 std::unique_ptr<INode> DoDiffVariable(const Variable* var,
-                                      const Variable& by_var);
+                                      DiffContext* context);
 std::unique_ptr<INode> DoDiffOperation(const Operation* operation,
-                                       const Variable& by_var);
+                                       DiffContext* context);
 std::unique_ptr<INode> DoDiffMultOperation(const MultOperation* operation,
-                                           const Variable& by_var);
+                                           DiffContext* context);
 std::unique_ptr<INode> DoDiffDivOperation(const DivOperation* operation,
-                                          const Variable& by_var);
+                                          DiffContext* context);
 std::unique_ptr<INode> DoDiffPlusOperation(const PlusOperation* operation,
-                                           const Variable& by_var);
+                                           DiffContext* context);
 std::unique_ptr<INode> DoDiffPowOperation(const PowOperation* operation,
-                                          const Variable& by_var);
+                                          DiffContext* context);
 std::unique_ptr<INode> DoDiffSqrtOperation(const SqrtOperation* operation,
-                                           const Variable& by_var);
+                                           DiffContext* context);
 std::unique_ptr<INode> DoDiffLogOperation(const LogOperation* operation,
-                                          const Variable& by_var);
+                                          DiffContext* context);
 
 std::unique_ptr<INode> DoDiffVariable(const Variable* var,
-                                      const Variable& by_var) {
-  return INodeHelper::MakeConst(var->GetName() == by_var.GetName() ? 1.0 : 0.0);
+                                      DiffContext* context) {
+  return INodeHelper::MakeConst(
+      var->GetSymbol() == context->by_var.GetSymbol() ? 1.0 : 0.0);
 }
 
 std::unique_ptr<INode> DoDiffOperation(const Operation* operation,
-                                       const Variable& by_var) {
+                                       DiffContext* context) {
   switch (operation->op()) {
     case Op::UnMinus: {
       auto* un_minus = operation->AsUnMinusOperation();
-      return INodeHelper::MakeUnMinus(DoDiffNode(un_minus->Operand(), by_var));
+      return INodeHelper::MakeUnMinus(DoDiffNode(un_minus->Operand(), context));
     } break;
     case Op::Minus: {
       assert(false);
     } break;
     case Op::Plus: {
-      return DoDiffPlusOperation(operation->AsPlusOperation(), by_var);
+      return DoDiffPlusOperation(operation->AsPlusOperation(), context);
     } break;
     case Op::Mult: {
-      return DoDiffMultOperation(operation->AsMultOperation(), by_var);
+      return DoDiffMultOperation(operation->AsMultOperation(), context);
     } break;
     case Op::Pow: {
-      return DoDiffPowOperation(operation->AsPowOperation(), by_var);
+      return DoDiffPowOperation(operation->AsPowOperation(), context);
     } break;
     case Op::VectorMult: {
       assert(false);
     } break;
     case Op::Div: {
-      return DoDiffDivOperation(operation->AsDivOperation(), by_var);
+      return DoDiffDivOperation(operation->AsDivOperation(), context);
     } break;
     case Op::Sin: {
       auto f = operation->AsTrigonometricOperation()->Operand();
-      return DoDiffNode(f, by_var) * Cos(f->Clone());
+      return DoDiffNode(f, context) * Cos(context->Share(f));
     }
     case Op::Cos: {
       auto f = operation->AsTrigonometricOperation()->Operand();
-      return -DoDiffNode(f, by_var) * Sin(f->Clone());
+      return -DoDiffNode(f, context) * Sin(context->Share(f));
     } break;
     case Op::Log: {
-      return DoDiffLogOperation(operation->AsLogOperation(), by_var);
+      return DoDiffLogOperation(operation->AsLogOperation(), context);
     } break;
     case Op::Equal: {
       assert(false);
@@ -84,7 +100,7 @@ std::unique_ptr<INode> DoDiffOperation(const Operation* operation,
       assert(false);
     } break;
     case Op::Sqrt: {
-      return DoDiffSqrtOperation(operation->AsSqrtOperation(), by_var);
+      return DoDiffSqrtOperation(operation->AsSqrtOperation(), context);
     } break;
   }
 
@@ -92,7 +108,7 @@ std::unique_ptr<INode> DoDiffOperation(const Operation* operation,
 }
 
 std::unique_ptr<INode> DoDiffMultOperation(const MultOperation* operation,
-                                           const Variable& by_var) {
+                                           DiffContext* context) {
   std::vector<std::unique_ptr<INode>> new_plus_operands;
   new_plus_operands.reserve(operation->OperandsCount());
 
@@ -101,7 +117,7 @@ std::unique_ptr<INode> DoDiffMultOperation(const MultOperation* operation,
     new_mult_operands.reserve(operation->OperandsCount());
     for (size_t j = 0; j < operation->OperandsCount(); ++j) {
       if (i == j) {
-        auto diff = DoDiffNode(operation->Operand(j), by_var);
+        auto diff = DoDiffNode(operation->Operand(j), context);
         if (auto* as_const = INodeHelper::AsConstant(diff.get())) {
           if (as_const->Value() == 0.0) {
             new_mult_operands.clear();
@@ -110,7 +126,7 @@ std::unique_ptr<INode> DoDiffMultOperation(const MultOperation* operation,
         }
         new_mult_operands.push_back(std::move(diff));
       } else {
-        new_mult_operands.push_back(operation->Operand(j)->Clone());
+        new_mult_operands.push_back(context->Share(operation->Operand(j)));
       }
     }
     if (new_mult_operands.empty())
@@ -122,31 +138,33 @@ std::unique_ptr<INode> DoDiffMultOperation(const MultOperation* operation,
 }
 
 std::unique_ptr<INode> DoDiffDivOperation(const DivOperation* operation,
-                                          const Variable& by_var) {
+                                          DiffContext* context) {
   auto f = operation->Dividend();
   auto g = operation->Divider();
 
-  return (INodeHelper::MakeMultIfNeeded(DoDiffNode(f, by_var), g->Clone()) -
-          INodeHelper::MakeMultIfNeeded(f->Clone(), DoDiffNode(g, by_var))) /
-         Pow(g->Clone(), 2);
+  return (INodeHelper::MakeMultIfNeeded(DoDiffNode(f, context),
+                                        context->Share(g)) -
+          INodeHelper::MakeMultIfNeeded(context->Share(f),
+                                        DoDiffNode(g, context))) /
+         Pow(context->Share(g), 2);
 }
 
 std::unique_ptr<INode> DoDiffPlusOperation(const PlusOperation* operation,
-                                           const Variable& by_var) {
+                                           DiffContext* context) {
   std::vector<std::unique_ptr<INode>> new_plus_operands;
   new_plus_operands.reserve(operation->OperandsCount());
   for (size_t i = 0; i < operation->OperandsCount(); ++i) {
-    new_plus_operands.push_back(DoDiffNode(operation->Operand(i), by_var));
+    new_plus_operands.push_back(DoDiffNode(operation->Operand(i), context));
   }
   return INodeHelper::MakePlusIfNeeded(std::move(new_plus_operands));
 }
 
 std::unique_ptr<INode> DoDiffPowOperation(const PowOperation* operation,
-                                          const Variable& by_var) {
+                                          DiffContext* context) {
   auto f = operation->Base();
   auto g = operation->Exp();
-  auto derivative_f = DoDiffNode(f, by_var);
-  auto derivative_g = DoDiffNode(g, by_var);
+  auto derivative_f = DoDiffNode(f, context);
+  auto derivative_g = DoDiffNode(g, context);
   if ((derivative_f->Compare(Constants::Zero()) == CompareResult::Equal) &&
       (derivative_g->Compare(Constants::Zero()) == CompareResult::Equal)) {
     return Const(0.0);
@@ -154,27 +172,29 @@ std::unique_ptr<INode> DoDiffPowOperation(const PowOperation* operation,
 
   if (derivative_f->Compare(Constants::Zero()) == CompareResult::Equal) {
     // 10^x = 10^x * log(10);
-    return std::move(derivative_g) * operation->Clone() * Log(f->Clone());
+    return std::move(derivative_g) * context->Share(operation) *
+           Log(context->Share(f));
   }
   if (derivative_g->Compare(Constants::Zero()) == CompareResult::Equal) {
     // x ^ a = a *( x ^ (a-1))
-    return std::move(derivative_f) * g->Clone() *
-           Pow(f->Clone(), g->Clone() - 1.0);
+    return std::move(derivative_f) * context->Share(g) *
+           Pow(context->Share(f), context->Share(g) - 1.0);
   }
 
   // (f(x)^g(x))' = f(x) ^ (g(x)-1) * (g(x)*f'(x) + f(x)*log(f(x)*g'(x)))
   auto a =
-      Pow(f->Clone(),
+      Pow(context->Share(f),
           (g->Clone() - 1.0)->SymCalc(SymCalcSettings::KeepNamedConstants));
 
   std::vector<std::unique_ptr<INode>> b;
-  b.push_back(
-      INodeHelper::MakeMultIfNeeded(g->Clone(), std::move(derivative_f)));
+  b.push_back(INodeHelper::MakeMultIfNeeded(context->Share(g),
+                                            std::move(derivative_f)));
 
   if (derivative_g->Compare(Constants::Zero()) != CompareResult::Equal) {
     b.push_back(
-        f->Clone() *
-        INodeHelper::MakeLogIfNeeded(Constants::E()->Clone(), f->Clone()) *
+        context->Share(f) *
+        INodeHelper::MakeLogIfNeeded(Constants::E()->Clone(),
+                                     context->Share(f)) *
         std::move(derivative_g));
   }
   return INodeHelper::MakeMultIfNeeded(
@@ -182,22 +202,25 @@ std::unique_ptr<INode> DoDiffPowOperation(const PowOperation* operation,
 }
 
 std::unique_ptr<INode> DoDiffSqrtOperation(const SqrtOperation* operation,
-                                           const Variable& by_var) {
+                                           DiffContext* context) {
   auto f = operation->Value();
   auto g = operation->Exp();
-  auto derivative_f = DoDiffNode(f, by_var);
-  auto derivative_g = DoDiffNode(g, by_var);
+  auto derivative_f = DoDiffNode(f, context);
+  auto derivative_g = DoDiffNode(g, context);
 
   if (derivative_f->Compare(Constants::Zero()) == CompareResult::Equal) {
     // d/dx(a^(1/g(x))) = -(log(a) a^(1/g(x)) g'(x))/g(x)^2
-    return -(Log(f->Clone()) * Sqrt(f->Clone(), g->Clone()) *
+    return -(Log(context->Share(f)) *
+             Sqrt(context->Share(f), context->Share(g)) *
              std::move(derivative_g)) /
-           (Pow(g->Clone(), 2));
+           (Pow(context->Share(g), 2));
   }
   if (derivative_g->Compare(Constants::Zero()) == CompareResult::Equal) {
     // sqrt(x, n) -> (x') / (n * sqrt(x^(n-1)), n)
     return std::move(derivative_f) /
-           (g->Clone() * Sqrt(Pow(f->Clone(), g->Clone() - 1), g->Clone()));
+           (context->Share(g) *
+            Sqrt(Pow(context->Share(f), context->Share(g) - 1),
+                 context->Share(g)));
   }
   // d/dx(f(x)^(1/g(x))) =
   // (f(x)^(1/g(x) - 1) (g(x) f'(x) - f(x) log(f(x)) g'(x)))/g(x)^2
@@ -205,37 +228,58 @@ std::unique_ptr<INode> DoDiffSqrtOperation(const SqrtOperation* operation,
   // b = g(x) f'(x) - f(x) log(f(x)) g'(x)
   // c = g(x)^2
   // a * b / c
-  auto a = Sqrt(f->Clone(), f->Clone() - 1);
-  auto b = g->Clone() * std::move(derivative_f) -
-           f->Clone() * Log(f->Clone()) * std::move(derivative_g);
-  auto c = Pow(g->Clone(), 2);
+  auto a = Pow(context->Share(f), 1.0 / context->Share(g) - 1.0);
+  auto b = context->Share(g) * std::move(derivative_f) -
+           context->Share(f) * Log(context->Share(f)) *
+               std::move(derivative_g);
+  auto c = Pow(context->Share(g), 2);
   return (std::move(a) * std::move(b)) / std::move(c);
 }
 
 std::unique_ptr<INode> DoDiffLogOperation(const LogOperation* operation,
-                                          const Variable& by_var) {
+                                          DiffContext* context) {
   auto base = operation->Base();
   auto f = operation->Value();
-  auto derivative_base = DoDiffNode(base, by_var);
-  if (!INodeHelper::AsConstant(derivative_base.get())) {
-    return INodeHelper::MakeError(L"base is not constant");
-  }
-
-  return DoDiffNode(f, by_var) /
-         (INodeHelper::MakeMultIfNeeded(
-             f->Clone(), INodeHelper::MakeLogIfNeeded(Constants::E()->Clone(),
-                                                      base->Clone())));
+  auto derivative_base = DoDiffNode(base, context);
+  auto log_base = [&]() {
+    return INodeHelper::MakeLogIfNeeded(Constants::E()->Clone(),
+                                        context->Share(base));
+  };
+  // d/dx(log(b(x), f(x))) = f'(x)/(f(x) ln(b(x))) -
+  //                         b'(x) ln(f(x))/(b(x) ln(b(x))^2)
+  auto result =
+      DoDiffNode(f, context) /
+      (INodeHelper::MakeMultIfNeeded(context->Share(f), log_base()));
+  if (derivative_base->Compare(Constants::Zero()) == CompareResult::Equal)
+    return result;
+  return std::move(result) -
+         std::move(derivative_base) * Log(context->Share(f)) /
+             (context->Share(base) * Pow(log_base(), 2));
 }
 
-std::unique_ptr<INode> DoDiffNode(const INode* node, const Variable& by_var) {
+std::unique_ptr<INode> DoDiffNode(const INode* node, DiffContext* context) {
+  // Subtrees that do not mention the variable do not depend on it.
+  if (!node->AsNodeImpl()->FreeVariables().Contains(
+          context->by_var.GetSymbol())) {
+    return INodeHelper::MakeConst(0.0);
+  }
   if (auto* as_const = node->AsNodeImpl()->AsConstant())
     return INodeHelper::MakeConst(0.0);
   if (auto* as_imag = node->AsNodeImpl()->AsImaginary())
     return INodeHelper::MakeConst(0.0);
-  if (auto* as_operation = node->AsNodeImpl()->AsOperation())
-    return DoDiffOperation(as_operation, by_var);
+  if (auto* as_operation = node->AsNodeImpl()->AsOperation()) {
+    const INode* key = NodeTable::Resolve(node);
+    auto it = context->derivatives.find(key);
+    if (it == context->derivatives.end()) {
+      auto derivative = DoDiffOperation(as_operation, context);
+      it = context->derivatives
+               .emplace(key, context->nodes.Intern(std::move(derivative)))
+               .first;
+    }
+    return NodeTable::Instance(it->second);
+  }
   if (auto* as_var = node->AsNodeImpl()->AsVariable())
-    return DoDiffVariable(as_var, by_var);
+    return DoDiffVariable(as_var, context);
   assert(false);
   return nullptr;
 }
@@ -251,10 +295,10 @@ std::unique_ptr<INode> DiffOperation::Clone() const {
   return INodeHelper::MakeDiff(std::move(lh), std::move(rh));
 }
 
-PrintSize DiffOperation::Render(Canvas* canvas,
-                                PrintBox print_box,
-                                bool dry_run,
-                                RenderBehaviour render_behaviour) const {
+PrintSize DiffOperation::RenderImpl(Canvas* canvas,
+                                    PrintBox print_box,
+                                    bool dry_run,
+                                    RenderBehaviour render_behaviour) const {
   auto prefix_size = RenderPrefix(canvas, print_box, dry_run, render_behaviour);
   assert(first_non_diff_operand_ != nullptr);
 
@@ -327,5 +371,8 @@ std::unique_ptr<INode> Differential(
   auto by_var = (*operands)[1]->AsNodeImpl()->AsVariable();
   assert(by_var);
 
-  return DoDiffNode((*operands)[0].get(), *by_var);
+  DiffContext context(*by_var);
+  // Interning makes identical subtrees one node, the memo is keyed by it.
+  auto source = context.nodes.Intern((*operands)[0].get());
+  return DoDiffNode(source.get(), &context);
 }
\ No newline at end of file
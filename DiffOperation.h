@@ -16,10 +16,10 @@ class DiffOperation : public Operation {
   std::unique_ptr<INode> Clone() const override;
 
   // INodeImpl implementation
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   // IOperation implementation
   DiffOperation* AsDiffOperation() override { return this; }
   const DiffOperation* AsDiffOperation() const override { return this; }
@@ -20,10 +20,10 @@ std::unique_ptr<INode> DivOperation::Clone() const {
                                         Divider()->Clone());
 }
 
-PrintSize DivOperation::Render(Canvas* canvas,
-                               PrintBox print_box,
-                               bool dry_run,
-                               RenderBehaviour render_behaviour) const {
+PrintSize DivOperation::RenderImpl(Canvas* canvas,
+                                   PrintBox print_box,
+                                   bool dry_run,
+                                   RenderBehaviour render_behaviour) const {
   auto minus_behaviour = render_behaviour.TakeMinus();
 
   bool has_front_minus =
@@ -92,6 +92,8 @@ bool DivOperation::HasFrontMinus() const {
 
 std::optional<CanonicMult> DivOperation::GetCanonicMult() {
   if (Constant* bottom_const = Divider()->AsConstant()) {
+    // The dividend may be written through the result.
+    InvalidateCaches();
     CanonicMult result = INodeHelper::GetCanonicMult(operands_[0]);
     result.b *= bottom_const->Value();
     return result;
@@ -100,6 +102,7 @@ std::optional<CanonicMult> DivOperation::GetCanonicMult() {
 }
 
 std::optional<CanonicPow> DivOperation::GetCanonicPow() {
+  InvalidateCaches();
   CanonicPow dividend = INodeHelper::GetCanonicPow(operands_[0]);
   CanonicPow divider = INodeHelper::GetCanonicPow(operands_[1]);
   for (auto& pow_info : divider.base_nodes)
@@ -116,6 +119,7 @@ void DivOperation::SimplifyUnMinus(HotToken token,
   for (auto& node : operands_) {
     if (auto* un_minus = INodeHelper::AsUnMinus(node.get())) {
       is_positve = !is_positve;
+      InvalidateCaches();
       node = INodeHelper::Negate(std::move(node));
     }
   }
@@ -134,6 +138,11 @@ void DivOperation::SimplifyDivDiv(HotToken token) {
     return;
   }
 
+  InvalidateCaches();
+  if (top)
+    top->InvalidateCaches();
+  if (bottom)
+    bottom->InvalidateCaches();
   std::vector<std::unique_ptr<INode>> new_top;
   std::vector<std::unique_ptr<INode>> new_bottom;
   if (top) {
@@ -161,16 +170,19 @@ void DivOperation::SimplifyConsts(HotToken token,
 
   if (Constant* top = INodeHelper::AsConstant(operands_[0].get())) {
     if (top->Value() == 0.0) {
+      InvalidateCaches();
       *new_node = std::move(operands_[0]);
       return;
     }
   }
   if (Constant* bottom = INodeHelper::AsConstant(operands_[1].get())) {
     if (bottom->Value() == 1.0) {
+      InvalidateCaches();
       *new_node = std::move(operands_[0]);
       return;
     }
     if (bottom->Value() == -1.0) {
+      InvalidateCaches();
       *new_node = INodeHelper::MakeUnMinus(std::move(operands_[0]));
       return;
     }
@@ -196,6 +208,7 @@ void DivOperation::SimplifyCanonicConstants(HotToken& token,
     node_info.exp_up *= -1.0;
   std::vector<std::unique_ptr<INode>> new_top_nodes;
   std::vector<std::unique_ptr<INode>> new_bottom_nodes;
+  InvalidateCaches();
   bool is_combined = MergeCanonicToPow(token, canonic_top, canonic_bottom,
                                        &new_top_nodes, &new_bottom_nodes);
   if (!is_combined)
@@ -12,10 +12,10 @@ std::unique_ptr<INode> ErrorNode::Clone() const {
   return std::make_unique<ErrorNode>(error_);
 }
 
-PrintSize ErrorNode::Render(Canvas* canvas,
-                            PrintBox print_box,
-                            bool dry_run,
-                            RenderBehaviour render_behaviour) const {
+PrintSize ErrorNode::RenderImpl(Canvas* canvas,
+                                PrintBox print_box,
+                                bool dry_run,
+                                RenderBehaviour render_behaviour) const {
   return print_size_ = canvas->PrintAt(print_box, error_,
                                        render_behaviour.GetSubSuper(), dry_run);
 }
@@ -46,4 +46,8 @@ CompareResult ErrorNode::Compare(const INode* rh) const {
   assert(rh_err);
   result = CompareTrivial(error_, rh_err->error_);
   return result;
+}
+
+uint64_t ErrorNode::ComputeHash() const {
+  return HashCombine(INodeImpl::ComputeHash(), HashString(error_));
 }
\ No newline at end of file
@@ -14,14 +14,14 @@ class ErrorNode : public INodeImpl {
 
   // INodeImpl interface
   NodeType GetNodeType() const override { return NodeType::ErrorNode; }
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   PrintSize LastPrintSize() const override;
   int Priority() const override { return 0; }
   bool HasFrontMinus() const override { return false; }
-  bool CheckCircular(const INodeImpl* other) const override { return false; }
+  bool CheckCircular(const INodeImpl*) const override { return false; }
 
   void SimplifyImpl(HotToken token, std::unique_ptr<INode>* new_node) override;
   void OpenBracketsImpl(HotToken token,
@@ -29,6 +29,11 @@ class ErrorNode : public INodeImpl {
   void ConvertToComplexImpl(HotToken token,
                             std::unique_ptr<INode>* new_node) override;
 
+  const std::wstring& Error() const { return error_; }
+
+ protected:
+  uint64_t ComputeHash() const override;
+
  private:
   mutable PrintSize print_size_;
   std::wstring error_;
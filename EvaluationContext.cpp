@@ -0,0 +1,108 @@
+#include "EvaluationContext.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "CompiledExpression.h"
+
+EvaluationContext::EvaluationContext(
+    std::shared_ptr<const CompiledExpression> expression)
+    : expression_(std::move(expression)),
+      registers_(expression_->registers_),
+      complex_registers_(expression_->complex_registers_) {}
+
+EvaluationContext::~EvaluationContext() {}
+
+void EvaluationContext::Bind(size_t indx, double value) {
+  assert(indx < expression_->variables_.size());
+  registers_[indx] = value;
+  complex_registers_[indx] = value;
+}
+
+bool EvaluationContext::Bind(const Symbol& symbol, double value) {
+  const auto& variables = expression_->variables_;
+  auto it = std::find(variables.begin(), variables.end(), symbol);
+  if (symbol.IsEmpty() || it == variables.end())
+    return false;
+  Bind(it - variables.begin(), value);
+  return true;
+}
+
+void EvaluationContext::BindAll(const double* values) {
+  for (size_t i = 0; i < expression_->variables_.size(); ++i)
+    Bind(i, values[i]);
+}
+
+double EvaluationContext::Evaluate() {
+  return expression_->Evaluate(registers_.data());
+}
+
+std::complex<double> EvaluationContext::EvaluateComplex() {
+  return expression_->EvaluateComplex(complex_registers_.data());
+}
+
+double EvaluationContext::EvaluateDerivatives(const double* directions,
+                                             size_t directions_count,
+                                             double* derivatives) {
+  const size_t variables_count = expression_->variables_.size();
+  // Only rows of temporaries are written, the rows of constants stay zero.
+  if (tangents_.size() != registers_.size() * directions_count)
+    tangents_.assign(registers_.size() * directions_count, 0.0);
+  for (size_t i = 0; i < variables_count; ++i) {
+    for (size_t k = 0; k < directions_count; ++k) {
+      tangents_[i * directions_count + k] =
+          directions[k * variables_count + i];
+    }
+  }
+  double result = expression_->EvaluateTangents(
+      registers_.data(), tangents_.data(), directions_count);
+  const double* result_tangents =
+      tangents_.data() + expression_->result_ * directions_count;
+  std::copy(result_tangents, result_tangents + directions_count, derivatives);
+  return result;
+}
+
+double EvaluationContext::EvaluateGradient(double* gradient) {
+  const size_t variables_count = expression_->variables_.size();
+  tape_.resize(expression_->code_.size() * 3);
+  adjoints_.assign(registers_.size(), 0.0);
+  double result = expression_->EvaluateAdjoints(
+      registers_.data(), tape_.data(), adjoints_.data());
+  std::copy(adjoints_.begin(), adjoints_.begin() + variables_count, gradient);
+  return result;
+}
+
+void EvaluationContext::EvaluateBatch(const double* const* bindings,
+                                      size_t count,
+                                      double* output) {
+  EvaluateBatch(bindings, count, output, GetSupportedSimdLevel());
+}
+
+void EvaluationContext::EvaluateBatch(const double* const* bindings,
+                                      size_t count,
+                                      double* output,
+                                      SimdLevel level) {
+  assert(!expression_->IsComplex());
+  const BatchKernels* kernels =
+      GetBatchKernels(std::min(level, GetSupportedSimdLevel()));
+  const size_t kBlock = CompiledExpression::kBatchBlock;
+  const size_t variables_count = expression_->variables_.size();
+  if (batch_registers_.empty()) {
+    batch_registers_.resize(registers_.size() * kBlock);
+    for (size_t i = variables_count; i < expression_->temps_offset_; ++i) {
+      std::fill_n(batch_registers_.data() + i * kBlock, kBlock,
+                  registers_[i]);
+    }
+  }
+  const double* result =
+      batch_registers_.data() + expression_->result_ * kBlock;
+  for (size_t begin = 0; begin < count; begin += kBlock) {
+    size_t size = std::min(kBlock, count - begin);
+    for (size_t i = 0; i < variables_count; ++i) {
+      std::copy(bindings[i] + begin, bindings[i] + begin + size,
+                batch_registers_.data() + i * kBlock);
+    }
+    expression_->EvaluateBatchBlock(*kernels, batch_registers_.data(), size);
+    std::copy(result, result + size, output + begin);
+  }
+}
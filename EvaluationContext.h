@@ -0,0 +1,66 @@
+#pragma once
+
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include "BatchKernels.h"
+#include "Symbol.h"
+
+class CompiledExpression;
+
+// Bindings and registers for evaluating a shared CompiledExpression. A
+// context belongs to one thread at a time; threads evaluating the same
+// expression concurrently each use their own context and need no locks.
+class EvaluationContext {
+ public:
+  explicit EvaluationContext(
+      std::shared_ptr<const CompiledExpression> expression);
+  ~EvaluationContext();
+
+  const CompiledExpression* Expression() const { return expression_.get(); }
+
+  // |indx| follows CompiledExpression::Variables().
+  void Bind(size_t indx, double value);
+  // Returns false if |symbol| is not bound by the expression.
+  bool Bind(const Symbol& symbol, double value);
+  // |values| holds one value per bound variable.
+  void BindAll(const double* values);
+
+  double Evaluate();
+  std::complex<double> EvaluateComplex();
+  // Evaluates the expression and its derivatives along |directions_count|
+  // directions in one forward pass. |directions| holds Variables().size()
+  // components per direction, |derivatives| receives one value per direction.
+  double EvaluateDerivatives(const double* directions,
+                             size_t directions_count,
+                             double* derivatives);
+  // Partial derivatives by every bound variable, in the order of Variables(),
+  // from one forward pass and one reverse sweep over the recorded tape.
+  double EvaluateGradient(double* gradient);
+  // Evaluates the expression at |count| points. |bindings| holds one array of
+  // |count| values per bound variable, results are written to |output|. The
+  // vector kernels of |level| are used, by default the best the CPU supports.
+  // A |level| above GetSupportedSimdLevel() falls back to the supported one.
+  void EvaluateBatch(const double* const* bindings,
+                     size_t count,
+                     double* output);
+  void EvaluateBatch(const double* const* bindings,
+                     size_t count,
+                     double* output,
+                     SimdLevel level);
+
+ private:
+  std::shared_ptr<const CompiledExpression> expression_;
+  std::vector<double> registers_;
+  std::vector<std::complex<double>> complex_registers_;
+  // Dual parts of the registers, one row of derivatives per slot.
+  std::vector<double> tangents_;
+  // Operands and result of every instruction, recorded by EvaluateGradient().
+  std::vector<double> tape_;
+  // Derivatives of the result by every slot.
+  std::vector<double> adjoints_;
+  // One row of CompiledExpression::kBatchBlock values per slot, allocated by
+  // the first EvaluateBatch().
+  std::vector<double> batch_registers_;
+};
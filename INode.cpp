@@ -1 +1,13 @@
-#include "INode.h"
\ No newline at end of file
+#include "INode.h"
+
+#include "NodeArena.h"
+
+// static
+void* INode::operator new(size_t size) {
+  return NodeArena::Allocate(size);
+}
+
+// static
+void INode::operator delete(void* ptr) {
+  NodeArena::Free(ptr);
+}
@@ -1,4 +1,6 @@
 #pragma once
+#include <stddef.h>
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -20,6 +22,10 @@ class INode {
  public:
   virtual ~INode() {}
 
+  // Nodes are allocated from the current NodeArena when one is set.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr);
+
   virtual CompareResult Compare(const INode* rh) const = 0;
   virtual std::unique_ptr<INode> Clone() const = 0;
   virtual std::unique_ptr<INode> SymCalc(SymCalcSettings settings) const = 0;
@@ -105,6 +105,12 @@ PlusOperation* INodeHelper::AsPlus(INode* lh) {
   return (result) ? result->AsPlusOperation() : nullptr;
 }
 
+// static
+const PlusOperation* INodeHelper::AsPlus(const INode* lh) {
+  auto result = lh->AsNodeImpl()->AsOperation();
+  return (result) ? result->AsPlusOperation() : nullptr;
+}
+
 // static
 const DivOperation* INodeHelper::AsDiv(const INode* lh) {
   auto result = lh->AsNodeImpl()->AsOperation();
@@ -245,15 +251,20 @@ void INodeHelper::RemoveEmptyOperands(
       std::end(*nodes));
 }
 
+void INodeHelper::RemoveEmptyOperands(OperandsVector* nodes) {
+  nodes->erase(
+      std::remove_if(std::begin(*nodes), std::end(*nodes),
+                     [](const std::unique_ptr<INode>& node) { return !node; }),
+      std::end(*nodes));
+}
+
 std::unique_ptr<INode> INodeHelper::TakeOperand(Operation* operation,
                                                 size_t indx) {
   return operation->TakeOperand(indx);
 }
 
 // static
-bool INodeHelper::HasAnyOperation(
-    Op op,
-    const std::vector<std::unique_ptr<INode>>& nodes) {
+bool INodeHelper::HasAnyOperation(Op op, const OperandsVector& nodes) {
   for (const auto& node : nodes) {
     const auto* as_op = AsOperation(node.get());
     if (as_op && as_op->op() == op)
@@ -284,6 +295,29 @@ bool INodeHelper::HasAllValueType(
   return true;
 }
 
+// static
+size_t INodeHelper::CountNodes(const INode* node) {
+  size_t result = 0;
+  std::vector<const INodeImpl*> stack = {node->AsNodeImpl()};
+  while (!stack.empty()) {
+    const INodeImpl* current = stack.back();
+    stack.pop_back();
+    ++result;
+    if (const Operation* operation = current->AsOperation()) {
+      for (size_t i = 0; i < operation->OperandsCount(); ++i)
+        stack.push_back(operation->Operand(i));
+    } else if (current->AsVariable() || current->AsConstant()) {
+      // Named variables and constants are leaves.
+    } else if (auto sequence = current->AsAbstractSequence()) {
+      for (size_t i = 0; i < sequence->Size(); ++i)
+        stack.push_back(sequence->Value(i)->AsNodeImpl());
+    } else if (const Brackets* brackets = current->AsBrackets()) {
+      stack.push_back(brackets->Value());
+    }
+  }
+  return result;
+}
+
 // static
 std::unique_ptr<Operation> INodeHelper::MakeEmpty(Op op) {
   switch (op) {
@@ -334,7 +368,7 @@ std::unique_ptr<Operation> INodeHelper::MakeOperation(
     Op op,
     std::vector<std::unique_ptr<INode>> operands) {
   auto result = MakeEmpty(op);
-  result->operands_.swap(operands);
+  result->operands_ = OperandsVector(std::move(operands));
   return result;
 }
 
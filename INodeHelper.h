@@ -21,6 +21,7 @@ class INode;
 class INodeImpl;
 class LogOperation;
 class MultOperation;
+class OperandsVector;
 class Operation;
 class PlusOperation;
 class PowOperation;
@@ -68,15 +69,17 @@ class INodeHelper {
   static std::unique_ptr<INode> Negate(std::unique_ptr<INode> node);
   static std::unique_ptr<MultOperation> ConvertToMul(std::unique_ptr<INode> rh);
   static void RemoveEmptyOperands(std::vector<std::unique_ptr<INode>>* nodes);
+  static void RemoveEmptyOperands(OperandsVector* nodes);
   static std::unique_ptr<INode> TakeOperand(Operation* operation, size_t indx);
-  static bool HasAnyOperation(Op op,
-                              const std::vector<std::unique_ptr<INode>>& nodes);
+  static bool HasAnyOperation(Op op, const OperandsVector& nodes);
   static bool HasAnyValueType(
       const std::vector<std::unique_ptr<INode>>& operands,
       ValueType value_type);
   static bool HasAllValueType(
       const std::vector<std::unique_ptr<INode>>& operands,
       ValueType value_type);
+  // Nodes of the tree as seen through shared nodes and references.
+  static size_t CountNodes(const INode* node);
 
   static std::unique_ptr<Operation> MakeEmpty(Op op);
   static std::unique_ptr<Operation> MakeOperation(
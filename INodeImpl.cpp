@@ -1,7 +1,155 @@
 #include "INodeImpl.h"
 
+#include <cstring>
+
+namespace {
+uint64_t Mix(uint64_t value) {
+  value += 0x9e3779b97f4a7c15ull;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+  return value ^ (value >> 31);
+}
+}  // namespace
+
 CompareResult INodeImpl::CompareType(const INode* rh) const {
   int a = static_cast<int>(GetNodeType());
   int b = static_cast<int>(rh->AsNodeImpl()->GetNodeType());
   return CompareTrivial(a, b);
-}
\ No newline at end of file
+}
+
+PrintSize INodeImpl::Render(Canvas* canvas,
+                            PrintBox print_box,
+                            bool dry_run,
+                            RenderBehaviour render_behaviour) const {
+  if (dry_run && measured_ && measured_behaviour_ == render_behaviour)
+    return LastPrintSize();
+  PrintSize result = RenderImpl(canvas, print_box, dry_run, render_behaviour);
+  if (dry_run) {
+    measured_behaviour_ = render_behaviour;
+    measured_ = TrackLayout();
+  }
+  return result;
+}
+
+uint64_t INodeImpl::Hash() const {
+  if (hash_valid_)
+    return hash_;
+  uncacheable_ = false;
+  uint64_t result = ComputeHash();
+  if (uncacheable_) {
+    ReleaseChildren();
+    return result;
+  }
+  hash_ = result;
+  hash_valid_ = true;
+  cached_ = true;
+  return hash_;
+}
+
+const SymbolSet& INodeImpl::FreeVariables() const {
+  if (free_variables_valid_)
+    return free_variables_;
+  uncacheable_ = false;
+  free_variables_.Clear();
+  CollectFreeVariables(&free_variables_);
+  if (uncacheable_) {
+    ReleaseChildren();
+    return free_variables_;
+  }
+  free_variables_valid_ = true;
+  cached_ = true;
+  return free_variables_;
+}
+
+uint64_t INodeImpl::ChildHash(const INode* child) const {
+  const INodeImpl* impl = child->AsNodeImpl();
+  uint64_t result = impl->Hash();
+  if (impl->hash_valid_)
+    impl->cache_parent_ = this;
+  else
+    uncacheable_ = true;
+  return result;
+}
+
+const SymbolSet& INodeImpl::ChildFreeVariables(const INode* child) const {
+  const INodeImpl* impl = child->AsNodeImpl();
+  const SymbolSet& result = impl->FreeVariables();
+  if (impl->free_variables_valid_)
+    impl->cache_parent_ = this;
+  else
+    uncacheable_ = true;
+  return result;
+}
+
+bool INodeImpl::TrackChild(const INode* child) const {
+  const INodeImpl* impl = child->AsNodeImpl();
+  impl->Hash();
+  if (!impl->hash_valid_)
+    return false;
+  impl->cache_parent_ = this;
+  cached_ = true;
+  return true;
+}
+
+bool INodeImpl::TrackLayout() const {
+  Hash();
+  return hash_valid_;
+}
+
+void INodeImpl::ForgetChild(const INode* child) const {
+  if (!child)
+    return;
+  const INodeImpl* impl = child->AsNodeImpl();
+  if (impl->cache_parent_ == this)
+    impl->cache_parent_ = nullptr;
+}
+
+void INodeImpl::InvalidateCachesUpwards() const {
+  const INodeImpl* node = this;
+  while (node && node->cached_) {
+    node->cached_ = false;
+    node->hash_valid_ = false;
+    node->free_variables_valid_ = false;
+    node->measured_ = false;
+    node->ForgetChildren();
+    node->DropCaches();
+    const INodeImpl* parent = node->cache_parent_;
+    node->cache_parent_ = nullptr;
+    node = parent;
+  }
+}
+
+void INodeImpl::ReleaseChildren() const {
+  // The children stay linked while another value of the node is cached.
+  if (!cached_)
+    ForgetChildren();
+}
+
+uint64_t INodeImpl::ComputeHash() const {
+  return Mix(static_cast<uint64_t>(GetNodeType()));
+}
+
+// static
+uint64_t INodeImpl::HashCombine(uint64_t seed, uint64_t value) {
+  return Mix(seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) +
+                     (seed >> 2)));
+}
+
+// static
+uint64_t INodeImpl::HashDouble(double value) {
+  if (value == 0)
+    value = 0;  // -0.0 == 0.0
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return Mix(bits);
+}
+
+// static
+uint64_t INodeImpl::HashString(const std::wstring& value) {
+  uint64_t result = 0xcbf29ce484222325ull;
+  for (wchar_t ch : value) {
+    result ^= static_cast<uint32_t>(ch);
+    result *= 0x100000001b3ull;
+  }
+  return result;
+}
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <stdint.h>
+
+#include <string>
+
 #include "Canvas.h"
 #include "HotToken.h"
 #include "INode.h"
 #include "RenderBehaviour.h"
+#include "SymbolSet.h"
 
 class AbstractSequence;
 class Brackets;
@@ -12,6 +17,7 @@ class ErrorNode;
 class Imaginary;
 class Operation;
 class Sequence;
+class SharedNode;
 class Variable;
 class Vector;
 
@@ -56,10 +62,10 @@ class INodeImpl : public INode {
 
   // INodeImpl interface
   virtual NodeType GetNodeType() const = 0;
-  virtual PrintSize Render(Canvas* canvas,
-                           PrintBox print_box,
-                           bool dry_run,
-                           RenderBehaviour render_behaviour) const = 0;
+  virtual PrintSize RenderImpl(Canvas* canvas,
+                               PrintBox print_box,
+                               bool dry_run,
+                               RenderBehaviour render_behaviour) const = 0;
   virtual PrintSize LastPrintSize() const = 0;
 
   virtual int Priority() const = 0;
@@ -84,6 +90,7 @@ class INodeImpl : public INode {
   virtual const Variable* AsVariable() const { return nullptr; }
   virtual Operation* AsOperation() { return nullptr; }
   virtual const Operation* AsOperation() const { return nullptr; }
+  virtual const SharedNode* AsSharedNode() const { return nullptr; }
 
   virtual void SimplifyImpl(HotToken token,
                             std::unique_ptr<INode>* new_node) = 0;
@@ -93,4 +100,78 @@ class INodeImpl : public INode {
                                     std::unique_ptr<INode>* new_node) = 0;
 
   CompareResult CompareType(const INode* rh) const;
+
+  // The dry run measures the node, it returns the size of the last one while
+  // the subtree is not mutated and |render_behaviour| is the same. The paint
+  // pass relies on the sizes of the dry run.
+  PrintSize Render(Canvas* canvas,
+                   PrintBox print_box,
+                   bool dry_run,
+                   RenderBehaviour render_behaviour) const;
+
+  // Structural hash: nodes that Compare as Equal have equal hashes. The value
+  // is cached until the subtree is mutated, see InvalidateCaches().
+  uint64_t Hash() const;
+  // Symbols of the variables the subtree mentions, values of the variables
+  // are not looked into. Cached like Hash().
+  const SymbolSet& FreeVariables() const;
+  // Drops the cached values of the node and of the ancestors that computed
+  // theirs from it. Mutators call it before changing the node.
+  void InvalidateCaches() const {
+    if (cached_)
+      InvalidateCachesUpwards();
+  }
+
+ protected:
+  virtual uint64_t ComputeHash() const;
+  virtual void CollectFreeVariables(SymbolSet*) const {}
+
+  // Hash() and FreeVariables() of a child the value being computed depends
+  // on, so mutations of |child| invalidate the caches of this node.
+  uint64_t ChildHash(const INode* child) const;
+  const SymbolSet& ChildFreeVariables(const INode* child) const;
+  // The value being computed follows a node this subtree doesn't own and
+  // must not be cached.
+  void MarkUncacheable() const { uncacheable_ = true; }
+  // Subclasses forget the children their caches were computed from. Called
+  // when the caches are dropped, and when a computed value turns out to be
+  // uncacheable, so no child points back to a node that is not |cached_|.
+  virtual void ForgetChildren() const {}
+  // Called when the caches are dropped. Subclasses drop the values they cache
+  // themselves.
+  virtual void DropCaches() const {}
+  void ForgetChild(const INode* child) const;
+  // Ties a cache of the subclass to the subtree of |child|, DropCaches() is
+  // called when either is mutated. Returns false if mutations of the subtree
+  // can't be followed, then the value must not be cached.
+  bool TrackChild(const INode* child) const;
+  // Same for a cache that depends on the node alone.
+  void SetCached() const { cached_ = true; }
+  // Ties the measured size to everything RenderImpl() reads. By default the
+  // children Hash() follows.
+  virtual bool TrackLayout() const;
+
+  static uint64_t HashCombine(uint64_t seed, uint64_t value);
+  static uint64_t HashDouble(double value);
+  static uint64_t HashString(const std::wstring& value);
+
+ private:
+  friend class Tests;
+
+  void InvalidateCachesUpwards() const;
+  // Unlinks the children a value that wasn't cached was computed from.
+  void ReleaseChildren() const;
+
+  mutable uint64_t hash_ = 0;
+  mutable SymbolSet free_variables_;
+  // The node that computed its caches from this one, valid while it is
+  // |cached_|.
+  mutable const INodeImpl* cache_parent_ = nullptr;
+  // Some value of the node is cached.
+  mutable bool cached_ = false;
+  mutable bool hash_valid_ = false;
+  mutable bool free_variables_valid_ = false;
+  mutable bool uncacheable_ = false;
+  mutable bool measured_ = false;
+  mutable RenderBehaviour measured_behaviour_;
 };
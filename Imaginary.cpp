@@ -21,10 +21,10 @@ std::unique_ptr<INode> Imaginary::SymCalc(SymCalcSettings settings) const {
   return std::make_unique<Imaginary>();
 }
 
-PrintSize Imaginary::Render(Canvas* canvas,
-                            PrintBox print_box,
-                            bool dry_run,
-                            RenderBehaviour render_behaviour) const {
+PrintSize Imaginary::RenderImpl(Canvas* canvas,
+                                PrintBox print_box,
+                                bool dry_run,
+                                RenderBehaviour render_behaviour) const {
   return print_size_ = canvas->PrintAt(print_box, "i",
                                        render_behaviour.GetSubSuper(), dry_run);
 }
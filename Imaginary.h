@@ -15,14 +15,14 @@ class Imaginary : public INodeImpl {
 
   // INodeImpl interface
   NodeType GetNodeType() const override { return NodeType::Imaginary; }
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   PrintSize LastPrintSize() const override;
   int Priority() const override { return 100; }
   bool HasFrontMinus() const override { return false; }
-  bool CheckCircular(const INodeImpl* other) const override { return false; }
+  bool CheckCircular(const INodeImpl*) const override { return false; }
   Imaginary* AsImaginary() override { return this; }
   const Imaginary* AsImaginary() const override { return this; }
 
@@ -29,10 +29,10 @@ std::unique_ptr<INode> LogOperation::Clone() const {
   return INodeHelper::MakeLog(Operand(0)->Clone(), Operand(1)->Clone());
 }
 
-PrintSize LogOperation::Render(Canvas* canvas,
-                               PrintBox print_box,
-                               bool dry_run,
-                               RenderBehaviour render_behaviour) const {
+PrintSize LogOperation::RenderImpl(Canvas* canvas,
+                                   PrintBox print_box,
+                                   bool dry_run,
+                                   RenderBehaviour render_behaviour) const {
   render_behaviour.TakeMinus();
   render_behaviour.TakeBrackets();
   // Render "log".
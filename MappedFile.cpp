@@ -0,0 +1,84 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {}
+
+#if defined(_WIN32)
+
+MappedFile::~MappedFile() {
+  if (data_)
+    UnmapViewOfFile(data_);
+  if (mapping_)
+    CloseHandle(mapping_);
+  if (file_)
+    CloseHandle(file_);
+}
+
+// static
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return nullptr;
+  std::unique_ptr<MappedFile> result(new MappedFile());
+  result->file_ = file;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size))
+    return nullptr;
+  if (size.QuadPart == 0)
+    return result;
+  result->mapping_ =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!result->mapping_)
+    return nullptr;
+  result->data_ = static_cast<const char*>(
+      MapViewOfFile(result->mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (!result->data_)
+    return nullptr;
+  result->size_ = static_cast<size_t>(size.QuadPart);
+  return result;
+}
+
+#else
+
+MappedFile::~MappedFile() {
+  if (data_)
+    munmap(const_cast<char*>(data_), size_);
+}
+
+// static
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  std::unique_ptr<MappedFile> result(new MappedFile());
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  if (st.st_size > 0) {
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                      MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return nullptr;
+    }
+    result->data_ = static_cast<const char*>(data);
+    result->size_ = static_cast<size_t>(st.st_size);
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  return result;
+}
+
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+// A file mapped read-only into memory, for BinaryImage::Open().
+class MappedFile {
+ public:
+  MappedFile(const MappedFile&) = delete;
+  ~MappedFile();
+
+  // Returns nullptr if the file can not be opened or mapped.
+  static std::unique_ptr<MappedFile> Open(const std::string& path);
+
+  std::string_view Data() const { return std::string_view(data_, size_); }
+
+ private:
+  MappedFile();
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+#if defined(_WIN32)
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#endif
+};
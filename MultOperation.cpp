@@ -7,14 +7,18 @@
 #include "DivOperation.h"
 #include "INodeHelper.h"
 #include "Imaginary.h"
+#include "NodeTable.h"
 #include "OpInfo.h"
 #include "PlusOperation.h"
+#include "Polynomial.h"
 #include "SimplifyHelpers.h"
 #include "UnMinusOperation.h"
 #include "Vector.h"
 #include "VectorScalarProduct.h"
 
 namespace {
+constexpr size_t kPolynomialMinProducts = 64;
+
 bool NextPermutation(
     std::vector<std::pair<size_t, size_t>>* permutation_indexes) {
   for (auto ii = std::rbegin(*permutation_indexes);
@@ -27,6 +31,56 @@ bool NextPermutation(
   }
   return false;
 }
+
+void InvalidateOwner(std::vector<std::unique_ptr<INode>>*) {}
+void InvalidateOwner(OperandsVector* nodes) {
+  nodes->InvalidateOwner();
+}
+
+template <typename Nodes>
+std::unique_ptr<INode> DoProcessImaginary(Nodes* nodes) {
+  size_t count_i = 0;
+  for (auto& node : *nodes) {
+    if (!node->AsNodeImpl()->AsImaginary())
+      continue;
+    ++count_i;
+    if (count_i == 2)
+      break;
+  }
+  if (count_i < 2)
+    return nullptr;
+
+  InvalidateOwner(nodes);
+  count_i = 0;
+  for (auto& node : *nodes) {
+    if (!node->AsNodeImpl()->AsImaginary())
+      continue;
+    ++count_i;
+    node.reset();
+  }
+
+  INodeHelper::RemoveEmptyOperands(nodes);
+  if (count_i >= 4) {
+    count_i = count_i % 4;
+  }
+  bool negate = false;
+  if (count_i >= 2) {
+    count_i -= 2;
+    negate = true;
+  }
+  assert(count_i == 0 || count_i == 1);
+  std::unique_ptr<INode> node;
+  if (count_i)
+    node = INodeHelper::MakeImaginary();
+  else
+    node = INodeHelper::MakeConst(1.0);
+  if (negate)
+    node = INodeHelper::Negate(std::move(node));
+  if (!nodes->empty()) {
+    nodes->push_back(std::move(node));
+  }
+  return node;
+}
 }  // namespace
 
 MultOperation::MultOperation(std::unique_ptr<INode> lh,
@@ -44,10 +98,10 @@ std::unique_ptr<INode> MultOperation::Clone() const {
   return INodeHelper::MakeMult(std::move(new_nodes));
 }
 
-PrintSize MultOperation::Render(Canvas* canvas,
-                                PrintBox print_box,
-                                bool dry_run,
-                                RenderBehaviour render_behaviour) const {
+PrintSize MultOperation::RenderImpl(Canvas* canvas,
+                                    PrintBox print_box,
+                                    bool dry_run,
+                                    RenderBehaviour render_behaviour) const {
   return print_size_ =
              RenderOperandChain(canvas, print_box, dry_run, render_behaviour);
 }
@@ -92,6 +146,8 @@ void MultOperation::OpenBracketsImpl(HotToken token,
 }
 
 std::optional<CanonicMult> MultOperation::GetCanonicMult() {
+  // The operands may be written through the result.
+  InvalidateCaches();
   CanonicMult result;
   for (auto& op : operands_) {
     Constant* constant = INodeHelper::AsConstant(op.get());
@@ -104,6 +160,7 @@ std::optional<CanonicMult> MultOperation::GetCanonicMult() {
 }
 
 std::optional<CanonicPow> MultOperation::GetCanonicPow() {
+  InvalidateCaches();
   CanonicPow result;
   result.base_nodes.reserve(operands_.size());
   for (auto& node : operands_) {
@@ -115,46 +172,12 @@ std::optional<CanonicPow> MultOperation::GetCanonicPow() {
 // static
 std::unique_ptr<INode> MultOperation::ProcessImaginary(
     std::vector<std::unique_ptr<INode>>* nodes) {
-  size_t count_i = 0;
-  for (auto& node : *nodes) {
-    if (!node->AsNodeImpl()->AsImaginary())
-      continue;
-    ++count_i;
-    if (count_i == 2)
-      break;
-  }
-  if (count_i < 2)
-    return nullptr;
-
-  count_i = 0;
-  for (auto& node : *nodes) {
-    if (!node->AsNodeImpl()->AsImaginary())
-      continue;
-    ++count_i;
-    node.reset();
-  }
+  return DoProcessImaginary(nodes);
+}
 
-  INodeHelper::RemoveEmptyOperands(nodes);
-  if (count_i >= 4) {
-    count_i = count_i % 4;
-  }
-  bool negate = false;
-  if (count_i >= 2) {
-    count_i -= 2;
-    negate = true;
-  }
-  assert(count_i == 0 || count_i == 1);
-  std::unique_ptr<INode> node;
-  if (count_i)
-    node = INodeHelper::MakeImaginary();
-  else
-    node = INodeHelper::MakeConst(1.0);
-  if (negate)
-    node = INodeHelper::Negate(std::move(node));
-  if (!nodes->empty()) {
-    nodes->push_back(std::move(node));
-  }
-  return node;
+// static
+std::unique_ptr<INode> MultOperation::ProcessImaginary(OperandsVector* nodes) {
+  return DoProcessImaginary(nodes);
 }
 
 void MultOperation::UnfoldChains(HotToken token) {
@@ -163,7 +186,7 @@ void MultOperation::UnfoldChains(HotToken token) {
 
   std::vector<std::unique_ptr<INode>> new_nodes;
   ExctractNodesWithOp(Op::Mult, &operands_, &new_nodes);
-  operands_.swap(new_nodes);
+  operands_ = OperandsVector(std::move(new_nodes));
 }
 
 void MultOperation::SimplifyUnMinus(HotToken token,
@@ -176,12 +199,13 @@ void MultOperation::SimplifyUnMinus(HotToken token,
   for (auto& node : operands_) {
     if (auto* un_minus = INodeHelper::AsUnMinus(node.get())) {
       is_positive = !is_positive;
+      InvalidateCaches();
       node = INodeHelper::Negate(std::move(node));
     }
   }
   if (!is_positive) {
     *new_node =
-        INodeHelper::MakeUnMinus(INodeHelper::MakeMult(std::move(operands_)));
+        INodeHelper::MakeUnMinus(INodeHelper::MakeMult(operands_.TakeAll()));
     return;
   }
 }
@@ -208,13 +232,14 @@ void MultOperation::SimplifyDivMul(HotToken token,
     if (auto* div = INodeHelper::AsDiv(node.get())) {
       new_bottom.push_back(
           div->TakeOperand(DivOperation::OperandIndex::Divider));
+      InvalidateCaches();
       node = div->TakeOperand(DivOperation::OperandIndex::Dividend);
     }
   }
   if (new_bottom.empty())
     return;
   *new_node = INodeHelper::MakeDiv(
-      INodeHelper::MakeMultIfNeeded(std::move(operands_)),
+      INodeHelper::MakeMultIfNeeded(operands_.TakeAll()),
       INodeHelper::MakeMultIfNeeded(std::move(new_bottom)));
 }
 
@@ -240,6 +265,7 @@ void MultOperation::SimplifyConsts(HotToken token,
     }
     // x * 1
     if (constant->Value() == 1.0) {
+      InvalidateCaches();
       node.reset();
       continue;
     }
@@ -249,6 +275,7 @@ void MultOperation::SimplifyConsts(HotToken token,
     } else {
       mult_total = op_info_->trivial_f(mult_total, constant->Value());
     }
+    InvalidateCaches();
     node.reset();
   }
   INodeHelper::RemoveEmptyOperands(&operands_);
@@ -257,12 +284,14 @@ void MultOperation::SimplifyConsts(HotToken token,
     return;
   }
 
-  if (const_count && mult_total == -1.0)
+  if (const_count && mult_total == -1.0) {
+    InvalidateCaches();
     operands_[0] = INodeHelper::MakeUnMinus(std::move(operands_[0]));
-  else if (const_count && mult_total != 1.0)
+  } else if (const_count && mult_total != 1.0)
     operands_.insert(operands_.begin(), INodeHelper::MakeConst(mult_total));
 
   if (operands_.size() == 1) {
+    InvalidateCaches();
     *new_node = std::move(operands_[0]);
     return;
   }
@@ -289,17 +318,47 @@ void MultOperation::OpenPlusBrackets(HotToken& token,
                                      std::unique_ptr<INode>* new_node) {
   if (!INodeHelper::HasAnyOperation(Op::Plus, operands_))
     return;
+
+  // Large expansions go through a polynomial that merges like terms as the
+  // product grows instead of materializing every combination of factors.
+  size_t products_count = 1;
+  for (auto& node : operands_) {
+    if (auto* plus = INodeHelper::AsPlus(node.get()))
+      products_count = std::min(products_count * plus->OperandsCount(),
+                                kPolynomialMinProducts);
+  }
+  if (products_count >= kPolynomialMinProducts &&
+      GetValueType() == ValueType::Scalar) {
+    Polynomial::Atoms atoms;
+    bool overflow = false;
+    if (auto polynomial = Polynomial::FromNode(this, &atoms, &overflow)) {
+      *new_node = polynomial->ToNode(atoms);
+      return;
+    }
+    // An exponent too large for a polynomial would be as large in the plain
+    // expansion, so the product stays folded. Imaginary and error subtrees
+    // still expand the plain way.
+    if (overflow)
+      return;
+  }
+
   auto params_change_counter = token.CountParamsChanged(this);
+  InvalidateCaches();
 
-  std::vector<std::unique_ptr<INode>> ordinal_nodes;
-  std::vector<std::vector<std::unique_ptr<INode>>> plus_nodes;
+  // Every factor lands in many products, share it instead of cloning.
+  NodeTable table;
+  std::vector<std::shared_ptr<const INode>> ordinal_nodes;
+  std::vector<std::vector<std::shared_ptr<const INode>>> plus_nodes;
   std::vector<std::pair<size_t, size_t>> permutation_indexes;
   for (auto& node : operands_) {
     if (auto* plus = INodeHelper::AsPlus(node.get())) {
       permutation_indexes.emplace_back(0, plus->OperandsCount());
-      plus_nodes.push_back(plus->TakeAllOperands());
+      std::vector<std::shared_ptr<const INode>> shared_nodes;
+      for (auto& plus_node : plus->TakeAllOperands())
+        shared_nodes.push_back(table.Intern(std::move(plus_node)));
+      plus_nodes.push_back(std::move(shared_nodes));
     } else {
-      ordinal_nodes.push_back(std::move(node));
+      ordinal_nodes.push_back(table.Intern(std::move(node)));
     }
   }
 
@@ -307,11 +366,11 @@ void MultOperation::OpenPlusBrackets(HotToken& token,
   do {
     std::vector<std::unique_ptr<INode>> mult_nodes;
     for (const auto& node : ordinal_nodes) {
-      mult_nodes.push_back(node->Clone());
+      mult_nodes.push_back(NodeTable::Instance(node));
     }
     for (size_t i = 0; i < plus_nodes.size(); ++i) {
       mult_nodes.push_back(
-          plus_nodes[i][permutation_indexes[i].first]->Clone());
+          NodeTable::Instance(plus_nodes[i][permutation_indexes[i].first]));
     }
     auto mult = INodeHelper::MakeMult(std::move(mult_nodes));
     new_plus_nodes.push_back(std::move(mult));
@@ -346,6 +405,7 @@ void MultOperation::SimplifyTheSameMult(HotToken& token,
         if (canonic_2.nodes.empty())
           continue;
 
+        InvalidateCaches();
         bool is_combined = MergeCanonicToMult(token, canonic_1, canonic_2,
                                               &operands_[i], &operands_[j]);
         if (!operands_[i])
@@ -362,6 +422,7 @@ void MultOperation::SimplifyTheSameMult(HotToken& token,
       return;
   }
   if (operands_.size() == 1) {
+    InvalidateCaches();
     *new_node = std::move(operands_[0]);
   }
   if (operands_.size() == 0) {
@@ -390,6 +451,7 @@ void MultOperation::SimplifyTheSamePow(HotToken& token,
         continue;
 
       std::vector<std::unique_ptr<INode>> new_sub_nodes;
+      InvalidateCaches();
       bool is_combined = MergeCanonicToPow(
           token, canonic_1, std::move(canonic_2), &new_sub_nodes, nullptr);
       if (is_combined) {
@@ -413,6 +475,7 @@ void MultOperation::SimplifyTheSamePow(HotToken& token,
   }
   INodeHelper::RemoveEmptyOperands(&operands_);
   if (operands_.size() == 1) {
+    InvalidateCaches();
     *new_node = std::move(operands_[0]);
     return;
   }
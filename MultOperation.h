@@ -11,10 +11,10 @@ class MultOperation : public Operation {
   std::unique_ptr<INode> Clone() const override;
 
   // INodeImpl interface
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   bool HasFrontMinus() const override;
   ValueType GetValueType() const override;
   void OpenBracketsImpl(HotToken token,
@@ -40,6 +40,7 @@ class MultOperation : public Operation {
 
   static std::unique_ptr<INode> ProcessImaginary(
       std::vector<std::unique_ptr<INode>>* nodes);
+  static std::unique_ptr<INode> ProcessImaginary(OperandsVector* nodes);
 
   INodeImpl* Operand(size_t indx) { return Operation::Operand(indx); }
   const INodeImpl* Operand(size_t indx) const {
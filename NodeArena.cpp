@@ -0,0 +1,137 @@
+#include "NodeArena.h"
+
+#include <cassert>
+#include <new>
+
+namespace {
+thread_local NodeArena* g_current_arena = nullptr;
+
+struct alignas(16) BlockHeader {
+  NodeArena* arena;
+  size_t size_class;
+};
+static_assert(sizeof(BlockHeader) == 16, "header must keep 16-byte alignment");
+
+BlockHeader* HeaderFromPtr(void* ptr) {
+  return static_cast<BlockHeader*>(ptr) - 1;
+}
+}  // namespace
+
+NodeArena::NodeArena() {}
+
+NodeArena::~NodeArena() {
+  assert(stats_.live_blocks == 0);
+  for (char* chunk : chunks_)
+    ::operator delete(chunk);
+}
+
+// static
+NodeArena* NodeArena::Create() {
+  return new NodeArena();
+}
+
+// static
+void NodeArena::AddRef(NodeArena* arena) {
+  ++arena->owners_;
+}
+
+// static
+void NodeArena::Release(NodeArena* arena) {
+  if (!arena)
+    return;
+  assert(arena->owners_ > 0);
+  --arena->owners_;
+  arena->DeleteIfUnused();
+}
+
+// static
+NodeArena* NodeArena::Current() {
+  return g_current_arena;
+}
+
+// static
+void* NodeArena::Allocate(size_t size) {
+  size_t total_size = size + sizeof(BlockHeader);
+  NodeArena* arena = g_current_arena;
+  BlockHeader* header = nullptr;
+  if (arena && total_size <= kMaxBlockSize) {
+    size_t size_class = (total_size - 1) / kGranularity;
+    header = static_cast<BlockHeader*>(arena->AllocateBlock(size_class));
+    header->arena = arena;
+    header->size_class = size_class;
+  } else {
+    header = static_cast<BlockHeader*>(::operator new(total_size));
+    header->arena = nullptr;
+    header->size_class = 0;
+  }
+  return header + 1;
+}
+
+// static
+void NodeArena::Free(void* ptr) {
+  if (!ptr)
+    return;
+  BlockHeader* header = HeaderFromPtr(ptr);
+  if (header->arena)
+    header->arena->FreeBlock(header, header->size_class);
+  else
+    ::operator delete(header);
+}
+
+void* NodeArena::AllocateBlock(size_t size_class) {
+  ++stats_.allocations;
+  ++stats_.live_blocks;
+  if (FreeListNode* block = free_lists_[size_class]) {
+    free_lists_[size_class] = block->next;
+    return block;
+  }
+  size_t block_size = (size_class + 1) * kGranularity;
+  if (chunks_.empty() || chunk_offset_ + block_size > kChunkSize) {
+    if (!chunks_.empty())
+      ++current_chunk_;
+    if (current_chunk_ == chunks_.size()) {
+      chunks_.push_back(static_cast<char*>(::operator new(kChunkSize)));
+      stats_.reserved_bytes += kChunkSize;
+    }
+    chunk_offset_ = 0;
+  }
+  void* result = chunks_[current_chunk_] + chunk_offset_;
+  chunk_offset_ += block_size;
+  return result;
+}
+
+void NodeArena::FreeBlock(void* block, size_t size_class) {
+  assert(stats_.live_blocks > 0);
+  auto* free_block = static_cast<FreeListNode*>(block);
+  free_block->next = free_lists_[size_class];
+  free_lists_[size_class] = free_block;
+  if (--stats_.live_blocks == 0) {
+    if (owners_ == 0)
+      delete this;
+    else
+      Reset();
+  }
+}
+
+void NodeArena::Reset() {
+  assert(stats_.live_blocks == 0);
+  for (auto& free_list : free_lists_)
+    free_list = nullptr;
+  current_chunk_ = 0;
+  chunk_offset_ = 0;
+  ++stats_.resets;
+}
+
+void NodeArena::DeleteIfUnused() {
+  if (owners_ == 0 && stats_.live_blocks == 0)
+    delete this;
+}
+
+ScopedNodeArena::ScopedNodeArena(NodeArena* arena)
+    : previous_(g_current_arena) {
+  g_current_arena = arena;
+}
+
+ScopedNodeArena::~ScopedNodeArena() {
+  g_current_arena = previous_;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Region allocator for expression nodes. Blocks are grouped by size class and
+// recycled through per-class free lists; chunks are only returned to the
+// system when the arena is released by all owners and no block is alive.
+// An arena is not thread-safe: all nodes allocated from it must be created
+// and destroyed on a single thread.
+class NodeArena {
+ public:
+  struct Stats {
+    size_t allocations = 0;
+    size_t live_blocks = 0;
+    size_t reserved_bytes = 0;
+    size_t resets = 0;
+  };
+
+  static NodeArena* Create();
+  static void AddRef(NodeArena* arena);
+  static void Release(NodeArena* arena);
+
+  // Arena used by INode::operator new on the current thread, may be null.
+  static NodeArena* Current();
+
+  static void* Allocate(size_t size);
+  static void Free(void* ptr);
+
+  const Stats& GetStats() const { return stats_; }
+
+ private:
+  static constexpr size_t kGranularity = 16;
+  static constexpr size_t kMaxBlockSize = 256;
+  static constexpr size_t kSizeClasses = kMaxBlockSize / kGranularity;
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  struct FreeListNode {
+    FreeListNode* next;
+  };
+
+  NodeArena();
+  NodeArena(const NodeArena&) = delete;
+  ~NodeArena();
+
+  void* AllocateBlock(size_t size_class);
+  void FreeBlock(void* block, size_t size_class);
+  void Reset();
+  void DeleteIfUnused();
+
+  std::vector<char*> chunks_;
+  size_t current_chunk_ = 0;
+  size_t chunk_offset_ = 0;
+  FreeListNode* free_lists_[kSizeClasses] = {};
+  uint32_t owners_ = 1;
+  Stats stats_;
+};
+
+// Makes |arena| current for the lifetime of the scope.
+class ScopedNodeArena {
+ public:
+  explicit ScopedNodeArena(NodeArena* arena);
+  ScopedNodeArena(const ScopedNodeArena&) = delete;
+  ~ScopedNodeArena();
+
+ private:
+  NodeArena* previous_;
+};
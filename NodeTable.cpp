@@ -0,0 +1,113 @@
+#include "NodeTable.h"
+
+#include "Constant.h"
+#include "Operation.h"
+#include "SharedNode.h"
+
+NodeTable::NodeTable() {}
+
+NodeTable::~NodeTable() {}
+
+std::shared_ptr<const INode> NodeTable::Intern(std::unique_ptr<INode> node) {
+  INodeImpl* impl = node->AsNodeImpl();
+  if (impl->AsVariable())
+    return std::shared_ptr<const INode>(node.release());
+  if (auto* shared = impl->AsSharedNode()) {
+    if (!shared->IsMaterialized())
+      return shared->Shared();
+    node = node->Clone();
+    impl = node->AsNodeImpl();
+  }
+  Operation* operation = impl->AsOperation();
+  if (!operation)
+    return std::shared_ptr<const INode>(node.release());
+
+  operation->InvalidateCaches();
+  for (auto& operand : operation->operands_) {
+    INodeImpl* operand_impl = operand->AsNodeImpl();
+    if (operand_impl->AsVariable())
+      continue;
+    if (operand_impl->AsSharedNode() || operand_impl->AsOperation())
+      operand = Instance(Intern(std::move(operand)));
+  }
+
+  uint64_t hash = impl->Hash();
+  auto range = nodes_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (IsIdentical(it->second.get(), node.get()))
+      return it->second;
+  }
+  std::shared_ptr<const INode> result(node.release());
+  nodes_.emplace(hash, result);
+  return result;
+}
+
+std::shared_ptr<const INode> NodeTable::Intern(const INode* node) {
+  auto it = borrowed_.find(node);
+  if (it != borrowed_.end())
+    return it->second;
+  auto result = Intern(node->Clone());
+  borrowed_.emplace(node, result);
+  return result;
+}
+
+// static
+std::unique_ptr<INode> NodeTable::Instance(
+    const std::shared_ptr<const INode>& node) {
+  const INodeImpl* impl = node->AsNodeImpl();
+  if (!impl->AsVariable() && !impl->AsSharedNode() && impl->AsOperation())
+    return std::make_unique<SharedNode>(node);
+  return node->Clone();
+}
+
+std::unique_ptr<INode> NodeTable::Share(const INode* node) {
+  return Instance(Intern(node));
+}
+
+// static
+const INode* NodeTable::Resolve(const INode* node) {
+  while (auto* shared = node->AsNodeImpl()->AsSharedNode()) {
+    if (shared->IsMaterialized())
+      break;
+    node = shared->Shared().get();
+  }
+  return node;
+}
+
+bool NodeTable::IsIdentical(const INode* lh, const INode* rh) const {
+  lh = Resolve(lh);
+  rh = Resolve(rh);
+  if (lh == rh)
+    return true;
+  const INodeImpl* lh_impl = lh->AsNodeImpl();
+  const INodeImpl* rh_impl = rh->AsNodeImpl();
+  if (lh_impl->GetNodeType() != rh_impl->GetNodeType())
+    return false;
+
+  const Variable* lh_variable = lh_impl->AsVariable();
+  const Variable* rh_variable = rh_impl->AsVariable();
+  if (lh_variable || rh_variable)
+    return lh_variable == rh_variable;
+
+  const Operation* lh_operation = lh_impl->AsOperation();
+  const Operation* rh_operation = rh_impl->AsOperation();
+  if (lh_operation || rh_operation) {
+    if (!lh_operation || !rh_operation)
+      return false;
+    if (lh_operation->op() != rh_operation->op() ||
+        lh_operation->OperandsCount() != rh_operation->OperandsCount()) {
+      return false;
+    }
+    for (size_t i = 0; i < lh_operation->OperandsCount(); ++i) {
+      if (!IsIdentical(lh_operation->Operand(i), rh_operation->Operand(i)))
+        return false;
+    }
+    return true;
+  }
+
+  if (lh_impl->AsConstant() && rh_impl->AsConstant())
+    return lh->Compare(rh) == CompareResult::Equal;
+  if (lh_impl->AsImaginary() && rh_impl->AsImaginary())
+    return true;
+  return false;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <unordered_map>
+
+class INode;
+
+// Hash-consing table: structurally identical Operation subtrees passed
+// through one table are stored once and handed out as SharedNode proxies, so
+// the expression becomes a DAG. Identity is strict (operand order matters),
+// unlike INode::Compare, so sharing never changes how a tree prints.
+class NodeTable {
+ public:
+  NodeTable();
+  NodeTable(const NodeTable&) = delete;
+  ~NodeTable();
+
+  std::shared_ptr<const INode> Intern(std::unique_ptr<INode> node);
+  // A node owned elsewhere is cloned at most once per table.
+  std::shared_ptr<const INode> Intern(const INode* node);
+
+  // Returns a new reference to an interned node; O(1) for operations.
+  static std::unique_ptr<INode> Instance(
+      const std::shared_ptr<const INode>& node);
+  std::unique_ptr<INode> Share(const INode* node);
+  // Follows SharedNode proxies that were not copied yet to the interned node.
+  static const INode* Resolve(const INode* node);
+
+  size_t Size() const { return nodes_.size(); }
+
+ private:
+  bool IsIdentical(const INode* lh, const INode* rh) const;
+
+  std::unordered_multimap<uint64_t, std::shared_ptr<const INode>> nodes_;
+  std::unordered_map<const INode*, std::shared_ptr<const INode>> borrowed_;
+};
@@ -6,6 +6,7 @@
 
 #include <iostream>
 
+#include "Benchmarks.h"
 #include "Brackets.h"
 #include "INode.h"
 #include "Tests.h"
@@ -126,6 +127,7 @@ void EulerEquation() {
 int main() {
   _setmode(_fileno(stdout), _O_U16TEXT);
   // Tests::Run();
+  // Benchmarks::Run();
 
   // BacMinusCab();
   // EulerEquation();
@@ -1,5 +1,7 @@
 ﻿#include "OpInfo.h"
 
+#include <math.h>
+
 #include "CompareOperation.h"
 #include "DiffOperation.h"
 #include "Exception.h"
@@ -0,0 +1,146 @@
+#include "OperandsVector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+#include "NodeArena.h"
+
+OperandsVector::OperandsVector() : data_(InlineData()) {}
+
+OperandsVector::OperandsVector(std::vector<value_type> values)
+    : data_(InlineData()) {
+  reserve(values.size());
+  for (auto& value : values)
+    new (data_ + size_++) value_type(std::move(value));
+}
+
+OperandsVector::OperandsVector(OperandsVector&& other) : data_(InlineData()) {
+  *this = std::move(other);
+}
+
+OperandsVector::~OperandsVector() {
+  owner_ = nullptr;
+  clear();
+  FreeStorage();
+}
+
+OperandsVector& OperandsVector::operator=(OperandsVector&& other) {
+  if (this == &other)
+    return *this;
+  other.InvalidateOwner();
+  InvalidateOwner();
+  clear();
+  FreeStorage();
+  if (other.IsInline()) {
+    for (size_t i = 0; i < other.size_; ++i)
+      new (data_ + i) value_type(std::move(other.data_[i]));
+    size_ = other.size_;
+    other.clear();
+  } else {
+    data_ = other.data_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    other.data_ = other.InlineData();
+    other.size_ = 0;
+    other.capacity_ = kInlineCapacity;
+  }
+  return *this;
+}
+
+void OperandsVector::push_back(value_type value) {
+  InvalidateOwner();
+  if (size_ == capacity_)
+    Grow(size_ + 1);
+  new (data_ + size_) value_type(std::move(value));
+  ++size_;
+}
+
+OperandsVector::iterator OperandsVector::insert(const_iterator pos,
+                                                value_type value) {
+  size_t indx = pos - data_;
+  assert(indx <= size_);
+  push_back(nullptr);
+  std::move_backward(data_ + indx, data_ + size_ - 1, data_ + size_);
+  data_[indx] = std::move(value);
+  return data_ + indx;
+}
+
+OperandsVector::iterator OperandsVector::erase(const_iterator first,
+                                               const_iterator last) {
+  size_t from = first - data_;
+  size_t to = last - data_;
+  assert(from <= to && to <= size_);
+  if (from == to)
+    return data_ + from;
+  InvalidateOwner();
+  std::move(data_ + to, data_ + size_, data_ + from);
+  resize(size_ - (to - from));
+  return data_ + from;
+}
+
+void OperandsVector::resize(size_t size) {
+  if (size == size_)
+    return;
+  InvalidateOwner();
+  reserve(size);
+  for (size_t i = size; i < size_; ++i)
+    data_[i].~value_type();
+  for (size_t i = size_; i < size; ++i)
+    new (data_ + i) value_type();
+  size_ = static_cast<uint32_t>(size);
+}
+
+void OperandsVector::reserve(size_t capacity) {
+  if (capacity > capacity_)
+    Grow(capacity);
+}
+
+void OperandsVector::clear() {
+  resize(0);
+}
+
+void OperandsVector::swap(OperandsVector& other) {
+  OperandsVector temp(std::move(other));
+  other = std::move(*this);
+  *this = std::move(temp);
+}
+
+std::vector<OperandsVector::value_type> OperandsVector::TakeAll() {
+  InvalidateOwner();
+  std::vector<value_type> result;
+  result.reserve(size_);
+  for (auto& value : *this)
+    result.push_back(std::move(value));
+  clear();
+  return result;
+}
+
+OperandsVector::value_type* OperandsVector::InlineData() {
+  return reinterpret_cast<value_type*>(inline_);
+}
+
+const OperandsVector::value_type* OperandsVector::InlineData() const {
+  return reinterpret_cast<const value_type*>(inline_);
+}
+
+void OperandsVector::Grow(size_t min_capacity) {
+  size_t capacity = std::max<size_t>(min_capacity, capacity_ * 2);
+  auto* data = static_cast<value_type*>(
+      NodeArena::Allocate(capacity * sizeof(value_type)));
+  for (size_t i = 0; i < size_; ++i) {
+    new (data + i) value_type(std::move(data_[i]));
+    data_[i].~value_type();
+  }
+  FreeStorage();
+  data_ = data;
+  capacity_ = static_cast<uint32_t>(capacity);
+}
+
+void OperandsVector::FreeStorage() {
+  if (IsInline())
+    return;
+  NodeArena::Free(data_);
+  data_ = InlineData();
+  capacity_ = kInlineCapacity;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "INode.h"
+#include "INodeImpl.h"
+
+// Operand storage of Operation. Up to kInlineCapacity operands live inside the
+// node itself, larger lists spill to a block from the current NodeArena. The
+// interface mirrors the subset of std::vector used by the operations.
+// Changing the list drops the cached values of the owner. Element access
+// doesn't: callers that replace or move out an operand in place call
+// InvalidateOwner() first.
+class OperandsVector {
+ public:
+  using value_type = std::unique_ptr<INode>;
+  using iterator = value_type*;
+  using const_iterator = const value_type*;
+
+  static constexpr size_t kInlineCapacity = 3;
+
+  OperandsVector();
+  explicit OperandsVector(std::vector<value_type> values);
+  OperandsVector(OperandsVector&& other);
+  OperandsVector(const OperandsVector&) = delete;
+  ~OperandsVector();
+  OperandsVector& operator=(OperandsVector&& other);
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return capacity_; }
+  bool IsInline() const { return data_ == InlineData(); }
+
+  value_type& operator[](size_t indx) { return data_[indx]; }
+  const value_type& operator[](size_t indx) const { return data_[indx]; }
+  value_type& front() { return data_[0]; }
+  value_type& back() { return data_[size_ - 1]; }
+
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+
+  void push_back(value_type value);
+  iterator insert(const_iterator pos, value_type value);
+  iterator erase(const_iterator first, const_iterator last);
+  void resize(size_t size);
+  void reserve(size_t capacity);
+  void clear();
+  void swap(OperandsVector& other);
+
+  // Moves all operands out, leaving the container empty.
+  std::vector<value_type> TakeAll();
+
+  // The node whose caches follow the operands. It is kept by assignments.
+  void SetOwner(const INodeImpl* owner) { owner_ = owner; }
+  void InvalidateOwner() {
+    if (owner_)
+      owner_->InvalidateCaches();
+  }
+
+ private:
+  value_type* InlineData();
+  const value_type* InlineData() const;
+  void Grow(size_t min_capacity);
+  void FreeStorage();
+
+  value_type* data_;
+  const INodeImpl* owner_ = nullptr;
+  uint32_t size_ = 0;
+  uint32_t capacity_ = kInlineCapacity;
+  alignas(value_type) unsigned char inline_[kInlineCapacity *
+                                            sizeof(value_type)];
+};
@@ -2,10 +2,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <map>
 #include <numeric>
 #include <optional>
 #include <sstream>
+#include <type_traits>
 
 #include "Brackets.h"
 #include "Constant.h"
@@ -17,8 +20,11 @@
 #include "Operation.h"
 #include "Sequence.h"
 #include "SimplifyHelpers.h"
+#include "SimplifyProfile.h"
+#include "SqrtOperation.h"
 #include "UnMinusOperation.h"
 #include "ValueHelpers.h"
+#include "Variable.h"
 
 class HotTokenHelper {
  public:
@@ -26,24 +32,43 @@ class HotTokenHelper {
 };
 
 namespace {
-using SimplificatorFunc = void (*)(HotToken& token,
-                                   Operation* operation,
-                                   std::unique_ptr<INode>* new_node);
-void ApplySimplification(HotToken token,
-                         SimplificatorFunc simplificator,
-                         std::vector<std::unique_ptr<INode>>* operands) {
-  for (auto& node : *operands) {
-    if (Operation* operation = INodeHelper::AsOperation(node.get())) {
-      operation->CheckIntegrity();
-      std::unique_ptr<INode> new_sub_node;
-      simplificator(token, operation, &new_sub_node);
-      if (new_sub_node)
-        node = std::move(new_sub_node);
-      if (Operation* op = INodeHelper::AsOperation(node.get()))
-        op->CheckIntegrity();
-    }
+using SimplificatorFunc = Operation::SimplificatorFunc;
+
+thread_local uint32_t g_normal_form_epoch = 1;
+// Counts structural rewrites, including the ones a pass does not report
+// through its HotToken. A pass left a subtree alone only if neither this
+// counter nor the token's changes moved while it ran.
+thread_local uint64_t g_rewrites_count = 0;
+
+// Names of the simplificators of Operation::SimplifyImpl, in their order. A
+// rule that runs twice is told apart by its position.
+constexpr const char* kSimplificatorNames[] = {
+    "SimplifyUnMinus", "SimplifyDivDiv",  "UnfoldChains",
+    "SimplifyChains",  "SimplifyDivMul",  "SimplifyDivDiv#2",
+    "SimplifyConsts",  "SimplifyTheSame", "SimplifyConsts#2",
+    "OrderOperands",
+};
+static_assert(std::extent<decltype(kSimplificatorNames)>::value ==
+                  SimplifyProfile::kRulesCount,
+              "the profile keeps a row per simplificator");
+
+// Runs |simplificator| and records it in |rule|. Restarts are counted by the
+// caller, which knows whether the replacement is still an operation.
+void ProfileSimplificator(SimplifyProfile::RuleStats* rule,
+                          SimplificatorFunc simplificator,
+                          HotToken& token,
+                          Operation* current,
+                          std::unique_ptr<INode>* new_node) {
+  uint32_t changes_count = token.GetChangesCount();
+  uint64_t rewrites_count = g_rewrites_count;
+  auto start = std::chrono::steady_clock::now();
+  simplificator(token, current, new_node);
+  rule->time += std::chrono::steady_clock::now() - start;
+  ++rule->invocations;
+  if (*new_node || changes_count != token.GetChangesCount() ||
+      rewrites_count != g_rewrites_count) {
+    ++rule->hits;
   }
-  HotTokenHelper::Disarm(&token);
 }
 
 void ApplySimplifications(HotToken token,
@@ -52,22 +77,34 @@ void ApplySimplifications(HotToken token,
                           Operation* current,
                           std::unique_ptr<INode>* new_node) {
   current->CheckIntegrity();
+  SimplifyProfile* profile = SimplifyProfile::Current();
+  if (profile)
+    profile->AddCall();
   for (const SimplificatorFunc* it = begin; it != end; ++it) {
     std::unique_ptr<INode> temp_node;
-    (*it)(token, current, &temp_node);
+    SimplifyProfile::RuleStats* rule = nullptr;
+    if (profile) {
+      size_t indx = it - begin;
+      rule = profile->Rule(indx, kSimplificatorNames[indx]);
+      ProfileSimplificator(rule, *it, token, current, &temp_node);
+    } else {
+      (*it)(token, current, &temp_node);
+    }
     if (temp_node) {
       *new_node = std::move(temp_node);
       current = INodeHelper::AsOperation(new_node->get());
       if (!current)
         break;
+      if (rule)
+        ++rule->restarts;
       it = begin;
     }
     current->CheckIntegrity();
   }
 }
 
-bool IsAllOperandsConst(SymCalcSettings settings,
-                        const std::vector<std::unique_ptr<INode>>& operands) {
+template <typename Operands>
+bool IsAllOperandsConst(SymCalcSettings settings, const Operands& operands) {
   for (const auto& operand : operands) {
     Constant* constant = operand->AsNodeImpl()->AsConstant();
     if (!constant)
@@ -78,15 +115,23 @@ bool IsAllOperandsConst(SymCalcSettings settings,
   return true;
 }
 
-std::vector<std::unique_ptr<INode>> CalcOperands(
-    SymCalcSettings settings,
-    const std::vector<std::unique_ptr<INode>>& operands) {
-  std::vector<std::unique_ptr<INode>> result;
-  result.reserve(operands.size());
-  for (const auto& operand : operands) {
-    result.push_back(operand->SymCalc(settings));
+// Ops SymCalcValue() folds through trivial_f once all operands are
+// constants; their calc_f only handles vectors and the imaginary unit.
+bool IsFoldedOp(Op op) {
+  switch (op) {
+    case Op::UnMinus:
+    case Op::Plus:
+    case Op::Mult:
+    case Op::Div:
+    case Op::Pow:
+    case Op::Sqrt:
+    case Op::Sin:
+    case Op::Cos:
+    case Op::Log:
+      return true;
+    default:
+      return false;
   }
-  return result;
 }
 
 std::unique_ptr<INode> SymCalcValue(
@@ -170,6 +215,7 @@ std::unique_ptr<INode> SymCalcValue(
 
 Operation::Operation(const OpInfo* op_info, std::unique_ptr<INode> lh)
     : op_info_(op_info) {
+  operands_.SetOwner(this);
   operands_.push_back(std::move(lh));
   CheckIntegrity();
 }
@@ -178,7 +224,7 @@ Operation::Operation(const OpInfo* op_info,
                      std::unique_ptr<INode> lh,
                      std::unique_ptr<INode> rh)
     : op_info_(op_info) {
-  operands_.reserve(2);
+  operands_.SetOwner(this);
   operands_.push_back(std::move(lh));
   operands_.push_back(std::move(rh));
   CheckIntegrity();
@@ -187,6 +233,7 @@ Operation::Operation(const OpInfo* op_info,
 Operation::Operation(const OpInfo* op_info,
                      std::vector<std::unique_ptr<INode>> operands)
     : op_info_(op_info), operands_(std::move(operands)) {
+  operands_.SetOwner(this);
   CheckIntegrity();
 }
 
@@ -195,8 +242,63 @@ int Operation::Priority() const {
 }
 
 std::unique_ptr<INode> Operation::SymCalc(SymCalcSettings settings) const {
-  std::vector<std::unique_ptr<INode>> calculated_operands =
-      CalcOperands(settings, operands_);
+  double value;
+  auto result = CalcImpl(settings, &value);
+  if (!result)
+    return INodeHelper::MakeConst(value);
+  return result;
+}
+
+std::unique_ptr<INode> Operation::CalcImpl(SymCalcSettings settings,
+                                           double* value) const {
+  bool is_numeric = IsFoldedOp(op_info_->op) && !operands_.empty();
+  double folded = 0.0;
+  double sqrt_value = 0.0;
+  std::vector<std::unique_ptr<INode>> calculated_operands;
+  for (size_t i = 0; i < operands_.size(); ++i) {
+    double operand_value;
+    auto operand = CalcOperand(operands_[i].get(), settings, &operand_value);
+    if (is_numeric && !operand) {
+      // The same order of operations as SymCalcValue().
+      if (op_info_->op == Op::Sqrt) {
+        if (i == 0)
+          sqrt_value = operand_value;
+        else
+          folded = operand_value;
+      } else if (i == 0) {
+        folded = operand_value;
+        if (operands_.size() == 1 && op_info_->operands_count == 1)
+          folded = op_info_->trivial_f(folded, 0.0);
+      } else {
+        folded = op_info_->trivial_f(folded, operand_value);
+      }
+      continue;
+    }
+    if (is_numeric) {
+      is_numeric = false;
+      calculated_operands.reserve(operands_.size());
+      for (size_t j = 0; j < i; ++j)
+        calculated_operands.push_back(operands_[j]->SymCalc(settings));
+    }
+    calculated_operands.push_back(
+        operand ? std::move(operand) : INodeHelper::MakeConst(operand_value));
+  }
+
+  if (is_numeric && op_info_->op == Op::Sqrt) {
+    // Even roots calculate to both signs.
+    if (operands_.size() == 2 && std::fmod(folded, 2.0) != 0.0) {
+      *value = TrivialSqrt(sqrt_value, folded);
+      return nullptr;
+    }
+    is_numeric = false;
+    for (const auto& operand : operands_)
+      calculated_operands.push_back(operand->SymCalc(settings));
+  }
+  if (is_numeric) {
+    *value = folded;
+    return nullptr;
+  }
+
   auto result =
       SymCalcValue(op_info_, std::move(calculated_operands), settings);
   if (auto* as_seq = INodeHelper::AsSequence(result.get())) {
@@ -208,6 +310,28 @@ std::unique_ptr<INode> Operation::SymCalc(SymCalcSettings settings) const {
   return result;
 }
 
+// static
+std::unique_ptr<INode> Operation::CalcOperand(const INode* node,
+                                              SymCalcSettings settings,
+                                              double* value) {
+  const INodeImpl* impl = node->AsNodeImpl();
+  if (const Operation* operation = impl->AsOperation())
+    return operation->CalcImpl(settings, value);
+  if (const Constant* constant = impl->AsConstant()) {
+    if (!constant->IsNamed() && !constant->IsBool()) {
+      *value = constant->Value();
+      return nullptr;
+    }
+  }
+  if (const Brackets* brackets = impl->AsBrackets())
+    return CalcOperand(brackets->Value(), settings, value);
+  if (const Variable* variable = impl->AsVariable()) {
+    if (variable->Value())
+      return CalcOperand(variable->Value(), settings, value);
+  }
+  return node->SymCalc(settings);
+}
+
 PrintSize Operation::LastPrintSize() const {
   return print_size_;
 }
@@ -244,6 +368,30 @@ CompareResult Operation::Compare(const INode* rh) const {
   return CompareResult::Equal;
 }
 
+uint64_t Operation::ComputeHash() const {
+  uint64_t result = HashCombine(INodeImpl::ComputeHash(), OperandsCount());
+  if (op_info_->is_transitive) {
+    // Order-insensitive, matching IsNodesTransitiveEqual.
+    uint64_t sum = 0;
+    for (const auto& operand : operands_)
+      sum += ChildHash(operand.get());
+    return HashCombine(result, sum);
+  }
+  for (const auto& operand : operands_)
+    result = HashCombine(result, ChildHash(operand.get()));
+  return result;
+}
+
+void Operation::CollectFreeVariables(SymbolSet* result) const {
+  for (const auto& operand : operands_)
+    result->InsertAll(ChildFreeVariables(operand.get()));
+}
+
+void Operation::ForgetChildren() const {
+  for (const auto& operand : operands_)
+    ForgetChild(operand.get());
+}
+
 void Operation::SimplifyImpl(HotToken token, std::unique_ptr<INode>* new_node) {
   SimplificatorFunc simplificators[] = {
       [](HotToken& token, Operation* current,
@@ -285,6 +433,9 @@ void Operation::SimplifyImpl(HotToken token, std::unique_ptr<INode>* new_node) {
         current->OrderOperands({&token});
       },
   };
+  static_assert(std::extent<decltype(simplificators)>::value ==
+                    std::extent<decltype(kSimplificatorNames)>::value,
+                "every simplificator needs a name");
   ApplySimplifications({&token}, std::begin(simplificators),
                        std::end(simplificators), this, new_node);
 }
@@ -296,8 +447,10 @@ void Operation::OpenBracketsImpl(HotToken token,
   for (auto& node : operands_) {
     std::unique_ptr<INode> temp_node;
     node->AsNodeImpl()->OpenBracketsImpl({&token}, &temp_node);
-    if (temp_node)
+    if (temp_node) {
+      InvalidateCaches();
       node = std::move(temp_node);
+    }
   }
 }
 
@@ -306,8 +459,10 @@ void Operation::ConvertToComplexImpl(HotToken token,
   for (auto& node : operands_) {
     std::unique_ptr<INode> temp_node;
     node->AsNodeImpl()->ConvertToComplexImpl({&token}, &temp_node);
-    if (temp_node)
+    if (temp_node) {
+      InvalidateCaches();
       node = std::move(temp_node);
+    }
   }
 }
 
@@ -334,7 +489,7 @@ void Operation::CheckIntegrity() const {
 
 void Operation::UnfoldChains(HotToken token) {
   ApplySimplification(
-      {&token},
+      {&token}, Pass::UnfoldChains,
       [](HotToken& token, Operation* current,
          std::unique_ptr<INode>* new_node) { current->UnfoldChains({&token}); },
       &operands_);
@@ -343,7 +498,7 @@ void Operation::UnfoldChains(HotToken token) {
 void Operation::SimplifyUnMinus(HotToken token,
                                 std::unique_ptr<INode>* new_node) {
   ApplySimplification(
-      {&token},
+      {&token}, Pass::SimplifyUnMinus,
       [](HotToken& token, Operation* operation,
          std::unique_ptr<INode>* new_node) {
         operation->SimplifyUnMinus({&token}, new_node);
@@ -354,19 +509,21 @@ void Operation::SimplifyUnMinus(HotToken token,
 void Operation::SimplifyChains(HotToken token,
                                std::unique_ptr<INode>* new_node) {
   ApplySimplification(
-      {&token},
+      {&token}, Pass::SimplifyChains,
       [](HotToken& token, Operation* operation,
          std::unique_ptr<INode>* new_node) {
         operation->SimplifyChains({&token}, new_node);
       },
       &operands_);
-  if (operands_.size() == 1 && op_info_->operands_count == -1)
+  if (operands_.size() == 1 && op_info_->operands_count == -1) {
+    InvalidateCaches();
     *new_node = std::move(operands_[0]);
+  }
 }
 
 void Operation::SimplifyDivDiv(HotToken token) {
   ApplySimplification(
-      {&token},
+      {&token}, Pass::SimplifyDivDiv,
       [](HotToken& token, Operation* current,
          std::unique_ptr<INode>* new_node) {
         current->SimplifyDivDiv({&token});
@@ -377,7 +534,7 @@ void Operation::SimplifyDivDiv(HotToken token) {
 void Operation::SimplifyDivMul(HotToken token,
                                std::unique_ptr<INode>* new_node) {
   ApplySimplification(
-      {&token},
+      {&token}, Pass::SimplifyDivMul,
       [](HotToken& token, Operation* operation,
          std::unique_ptr<INode>* new_node) {
         operation->SimplifyDivMul({&token}, new_node);
@@ -388,7 +545,7 @@ void Operation::SimplifyDivMul(HotToken token,
 void Operation::SimplifyConsts(HotToken token,
                                std::unique_ptr<INode>* new_node) {
   ApplySimplification(
-      {&token},
+      {&token}, Pass::SimplifyConsts,
       [](HotToken& token, Operation* operation,
          std::unique_ptr<INode>* new_node) {
         operation->SimplifyConsts({&token}, new_node);
@@ -404,7 +561,7 @@ void Operation::SimplifyConsts(HotToken token,
 void Operation::SimplifyTheSame(HotToken token,
                                 std::unique_ptr<INode>* new_node) {
   ApplySimplification(
-      {&token},
+      {&token}, Pass::SimplifyTheSame,
       [](HotToken& token, Operation* operation,
          std::unique_ptr<INode>* new_node) {
         operation->SimplifyTheSame({&token}, new_node);
@@ -414,7 +571,7 @@ void Operation::SimplifyTheSame(HotToken token,
 
 void Operation::OrderOperands(HotToken token) {
   ApplySimplification(
-      {&token},
+      {&token}, Pass::OrderOperands,
       [](HotToken& token, Operation* operation,
          std::unique_ptr<INode>* new_node) {
         operation->OrderOperands({&token});
@@ -426,21 +583,92 @@ Op Operation::op() const {
   return op_info_->op;
 }
 
+bool Operation::IsNormalForm() const {
+  constexpr uint32_t kAllPasses = (1u << static_cast<int>(Pass::Count)) - 1;
+  return normal_form_epoch_ == g_normal_form_epoch &&
+         clean_passes_ == kAllPasses;
+}
+
+// static
+void Operation::NewNormalFormEpoch() {
+  ++g_normal_form_epoch;
+}
+
+// static
+void Operation::ApplySimplification(HotToken token,
+                                    Pass pass,
+                                    SimplificatorFunc simplificator,
+                                    OperandsVector* operands) {
+  for (auto& node : *operands) {
+    if (Operation* operation = INodeHelper::AsOperation(node.get())) {
+      if (operation->IsNormalForm())
+        continue;
+      operation->CheckIntegrity();
+      uint32_t changes_count = token.GetChangesCount();
+      uint64_t rewrites_count = g_rewrites_count;
+      uint64_t fingerprint = operation->OperandsFingerprint();
+      std::unique_ptr<INode> new_sub_node;
+      simplificator(token, operation, &new_sub_node);
+      if (new_sub_node) {
+        operands->InvalidateOwner();
+        node = std::move(new_sub_node);
+        ++g_rewrites_count;
+      } else if (changes_count != token.GetChangesCount() ||
+                 rewrites_count != g_rewrites_count ||
+                 fingerprint != operation->OperandsFingerprint()) {
+        operation->MarkDirty();
+      } else {
+        operation->MarkPassClean(pass);
+      }
+      if (Operation* op = INodeHelper::AsOperation(node.get()))
+        op->CheckIntegrity();
+    }
+  }
+  HotTokenHelper::Disarm(&token);
+}
+
+void Operation::MarkDirty() {
+  clean_passes_ = 0;
+  ++g_rewrites_count;
+}
+
+uint64_t Operation::OperandsFingerprint() const {
+  uint64_t result = OperandsCount();
+  for (const auto& operand : operands_) {
+    result = HashCombine(result,
+                         reinterpret_cast<uintptr_t>(operand.get()));
+  }
+  return result;
+}
+
+void Operation::MarkPassClean(Pass pass) {
+  if (normal_form_epoch_ != g_normal_form_epoch) {
+    normal_form_epoch_ = g_normal_form_epoch;
+    clean_passes_ = 0;
+  }
+  clean_passes_ |= 1u << static_cast<int>(pass);
+}
+
 size_t Operation::OperandsCount() const {
   return operands_.size();
 }
 
 std::unique_ptr<INode> Operation::TakeOperand(size_t indx) {
+  MarkDirty();
+  InvalidateCaches();
   return std::move(operands_[indx]);
 }
 
 void Operation::SetOperand(size_t indx, std::unique_ptr<INode> node) {
+  MarkDirty();
+  InvalidateCaches();
   operands_[indx] = std::move(node);
 }
 
 std::vector<std::unique_ptr<INode>> Operation::TakeAllOperands() {
+  MarkDirty();
   is_dead_ = true;
-  return std::move(operands_);
+  return operands_.TakeAll();
 }
 
 INodeImpl* Operation::Operand(size_t indx) {
@@ -1,4 +1,5 @@
 #pragma once
+#include <stdint.h>
 
 #include <memory>
 #include <optional>
@@ -8,9 +9,26 @@
 #include "INodeImpl.h"
 #include "IOperation.h"
 #include "OpInfo.h"
+#include "OperandsVector.h"
 
 class Operation : public IOperation {
  public:
+  using SimplificatorFunc = void (*)(HotToken& token,
+                                     Operation* operation,
+                                     std::unique_ptr<INode>* new_node);
+  // Passes applied by SimplifyImpl.
+  enum class Pass : uint8_t {
+    UnfoldChains,
+    SimplifyUnMinus,
+    SimplifyChains,
+    SimplifyDivDiv,
+    SimplifyDivMul,
+    SimplifyConsts,
+    SimplifyTheSame,
+    OrderOperands,
+    Count,
+  };
+
   Operation(const OpInfo* op_info, std::unique_ptr<INode> lh);
   Operation(const OpInfo* op_info,
             std::unique_ptr<INode> lh,
@@ -57,9 +75,25 @@ class Operation : public IOperation {
   size_t OperandsCount() const;
   void CheckIntegrity() const;
 
+  // A subtree on which every pass ran without changing it is in normal form
+  // and is skipped by later passes until it is rewritten. The state is only
+  // trusted within one normal-form epoch; Variable::Simplify starts a new one.
+  bool IsNormalForm() const;
+  static void NewNormalFormEpoch();
+
  protected:
+  friend class BinaryWriter;
+  friend class CompiledExpression;
   friend class Tests;
   friend class INodeHelper;
+  friend class NodeTable;
+  friend class Serializer;
+  friend class SharedNode;
+  friend class Variable;
+
+  uint64_t ComputeHash() const override;
+  void CollectFreeVariables(SymbolSet* result) const override;
+  void ForgetChildren() const override;
 
   INodeImpl* Operand(size_t indx);
   const INodeImpl* Operand(size_t indx) const;
@@ -67,6 +101,14 @@ class Operation : public IOperation {
   void SetOperand(size_t indx, std::unique_ptr<INode> node);
   std::vector<std::unique_ptr<INode>> TakeAllOperands();
 
+  // Applies |simplificator| to every operation operand that is not already in
+  // normal form and records the outcome per operand.
+  static void ApplySimplification(HotToken token,
+                                  Pass pass,
+                                  SimplificatorFunc simplificator,
+                                  OperandsVector* operands);
+  void MarkDirty();
+
   PrintSize RenderOperandChain(Canvas* canvas,
                                PrintBox print_box,
                                bool dry_run,
@@ -81,5 +123,20 @@ class Operation : public IOperation {
   bool is_dead_ = false;
   const OpInfo* op_info_;
   mutable PrintSize print_size_;
-  std::vector<std::unique_ptr<INode>> operands_;
+  OperandsVector operands_;
+
+ private:
+  // Calculates the subtree like SymCalc(). Returns nullptr and sets |value|
+  // if it folds to an unnamed constant: numeric subtrees allocate no nodes,
+  // Constant nodes are only made where they meet symbolic operands.
+  std::unique_ptr<INode> CalcImpl(SymCalcSettings settings,
+                                  double* value) const;
+  static std::unique_ptr<INode> CalcOperand(const INode* node,
+                                            SymCalcSettings settings,
+                                            double* value);
+  uint64_t OperandsFingerprint() const;
+  void MarkPassClean(Pass pass);
+
+  uint32_t normal_form_epoch_ = 0;
+  uint32_t clean_passes_ = 0;
 };
@@ -0,0 +1,445 @@
+﻿#include "Parser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+#include "CompareOperation.h"
+#include "Constant.h"
+#include "DiffOperation.h"
+#include "DivOperation.h"
+#include "INodeHelper.h"
+#include "Imaginary.h"
+#include "LogOperation.h"
+#include "MultOperation.h"
+#include "OpInfo.h"
+#include "PlusOperation.h"
+#include "PowOperation.h"
+#include "Sequence.h"
+#include "SqrtOperation.h"
+#include "TrigonometricOperation.h"
+#include "UnMinusOperation.h"
+#include "Utf8.h"
+#include "ValueHelpers.h"
+#include "Variable.h"
+#include "VariableRef.h"
+#include "VariableScope.h"
+#include "Vector.h"
+#include "VectorMultOperation.h"
+
+namespace {
+// Bounds the recursion on nested brackets and prefix minuses.
+constexpr int kMaxDepth = 1000;
+
+bool IsNameChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+int GetPriority(Op op) {
+  return GetOpInfo(op)->priority;
+}
+}  // namespace
+
+Parser::Parser(VariableScope* scope) : scope_(scope) {}
+
+Parser::~Parser() {}
+
+std::unique_ptr<INode> Parser::Parse(std::string_view text) {
+  begin_ = pos_ = text.data();
+  end_ = text.data() + text.size();
+  depth_ = 0;
+  error_.clear();
+  error_offset_ = 0;
+  Next();
+  auto result = ParseExpression(0);
+  if (!result)
+    return nullptr;
+  if (token_ != Token::End)
+    return Fail("unexpected text after the expression");
+  return result;
+}
+
+void Parser::Next() {
+  while (pos_ != end_ &&
+         (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\r' || *pos_ == '\n')) {
+    ++pos_;
+  }
+  token_begin_ = pos_;
+  if (pos_ == end_) {
+    token_ = Token::End;
+    return;
+  }
+
+  const char c = *pos_;
+  if (IsDigit(c) || (c == '.' && pos_ + 1 != end_ && IsDigit(pos_[1]))) {
+    auto result = std::from_chars(pos_, end_, number_);
+    if (result.ec == std::errc())
+      token_ = Token::Number;
+    else if (result.ec == std::errc::result_out_of_range)
+      token_ = Token::OutOfRange;
+    else
+      token_ = Token::Invalid;
+    pos_ = result.ptr;
+    return;
+  }
+  if (IsNameChar(c)) {
+    ReadName();
+    return;
+  }
+
+  ++pos_;
+  switch (c) {
+    case '+':
+      token_ = Token::Plus;
+      return;
+    case '-':
+      token_ = Token::Minus;
+      return;
+    case '*':
+      token_ = Token::Mult;
+      return;
+    case '/':
+      token_ = Token::Div;
+      return;
+    case '^':
+      token_ = Token::Pow;
+      return;
+    case '(':
+      token_ = Token::OpenRound;
+      return;
+    case ')':
+      token_ = Token::CloseRound;
+      return;
+    case '[':
+      token_ = Token::OpenSquare;
+      return;
+    case ']':
+      token_ = Token::CloseSquare;
+      return;
+    case '{':
+      token_ = Token::OpenFigure;
+      return;
+    case '}':
+      token_ = Token::CloseFigure;
+      return;
+    case ',':
+      token_ = Token::Comma;
+      return;
+    case '=':
+      if (pos_ != end_ && *pos_ == '=') {
+        ++pos_;
+        token_ = Token::Equal;
+      } else {
+        token_ = Token::Invalid;
+      }
+      return;
+  }
+
+  // Operators written with non-ASCII signs, everything else starts a name.
+  pos_ = token_begin_;
+  const char* next = pos_;
+  switch (DecodeUtf8(&next, end_)) {
+    case U'×':
+      token_ = Token::VectorMult;
+      break;
+    case U'∙':
+    case U'·':
+    case U'⋅':
+      token_ = Token::Mult;
+      break;
+    case U'−':
+      token_ = Token::Minus;
+      break;
+    case kInvalidCodePoint:
+      token_ = Token::Invalid;
+      return;
+    default:
+      ReadName();
+      return;
+  }
+  pos_ = next;
+}
+
+void Parser::ReadName() {
+  name_.clear();
+  while (pos_ != end_) {
+    if (IsNameChar(*pos_)) {
+      name_.push_back(static_cast<wchar_t>(*pos_++));
+      continue;
+    }
+    if (static_cast<unsigned char>(*pos_) < 0x80)
+      break;
+    const char* next = pos_;
+    char32_t code_point = DecodeUtf8(&next, end_);
+    if (code_point == kInvalidCodePoint || code_point == U'×' ||
+        code_point == U'∙' || code_point == U'·' || code_point == U'⋅' ||
+        code_point == U'−') {
+      break;
+    }
+    AppendCodePoint(code_point, &name_);
+    pos_ = next;
+  }
+  token_ = name_.empty() ? Token::Invalid : Token::Name;
+}
+
+bool Parser::Expect(Token token, const char* message) {
+  if (token_ != token) {
+    Fail(message);
+    return false;
+  }
+  Next();
+  return true;
+}
+
+std::nullptr_t Parser::Fail(const char* message) {
+  if (error_.empty()) {
+    if (token_ == Token::Invalid)
+      error_ = "invalid character";
+    else if (token_ == Token::OutOfRange)
+      error_ = "number out of range";
+    else
+      error_ = message;
+    error_offset_ = token_begin_ - begin_;
+  }
+  return nullptr;
+}
+
+std::unique_ptr<INode> Parser::ParseExpression(int priority) {
+  if (depth_ == kMaxDepth)
+    return Fail("expression is nested too deep");
+  ++depth_;
+  auto result = ParseOperators(priority);
+  --depth_;
+  return result;
+}
+
+std::unique_ptr<INode> Parser::ParseOperators(int priority) {
+  std::unique_ptr<INode> lh = ParseOperand(priority);
+  while (lh) {
+    switch (token_) {
+      case Token::Plus:
+      case Token::Minus:
+        if (GetPriority(Op::Plus) <= priority)
+          return lh;
+        lh = ParseSum(std::move(lh), GetPriority(Op::Plus));
+        break;
+      case Token::Mult:
+      case Token::Div:
+      case Token::VectorMult:
+        if (GetPriority(Op::Mult) <= priority)
+          return lh;
+        lh = ParseProduct(std::move(lh), GetPriority(Op::Mult));
+        break;
+      case Token::Pow: {
+        if (GetPriority(Op::Pow) <= priority)
+          return lh;
+        Next();
+        // a^b^c is a^(b^c).
+        auto rh = ParseExpression(GetPriority(Op::Pow) - 1);
+        if (!rh)
+          return nullptr;
+        lh = INodeHelper::MakePow(std::move(lh), std::move(rh));
+        break;
+      }
+      case Token::Equal: {
+        if (GetPriority(Op::Equal) <= priority)
+          return lh;
+        Next();
+        auto rh = ParseExpression(GetPriority(Op::Equal));
+        if (!rh)
+          return nullptr;
+        lh = INodeHelper::MakeCompare(Op::Equal, std::move(lh), std::move(rh));
+        break;
+      }
+      default:
+        return lh;
+    }
+  }
+  return lh;
+}
+
+std::unique_ptr<INode> Parser::ParseSum(std::unique_ptr<INode> lh,
+                                        int priority) {
+  std::vector<std::unique_ptr<INode>> operands;
+  operands.push_back(std::move(lh));
+  while (token_ == Token::Plus || token_ == Token::Minus) {
+    bool minus = token_ == Token::Minus;
+    Next();
+    auto rh = ParseExpression(priority);
+    if (!rh)
+      return nullptr;
+    operands.push_back(minus ? INodeHelper::MakeUnMinus(std::move(rh))
+                             : std::move(rh));
+  }
+  return INodeHelper::MakePlus(std::move(operands));
+}
+
+std::unique_ptr<INode> Parser::ParseProduct(std::unique_ptr<INode> lh,
+                                            int priority) {
+  // Division and vector product apply to the whole product on their left:
+  // a*b/c is (a*b)/c.
+  std::vector<std::unique_ptr<INode>> operands;
+  operands.push_back(std::move(lh));
+  while (token_ == Token::Mult || token_ == Token::Div ||
+         token_ == Token::VectorMult) {
+    Token op = token_;
+    Next();
+    auto rh = ParseExpression(priority);
+    if (!rh)
+      return nullptr;
+    if (op == Token::Mult) {
+      operands.push_back(std::move(rh));
+      continue;
+    }
+    auto product = INodeHelper::MakeMultIfNeeded(std::move(operands));
+    operands.clear();
+    if (op == Token::Div) {
+      operands.push_back(
+          INodeHelper::MakeDiv(std::move(product), std::move(rh)));
+    } else {
+      operands.push_back(
+          INodeHelper::MakeVectorMult(std::move(product), std::move(rh)));
+    }
+  }
+  return INodeHelper::MakeMultIfNeeded(std::move(operands));
+}
+
+std::unique_ptr<INode> Parser::ParseOperand(int priority) {
+  switch (token_) {
+    case Token::Number: {
+      auto result = INodeHelper::MakeConst(number_);
+      Next();
+      return result;
+    }
+    case Token::Name:
+      return ParseName();
+    case Token::Plus:
+    case Token::Minus: {
+      bool minus = token_ == Token::Minus;
+      Next();
+      // -a*b is -(a*b), but a^-b*c is a^(-b)*c.
+      auto operand =
+          ParseExpression(std::max(priority, GetPriority(Op::UnMinus)));
+      if (!operand || !minus)
+        return operand;
+      const Constant* constant = INodeHelper::AsConstant(operand.get());
+      if (constant && !constant->IsNamed() && !constant->IsBool())
+        return INodeHelper::MakeConst(-constant->Value());
+      return INodeHelper::MakeUnMinus(std::move(operand));
+    }
+    case Token::OpenRound: {
+      Next();
+      auto result = ParseExpression(0);
+      if (!result || !Expect(Token::CloseRound, "expected ')'"))
+        return nullptr;
+      return result;
+    }
+    case Token::OpenSquare: {
+      Next();
+      std::vector<std::unique_ptr<INode>> values;
+      if (!ParseList(Token::CloseSquare, &values))
+        return nullptr;
+      return INodeHelper::MakeVector(std::move(values));
+    }
+    case Token::OpenFigure: {
+      Next();
+      std::vector<std::unique_ptr<INode>> values;
+      if (!ParseList(Token::CloseFigure, &values))
+        return nullptr;
+      auto sequence = INodeHelper::MakeSequence();
+      for (auto& value : values)
+        sequence->AddValue(std::move(value));
+      return sequence;
+    }
+    default:
+      return Fail("expected an operand");
+  }
+}
+
+std::unique_ptr<INode> Parser::ParseName() {
+  if (name_ == L"e" || name_ == L"π" || name_ == L"pi" || name_ == L"i" ||
+      name_ == L"True" || name_ == L"False" || name_ == L"inf" ||
+      name_ == L"nan") {
+    std::unique_ptr<INode> result;
+    if (name_ == L"e")
+      result = Constants::MakeE();
+    else if (name_ == L"i")
+      result = INodeHelper::MakeImaginary();
+    else if (name_ == L"True" || name_ == L"False")
+      result = INodeHelper::MakeConst(name_ == L"True");
+    else if (name_ == L"inf" || name_ == L"nan")
+      result = INodeHelper::MakeConst(name_ == L"inf" ? INFINITY : NAN);
+    else
+      result = Constants::MakePI();
+    Next();
+    return result;
+  }
+
+  const char* name_begin = token_begin_;
+  std::wstring name = name_;
+  Next();
+  if (token_ != Token::OpenRound)
+    return std::make_unique<VariableRef>(scope_->Get(name));
+
+  Next();
+  std::vector<std::unique_ptr<INode>> args;
+  if (!ParseList(Token::CloseRound, &args))
+    return nullptr;
+  auto result = ParseFunction(name, std::move(args));
+  if (!result && error_.empty()) {
+    error_ = "unknown function or wrong number of arguments";
+    error_offset_ = name_begin - begin_;
+  }
+  return result;
+}
+
+std::unique_ptr<INode> Parser::ParseFunction(
+    const std::wstring& name,
+    std::vector<std::unique_ptr<INode>> args) {
+  if (args.size() == 1) {
+    if (name == L"sin" || name == L"cos") {
+      return INodeHelper::MakeTrigonometric(name == L"sin" ? Op::Sin : Op::Cos,
+                                            std::move(args[0]));
+    }
+    if (name == L"sqrt") {
+      return INodeHelper::MakeSqrt(std::move(args[0]),
+                                   INodeHelper::MakeConst(2.0));
+    }
+    if (name == L"ln" || name == L"log")
+      return INodeHelper::MakeLog(Constants::MakeE(), std::move(args[0]));
+  } else if (args.size() == 2) {
+    if (name == L"root" || name == L"sqrt")
+      return INodeHelper::MakeSqrt(std::move(args[0]), std::move(args[1]));
+    if (name == L"log")
+      return INodeHelper::MakeLog(std::move(args[0]), std::move(args[1]));
+    if (name == L"diff") {
+      const Variable* var = args[1]->AsNodeImpl()->AsVariable();
+      if (!var || var->GetName().empty())
+        return nullptr;
+      return INodeHelper::MakeDiff(std::move(args[0]),
+                                   std::make_unique<VariableRef>(var));
+    }
+  }
+  return nullptr;
+}
+
+bool Parser::ParseList(Token close,
+                       std::vector<std::unique_ptr<INode>>* values) {
+  for (;;) {
+    auto value = ParseExpression(0);
+    if (!value)
+      return false;
+    values->push_back(std::move(value));
+    if (token_ != Token::Comma)
+      break;
+    Next();
+  }
+  return Expect(close, close == Token::CloseRound ? "expected ')'"
+                       : close == Token::CloseSquare ? "expected ']'"
+                                                     : "expected '}'");
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class INode;
+class VariableScope;
+
+// Builds expressions from UTF-8 text in the infix syntax Serializer writes:
+//   a + b - c   a*b/c   a × b   a^b   -a   a == b   (a)
+//   [a, b, c]   {a, b}   vector and sequence
+//   sin(a) cos(a) sqrt(a) root(a, n) ln(a) log(base, a) diff(a, x)
+// The names e, π, pi, i, True, False, inf and nan are constants, other names
+// are variables of the scope. Tokens are read one at a time as the parser asks
+// for them and nodes are made by INodeHelper as soon as they are complete.
+class Parser {
+ public:
+  explicit Parser(VariableScope* scope);
+  Parser(const Parser&) = delete;
+  ~Parser();
+
+  // Returns nullptr if |text| is not one expression, see Error().
+  std::unique_ptr<INode> Parse(std::string_view text);
+  const std::string& Error() const { return error_; }
+  // Offset in bytes of the token where the error was found.
+  size_t ErrorOffset() const { return error_offset_; }
+
+ private:
+  enum class Token {
+    End,
+    Number,
+    Name,
+    Plus,
+    Minus,
+    Mult,
+    Div,
+    VectorMult,
+    Pow,
+    Equal,
+    OpenRound,
+    CloseRound,
+    OpenSquare,
+    CloseSquare,
+    OpenFigure,
+    CloseFigure,
+    Comma,
+    Invalid,
+    // A number literal that doesn't fit a double.
+    OutOfRange,
+  };
+
+  void Next();
+  void ReadName();
+  bool Expect(Token token, const char* message);
+  std::nullptr_t Fail(const char* message);
+
+  // Operands bind tighter than |priority|, see OpInfo::priority.
+  std::unique_ptr<INode> ParseExpression(int priority);
+  std::unique_ptr<INode> ParseOperators(int priority);
+  std::unique_ptr<INode> ParseSum(std::unique_ptr<INode> lh, int priority);
+  std::unique_ptr<INode> ParseProduct(std::unique_ptr<INode> lh,
+                                      int priority);
+  std::unique_ptr<INode> ParseOperand(int priority);
+  std::unique_ptr<INode> ParseName();
+  std::unique_ptr<INode> ParseFunction(
+      const std::wstring& name,
+      std::vector<std::unique_ptr<INode>> args);
+  bool ParseList(Token close, std::vector<std::unique_ptr<INode>>* values);
+
+  VariableScope* scope_;
+  const char* begin_ = nullptr;
+  const char* pos_ = nullptr;
+  const char* end_ = nullptr;
+  Token token_ = Token::End;
+  const char* token_begin_ = nullptr;
+  double number_ = 0;
+  std::wstring name_;
+  int depth_ = 0;
+  std::string error_;
+  size_t error_offset_ = 0;
+};
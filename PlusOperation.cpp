@@ -2,15 +2,28 @@
 
 #include <algorithm>
 #include <cassert>
+#include <unordered_map>
 
 #include "Constant.h"
 #include "DivOperation.h"
 #include "INodeHelper.h"
 #include "MultOperation.h"
+#include "NodeTable.h"
 #include "OpInfo.h"
 #include "SimplifyHelpers.h"
 #include "UnMinusOperation.h"
 
+namespace {
+// Order independent key of the non-constant part of a term. Terms that
+// MergeCanonicToPlus is able to combine always have the same key.
+uint64_t CanonicKey(const CanonicMult& canonic) {
+  uint64_t result = 0;
+  for (auto* node : canonic.nodes)
+    result += (*node)->AsNodeImpl()->Hash();
+  return result;
+}
+}  // namespace
+
 PlusOperation::PlusOperation(std::unique_ptr<INode> lh,
                              std::unique_ptr<INode> rh)
     : Operation(GetOpInfo(Op::Plus), std::move(lh), std::move(rh)) {}
@@ -26,10 +39,10 @@ std::unique_ptr<INode> PlusOperation::Clone() const {
   return INodeHelper::MakePlus(std::move(new_nodes));
 }
 
-PrintSize PlusOperation::Render(Canvas* canvas,
-                                PrintBox print_box,
-                                bool dry_run,
-                                RenderBehaviour render_behaviour) const {
+PrintSize PlusOperation::RenderImpl(Canvas* canvas,
+                                    PrintBox print_box,
+                                    bool dry_run,
+                                    RenderBehaviour render_behaviour) const {
   return print_size_ =
              RenderOperandChain(canvas, print_box, dry_run, render_behaviour);
 }
@@ -44,7 +57,7 @@ void PlusOperation::UnfoldChains(HotToken token) {
   auto operands_count = OperandsCount();
   std::vector<std::unique_ptr<INode>> new_nodes;
   ExctractNodesWithOp(Op::Plus, &operands_, &new_nodes);
-  operands_.swap(new_nodes);
+  operands_ = OperandsVector(std::move(new_nodes));
   if (operands_count != OperandsCount())
     token.SetChanged();
   CheckIntegrity();
@@ -65,6 +78,7 @@ void PlusOperation::SimplifyConsts(HotToken token,
     if (!constant)
       continue;
     if (constant->Value() == 0.0) {
+      InvalidateCaches();
       node.reset();
       continue;
     }
@@ -75,6 +89,7 @@ void PlusOperation::SimplifyConsts(HotToken token,
       continue;
     }
     total_summ = op_info_->trivial_f(total_summ, constant->Value());
+    InvalidateCaches();
     if (first_const)
       first_const->reset();
     node.reset();
@@ -88,6 +103,7 @@ void PlusOperation::SimplifyConsts(HotToken token,
   if (const_count > 1 && total_summ != 0.0)
     operands_.push_back(INodeHelper::MakeConst(total_summ));
   if (operands_.size() == 1) {
+    InvalidateCaches();
     *new_node = std::move(operands_[0]);
     return;
   }
@@ -98,34 +114,53 @@ void PlusOperation::SimplifyTheSame(HotToken token,
   Operation::SimplifyTheSame({&token}, nullptr);
   auto params_change_counter = token.CountParamsChanged(this);
 
+  struct Term {
+    size_t indx;
+    CanonicMult canonic;
+  };
+  // Every term is merged into the first live term equal to it, so the
+  // operands keep the order they had with pairwise comparison.
+  auto insert_term = [](std::vector<Term>* terms, Term term) {
+    auto pos = std::find_if(
+        terms->begin(), terms->end(),
+        [&term](const Term& other) { return other.indx > term.indx; });
+    terms->insert(pos, std::move(term));
+  };
+
   bool need_try = true;
   while (need_try) {
     need_try = false;
-    for (size_t i = 0; i < operands_.size(); ++i) {
-      if (!operands_[i])
+    std::unordered_map<uint64_t, std::vector<Term>> buckets;
+    for (size_t j = 0; j < operands_.size(); ++j) {
+      if (!operands_[j])
         continue;
-      CanonicMult canonic_1 = INodeHelper::GetCanonicMult(operands_[i]);
-      if (canonic_1.nodes.empty()) {
+      CanonicMult canonic = INodeHelper::GetCanonicMult(operands_[j]);
+      if (canonic.nodes.empty()) {
         // skip constants.
         continue;
       }
 
-      for (size_t j = i + 1; j < operands_.size(); ++j) {
-        if (!operands_[j])
+      uint64_t key = CanonicKey(canonic);
+      auto& terms = buckets[key];
+      bool is_combined = false;
+      for (auto it = terms.begin(); it != terms.end(); ++it) {
+        InvalidateCaches();
+        if (!MergeCanonicToPlus(token, it->canonic, canonic,
+                                &operands_[it->indx], &operands_[j])) {
           continue;
-        CanonicMult canonic_2 = INodeHelper::GetCanonicMult(operands_[j]);
-        if (canonic_2.nodes.empty())
-          continue;
-
-        bool is_combined = MergeCanonicToPlus(token, canonic_1, canonic_2,
-                                              &operands_[i], &operands_[j]);
-        if (!operands_[i])
-          break;
-        if (is_combined) {
-          need_try = true;
-          canonic_1 = INodeHelper::GetCanonicMult(operands_[i]);
         }
+        is_combined = true;
+        need_try = true;
+        Term term{it->indx, {}};
+        terms.erase(it);
+        if (operands_[term.indx]) {
+          term.canonic = INodeHelper::GetCanonicMult(operands_[term.indx]);
+          insert_term(&buckets[CanonicKey(term.canonic)], std::move(term));
+        }
+        break;
       }
+      if (!is_combined)
+        terms.push_back({j, std::move(canonic)});
     }
     INodeHelper::RemoveEmptyOperands(&operands_);
     if (operands_.empty())
@@ -136,6 +171,7 @@ void PlusOperation::SimplifyTheSame(HotToken token,
   }
 
   if (operands_.size() == 1) {
+    InvalidateCaches();
     *new_node = std::move(operands_[0]);
     return;
   }
@@ -159,11 +195,12 @@ void PlusOperation::OpenBracketsImpl(HotToken token,
     return;
   auto params_change_counter = token.CountParamsChanged(this);
 
-  std::vector<std::pair<size_t, std::unique_ptr<INode>>> dividers;
+  NodeTable table;
+  std::vector<std::pair<size_t, std::shared_ptr<const INode>>> dividers;
   for (size_t i = 0; i < OperandsCount(); ++i) {
     if (auto* as_div = INodeHelper::AsDiv(Operand(i))) {
-      dividers.emplace_back(
-          i, as_div->TakeOperand(DivOperation::OperandIndex::Divider));
+      dividers.emplace_back(i, table.Intern(as_div->TakeOperand(
+                                   DivOperation::OperandIndex::Divider)));
     }
   }
 
@@ -181,14 +218,14 @@ void PlusOperation::OpenBracketsImpl(HotToken token,
     for (auto& divider : dividers) {
       if (i == divider.first)
         continue;
-      dividents.push_back(divider.second->Clone());
+      dividents.push_back(NodeTable::Instance(divider.second));
     }
     new_dividents.push_back(
         INodeHelper::MakeMultIfNeeded(std::move(dividents)));
   }
   std::vector<std::unique_ptr<INode>> new_dividerss;
   for (auto& divider : dividers) {
-    new_dividerss.push_back(std::move(divider.second));
+    new_dividerss.push_back(NodeTable::Instance(divider.second));
   }
 
   std::unique_ptr<INode> new_div = INodeHelper::MakeDiv(
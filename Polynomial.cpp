@@ -0,0 +1,291 @@
+#include "Polynomial.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Constant.h"
+#include "INodeHelper.h"
+#include "MultOperation.h"
+#include "PlusOperation.h"
+#include "PowOperation.h"
+#include "UnMinusOperation.h"
+
+namespace {
+constexpr uint64_t kHighBits = 0x8000800080008000ull;
+constexpr uint64_t kExponentMask = 0xffff;
+
+bool IsNaturalConst(const INode* node, double max_value) {
+  const Constant* constant = INodeHelper::AsConstant(node);
+  if (!constant || constant->IsNamed() || constant->IsBool())
+    return false;
+  double value = constant->Value();
+  double int_part;
+  return value >= 0.0 && value <= max_value &&
+         std::modf(value, &int_part) == 0.0;
+}
+}  // namespace
+
+Polynomial::Atoms::Atoms() {}
+
+Polynomial::Atoms::~Atoms() {}
+
+size_t Polynomial::Atoms::Intern(const INode* node) {
+  uint64_t hash = node->AsNodeImpl()->Hash();
+  auto range = indexes_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (nodes_[it->second]->Compare(node) == CompareResult::Equal)
+      return it->second;
+  }
+  nodes_.push_back(node->Clone());
+  indexes_.emplace(hash, nodes_.size() - 1);
+  return nodes_.size() - 1;
+}
+
+std::unique_ptr<INode> Polynomial::Atoms::Instance(size_t indx) const {
+  return nodes_[indx]->Clone();
+}
+
+Polynomial::Polynomial() {}
+
+Polynomial::Polynomial(Polynomial&& other) = default;
+
+Polynomial::~Polynomial() {}
+
+Polynomial& Polynomial::operator=(Polynomial&& other) = default;
+
+// static
+std::optional<Polynomial> Polynomial::FromNode(const INode* node,
+                                               Atoms* atoms,
+                                               bool* overflow) {
+  bool ignored_overflow;
+  if (!overflow)
+    overflow = &ignored_overflow;
+  *overflow = false;
+
+  const INodeImpl* impl = node->AsNodeImpl();
+  if (impl->GetValueType() != ValueType::Scalar || impl->AsImaginary() ||
+      impl->AsError()) {
+    return std::nullopt;
+  }
+  if (impl->AsVariable())
+    return FromAtom(atoms->Intern(node));
+
+  if (const Constant* constant = INodeHelper::AsConstant(node)) {
+    if (!constant->IsNamed() && !constant->IsBool())
+      return FromConst(constant->Value());
+    return FromAtom(atoms->Intern(node));
+  }
+
+  if (const auto* plus = INodeHelper::AsPlus(node)) {
+    Polynomial result;
+    for (size_t i = 0; i < plus->OperandsCount(); ++i) {
+      auto operand = FromNode(plus->Operand(i), atoms, overflow);
+      if (!operand)
+        return std::nullopt;
+      result.Add(*operand);
+    }
+    return result;
+  }
+
+  if (const auto* mult = INodeHelper::AsMult(node)) {
+    Polynomial result = FromConst(1.0);
+    for (size_t i = 0; i < mult->OperandsCount(); ++i) {
+      auto operand = FromNode(mult->Operand(i), atoms, overflow);
+      if (!operand)
+        return std::nullopt;
+      auto product = result.Mult(*operand);
+      if (!product) {
+        *overflow = true;
+        return std::nullopt;
+      }
+      result = std::move(*product);
+    }
+    return result;
+  }
+
+  if (const auto* un_minus = INodeHelper::AsUnMinus(node)) {
+    auto operand = FromNode(un_minus->Operand(), atoms, overflow);
+    if (!operand)
+      return std::nullopt;
+    Polynomial result;
+    result.Add(*operand, -1.0);
+    return result;
+  }
+
+  if (const auto* pow = INodeHelper::AsPow(node)) {
+    // Powers of sums that OpenBrackets keeps folded stay atoms.
+    if (IsNaturalConst(pow->Exp(), kMaxExponent)) {
+      auto base = FromNode(pow->Base(), atoms, overflow);
+      if (!base)
+        return std::nullopt;
+      if (base->TermsCount() <= 1) {
+        auto result = base->Pow(static_cast<uint32_t>(
+            INodeHelper::AsConstant(pow->Exp())->Value()));
+        *overflow = !result;
+        return result;
+      }
+    }
+  }
+
+  return FromAtom(atoms->Intern(node));
+}
+
+// static
+Polynomial Polynomial::FromConst(double value) {
+  Polynomial result;
+  result.AddTerm(Monomial(), value);
+  return result;
+}
+
+// static
+Polynomial Polynomial::FromAtom(size_t indx) {
+  Monomial monomial(indx / kExponentsPerWord + 1);
+  monomial.back() = uint64_t(1) << (indx % kExponentsPerWord * kExponentBits);
+  Polynomial result;
+  result.AddTerm(std::move(monomial), 1.0);
+  return result;
+}
+
+void Polynomial::Add(const Polynomial& rh, double factor) {
+  for (const auto& term : rh.terms_)
+    AddTerm(term.first, term.second * factor);
+}
+
+std::optional<Polynomial> Polynomial::Mult(const Polynomial& rh) const {
+  Polynomial result;
+  result.terms_.reserve(terms_.size() * rh.terms_.size());
+  for (const auto& lh_term : terms_) {
+    for (const auto& rh_term : rh.terms_) {
+      auto monomial = MultMonomials(lh_term.first, rh_term.first);
+      if (!monomial)
+        return std::nullopt;
+      result.AddTerm(std::move(*monomial), lh_term.second * rh_term.second);
+    }
+  }
+  return result;
+}
+
+std::optional<Polynomial> Polynomial::Pow(uint32_t exp) const {
+  Polynomial result = FromConst(1.0);
+  Polynomial base;
+  base.terms_ = terms_;
+  while (exp) {
+    if (exp & 1) {
+      auto product = result.Mult(base);
+      if (!product)
+        return std::nullopt;
+      result = std::move(*product);
+    }
+    exp >>= 1;
+    if (exp) {
+      auto square = base.Mult(base);
+      if (!square)
+        return std::nullopt;
+      base = std::move(*square);
+    }
+  }
+  return result;
+}
+
+std::unique_ptr<INode> Polynomial::ToNode(const Atoms& atoms) const {
+  struct Term {
+    const Monomial* monomial;
+    double coefficient;
+    uint32_t degree;
+  };
+  std::vector<Term> terms;
+  terms.reserve(terms_.size());
+  for (const auto& term : terms_) {
+    uint32_t degree = 0;
+    for (size_t i = 0; i < atoms.Size(); ++i)
+      degree += Exponent(term.first, i);
+    terms.push_back({&term.first, term.second, degree});
+  }
+  // Graded lexicographic order, the same for every run.
+  std::sort(terms.begin(), terms.end(),
+            [&atoms](const Term& lh, const Term& rh) {
+              if (lh.degree != rh.degree)
+                return lh.degree > rh.degree;
+              for (size_t i = 0; i < atoms.Size(); ++i) {
+                uint32_t lh_exp = Exponent(*lh.monomial, i);
+                uint32_t rh_exp = Exponent(*rh.monomial, i);
+                if (lh_exp != rh_exp)
+                  return lh_exp > rh_exp;
+              }
+              return false;
+            });
+
+  std::vector<std::unique_ptr<INode>> plus_nodes;
+  plus_nodes.reserve(terms.size());
+  for (const auto& term : terms) {
+    std::vector<std::unique_ptr<INode>> mult_nodes;
+    for (size_t i = 0; i < atoms.Size(); ++i) {
+      uint32_t exp = Exponent(*term.monomial, i);
+      if (exp)
+        mult_nodes.push_back(INodeHelper::MakePowIfNeeded(atoms.Instance(i),
+                                                          exp));
+    }
+    if (mult_nodes.empty()) {
+      plus_nodes.push_back(INodeHelper::MakeConst(term.coefficient));
+    } else if (term.coefficient == -1.0) {
+      plus_nodes.push_back(INodeHelper::Negate(
+          INodeHelper::MakeMultIfNeeded(std::move(mult_nodes))));
+    } else {
+      if (term.coefficient != 1.0) {
+        mult_nodes.insert(mult_nodes.begin(),
+                          INodeHelper::MakeConst(term.coefficient));
+      }
+      plus_nodes.push_back(INodeHelper::MakeMultIfNeeded(std::move(mult_nodes)));
+    }
+  }
+  if (plus_nodes.empty())
+    return INodeHelper::MakeConst(0.0);
+  return INodeHelper::MakePlusIfNeeded(std::move(plus_nodes));
+}
+
+size_t Polynomial::MonomialHash::operator()(const Monomial& monomial) const {
+  uint64_t result = 0;
+  for (uint64_t word : monomial) {
+    result ^= word + 0x9e3779b97f4a7c15ull + (result << 6) + (result >> 2);
+  }
+  return static_cast<size_t>(result);
+}
+
+// static
+uint32_t Polynomial::Exponent(const Monomial& monomial, size_t indx) {
+  size_t word = indx / kExponentsPerWord;
+  if (word >= monomial.size())
+    return 0;
+  size_t shift = indx % kExponentsPerWord * kExponentBits;
+  return static_cast<uint32_t>((monomial[word] >> shift) & kExponentMask);
+}
+
+// static
+std::optional<Polynomial::Monomial> Polynomial::MultMonomials(
+    const Monomial& lh,
+    const Monomial& rh) {
+  const Monomial& longer = lh.size() >= rh.size() ? lh : rh;
+  const Monomial& shorter = lh.size() >= rh.size() ? rh : lh;
+  Monomial result(longer);
+  for (size_t i = 0; i < shorter.size(); ++i) {
+    // Add all exponents of the word at once, a carry out of any field means
+    // that exponent exceeds kMaxExponent.
+    uint64_t lh_high = longer[i] & kHighBits;
+    uint64_t rh_high = shorter[i] & kHighBits;
+    uint64_t low = (longer[i] & ~kHighBits) + (shorter[i] & ~kHighBits);
+    uint64_t carry = (lh_high & rh_high) | ((lh_high | rh_high) & low);
+    if (carry & kHighBits)
+      return std::nullopt;
+    result[i] = low ^ lh_high ^ rh_high;
+  }
+  return result;
+}
+
+void Polynomial::AddTerm(Monomial monomial, double coefficient) {
+  if (coefficient == 0.0)
+    return;
+  auto it = terms_.emplace(std::move(monomial), 0.0).first;
+  it->second += coefficient;
+  if (it->second == 0.0)
+    terms_.erase(it);
+}
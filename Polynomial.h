@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+class INode;
+
+// Sparse multivariate polynomial with numeric coefficients. Any scalar
+// subtree that is not a sum, product, negation or natural power is an atom;
+// equal atoms share one variable. The exponents of a monomial are packed 16
+// bits per variable, so multiplying monomials is a word-wise addition, and
+// like terms are merged as soon as they are produced.
+class Polynomial {
+ public:
+  // Variables of the polynomials built from one expression.
+  class Atoms {
+   public:
+    Atoms();
+    Atoms(const Atoms&) = delete;
+    ~Atoms();
+
+    size_t Intern(const INode* node);
+    std::unique_ptr<INode> Instance(size_t indx) const;
+    size_t Size() const { return nodes_.size(); }
+
+   private:
+    std::vector<std::unique_ptr<INode>> nodes_;
+    std::unordered_multimap<uint64_t, size_t> indexes_;
+  };
+
+  static constexpr uint32_t kMaxExponent = 65535;
+
+  Polynomial();
+  Polynomial(Polynomial&& other);
+  ~Polynomial();
+  Polynomial& operator=(Polynomial&& other);
+
+  // Returns nullopt if |node| is not a scalar polynomial expression or an
+  // exponent outgrows kMaxExponent. |overflow|, if given, tells which.
+  static std::optional<Polynomial> FromNode(const INode* node,
+                                            Atoms* atoms,
+                                            bool* overflow = nullptr);
+  static Polynomial FromConst(double value);
+  static Polynomial FromAtom(size_t indx);
+
+  size_t TermsCount() const { return terms_.size(); }
+
+  void Add(const Polynomial& rh, double factor = 1.0);
+  // Fails if an exponent outgrows kMaxExponent.
+  std::optional<Polynomial> Mult(const Polynomial& rh) const;
+  std::optional<Polynomial> Pow(uint32_t exp) const;
+
+  std::unique_ptr<INode> ToNode(const Atoms& atoms) const;
+
+ private:
+  using Monomial = std::vector<uint64_t>;
+  struct MonomialHash {
+    size_t operator()(const Monomial& monomial) const;
+  };
+
+  static constexpr size_t kExponentBits = 16;
+  static constexpr size_t kExponentsPerWord = 64 / kExponentBits;
+
+  static uint32_t Exponent(const Monomial& monomial, size_t indx);
+  static std::optional<Monomial> MultMonomials(const Monomial& lh,
+                                               const Monomial& rh);
+  void AddTerm(Monomial monomial, double coefficient);
+
+  std::unordered_map<Monomial, double, MonomialHash> terms_;
+};
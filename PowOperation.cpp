@@ -35,10 +35,10 @@ std::unique_ptr<INode> PowOperation::Clone() const {
                                         operands_[1]->Clone());
 }
 
-PrintSize PowOperation::Render(Canvas* canvas,
-                               PrintBox print_box,
-                               bool dry_run,
-                               RenderBehaviour render_behaviour) const {
+PrintSize PowOperation::RenderImpl(Canvas* canvas,
+                                   PrintBox print_box,
+                                   bool dry_run,
+                                   RenderBehaviour render_behaviour) const {
   auto base_render_behaviour = render_behaviour;
   render_behaviour.TakeMinus();
   auto* is_base_pow = INodeHelper::AsPow(Base());
@@ -115,7 +115,7 @@ void PowOperation::OpenBracketsImpl(HotToken token,
   }
   std::unique_ptr<INode> new_temp_node;
   {
-    auto temp_node = INodeHelper::MakeMultIfNeeded(std::move(operands_));
+    auto temp_node = INodeHelper::MakeMultIfNeeded(operands_.TakeAll());
     temp_node->AsNodeImpl()->OpenBracketsImpl({&token}, &new_temp_node);
     if (!new_temp_node)
       new_temp_node = std::move(temp_node);
@@ -129,6 +129,8 @@ std::optional<CanonicPow> PowOperation::GetCanonicPow() {
   auto* exp_const = INodeHelper::AsConstant(operands_[1].get());
   if (!exp_const || exp_const->IsNamed())
     return std::nullopt;
+  // The base may be written through the result.
+  InvalidateCaches();
   CanonicPow result = INodeHelper::GetCanonicPow(operands_[0]);
   for (auto& node_info : result.base_nodes)
     node_info.exp_up *= exp_const->Value();
@@ -0,0 +1,203 @@
+#include "RandomExpression.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include "CompareOperation.h"
+#include "Constant.h"
+#include "DiffOperation.h"
+#include "DivOperation.h"
+#include "INodeHelper.h"
+#include "LogOperation.h"
+#include "MultOperation.h"
+#include "PlusOperation.h"
+#include "PowOperation.h"
+#include "Sequence.h"
+#include "SqrtOperation.h"
+#include "TrigonometricOperation.h"
+#include "UnMinusOperation.h"
+#include "ValueHelpers.h"
+#include "Variable.h"
+#include "VariableRef.h"
+#include "VariableScope.h"
+#include "Vector.h"
+#include "VectorMultOperation.h"
+
+RandomExpressionOptions::RandomExpressionOptions() {
+  std::fill(std::begin(op_weights), std::end(op_weights), 0.0);
+  Weight(Op::UnMinus) = 1;
+  Weight(Op::Minus) = 1;
+  Weight(Op::Plus) = 3;
+  Weight(Op::Mult) = 3;
+  Weight(Op::Div) = 1;
+  Weight(Op::Pow) = 1;
+  Weight(Op::Sqrt) = 0.5;
+  Weight(Op::Sin) = 0.5;
+  Weight(Op::Cos) = 0.5;
+  Weight(Op::Log) = 0.5;
+}
+
+RandomExpression::RandomExpression(const RandomExpressionOptions& options,
+                                   VariableScope* scope)
+    : options_(options), state_(options.seed) {
+  for (size_t i = 0; i < options_.variables_count; ++i)
+    variables_.push_back(scope->Get(L"x" + std::to_wstring(i)));
+  if (variables_.empty())
+    options_.Weight(Op::Diff) = 0;
+  options_.max_fan_out = std::max<size_t>(options_.max_fan_out, 2);
+  options_.max_integer = std::max(options_.max_integer, 1);
+  options_.max_exponent = std::max(options_.max_exponent, 2);
+  for (double weight : options_.op_weights)
+    total_weight_ += std::max(weight, 0.0);
+}
+
+RandomExpression::~RandomExpression() = default;
+
+std::unique_ptr<INode> RandomExpression::Generate() {
+  if (NextBool(options_.vector_probability)) {
+    return INodeHelper::MakeVector(
+        MakeOperands(std::max<size_t>(options_.vector_dimension, 1), 1));
+  }
+  if (NextBool(options_.sequence_probability)) {
+    auto sequence = INodeHelper::MakeSequence();
+    size_t count = NextInt(1, static_cast<int>(options_.max_fan_out));
+    for (auto& value : MakeOperands(count, 1))
+      sequence->AddValue(std::move(value));
+    return sequence;
+  }
+  return MakeScalar(0);
+}
+
+// SplitMix64, the same sequence on every platform unlike the engines and
+// distributions of <random>.
+uint64_t RandomExpression::Next() {
+  uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+double RandomExpression::NextDouble() {
+  return static_cast<double>(Next() >> 11) * (1.0 / (1ull << 53));
+}
+
+int RandomExpression::NextInt(int from, int to) {
+  uint64_t range = static_cast<uint64_t>(to - from) + 1;
+  return from + static_cast<int>(Next() % range);
+}
+
+bool RandomExpression::NextBool(double probability) {
+  return probability > 0 && NextDouble() < probability;
+}
+
+std::unique_ptr<INode> RandomExpression::MakeScalar(size_t depth) {
+  if (depth >= options_.max_depth || total_weight_ <= 0 ||
+      (depth > 0 && NextBool(options_.leaf_probability))) {
+    return MakeLeaf();
+  }
+  const int max_fan_out = static_cast<int>(options_.max_fan_out);
+  Op op = NextOp();
+  switch (op) {
+    case Op::UnMinus:
+      return INodeHelper::MakeUnMinus(MakeScalar(depth + 1));
+    case Op::Minus: {
+      auto lh = MakeScalar(depth + 1);
+      return INodeHelper::MakeMinus(std::move(lh), MakeScalar(depth + 1));
+    }
+    case Op::Plus:
+      return INodeHelper::MakePlus(
+          MakeOperands(NextInt(2, max_fan_out), depth + 1));
+    case Op::Mult:
+      return INodeHelper::MakeMult(
+          MakeOperands(NextInt(2, max_fan_out), depth + 1));
+    case Op::VectorMult: {
+      auto a = MakeVector3(depth + 1);
+      auto b = MakeVector3(depth + 1);
+      auto c = MakeVector3(depth + 1);
+      auto product = INodeHelper::MakeVectorMult(std::move(b), std::move(c));
+      return INodeHelper::MakeMult(std::move(a), std::move(product));
+    }
+    case Op::Div: {
+      auto lh = MakeScalar(depth + 1);
+      return INodeHelper::MakeDiv(std::move(lh), MakeScalar(depth + 1));
+    }
+    case Op::Pow: {
+      auto base = MakeScalar(depth + 1);
+      return INodeHelper::MakePow(
+          std::move(base),
+          INodeHelper::MakeConst(
+              static_cast<double>(NextInt(2, options_.max_exponent))));
+    }
+    case Op::Sqrt: {
+      auto value = MakeScalar(depth + 1);
+      return INodeHelper::MakeSqrt(
+          std::move(value),
+          INodeHelper::MakeConst(static_cast<double>(NextInt(2, 3))));
+    }
+    case Op::Sin:
+    case Op::Cos:
+      return INodeHelper::MakeTrigonometric(op, MakeScalar(depth + 1));
+    case Op::Log:
+      return INodeHelper::MakeLog(Constants::MakeE(), MakeScalar(depth + 1));
+    case Op::Equal: {
+      auto lh = MakeScalar(depth + 1);
+      return INodeHelper::MakeCompare(Op::Equal, std::move(lh),
+                                      MakeScalar(depth + 1));
+    }
+    case Op::Diff: {
+      auto value = MakeScalar(depth + 1);
+      const Variable* var = variables_[Next() % variables_.size()];
+      return INodeHelper::MakeDiff(std::move(value),
+                                   std::make_unique<VariableRef>(var));
+    }
+  }
+  return MakeLeaf();
+}
+
+std::unique_ptr<INode> RandomExpression::MakeLeaf() {
+  if (variables_.empty() || NextBool(options_.constant_probability))
+    return MakeConstant();
+  return std::make_unique<VariableRef>(
+      variables_[Next() % variables_.size()]);
+}
+
+std::unique_ptr<INode> RandomExpression::MakeConstant() {
+  double value = NextInt(1, options_.max_integer);
+  if (options_.max_integer > 1 && NextBool(options_.fraction_probability))
+    value /= NextInt(2, options_.max_integer);
+  if (NextBool(options_.negative_probability))
+    value = -value;
+  return INodeHelper::MakeConst(value);
+}
+
+std::unique_ptr<INode> RandomExpression::MakeVector3(size_t depth) {
+  auto a = MakeScalar(depth);
+  auto b = MakeScalar(depth);
+  return INodeHelper::MakeVector(std::move(a), std::move(b), MakeScalar(depth));
+}
+
+std::vector<std::unique_ptr<INode>> RandomExpression::MakeOperands(
+    size_t count,
+    size_t depth) {
+  std::vector<std::unique_ptr<INode>> operands;
+  for (size_t i = 0; i < count; ++i)
+    operands.push_back(MakeScalar(depth));
+  return operands;
+}
+
+Op RandomExpression::NextOp() {
+  double choice = NextDouble() * total_weight_;
+  Op last = Op::UnMinus;
+  for (int i = 0; i < static_cast<int>(std::size(options_.op_weights)); ++i) {
+    double weight = std::max(options_.op_weights[i], 0.0);
+    if (weight <= 0)
+      continue;
+    last = static_cast<Op>(i);
+    if (choice < weight)
+      return last;
+    choice -= weight;
+  }
+  return last;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "OpInfo.h"
+
+class INode;
+class Variable;
+class VariableScope;
+
+struct RandomExpressionOptions {
+  RandomExpressionOptions();
+
+  double& Weight(Op op) { return op_weights[static_cast<int>(op)]; }
+
+  uint64_t seed = 1;
+  // Operations are nested no deeper than |max_depth|, a leaf is made early
+  // with |leaf_probability|.
+  size_t max_depth = 4;
+  double leaf_probability = 0.1;
+  // Operands of Plus and Mult, at least 2.
+  size_t max_fan_out = 3;
+  // Relative frequency of every operation, zero excludes it. VectorMult
+  // makes a scalar triple product, so the tree stays scalar.
+  double op_weights[static_cast<int>(Op::Diff) + 1];
+  // Leaves are the variables x0, x1, .. of the scope or constants.
+  size_t variables_count = 2;
+  double constant_probability = 0.3;
+  // Constants are integers from 1 to |max_integer|, some of them divided by
+  // another such integer or negated.
+  int max_integer = 9;
+  double fraction_probability = 0.2;
+  double negative_probability = 0.2;
+  // Exponents of Pow are integers from 2 to |max_exponent|.
+  int max_exponent = 3;
+  // Chance that the result is a vector of |vector_dimension| expressions or
+  // a sequence of up to |max_fan_out| expressions.
+  double vector_probability = 0;
+  size_t vector_dimension = 3;
+  double sequence_probability = 0;
+};
+
+// Seeded generator of expression trees for scaling and stress benchmarks.
+// The trees depend only on the options, every Generate() call continues the
+// same random sequence.
+class RandomExpression {
+ public:
+  RandomExpression(const RandomExpressionOptions& options,
+                   VariableScope* scope);
+  RandomExpression(const RandomExpression&) = delete;
+  ~RandomExpression();
+
+  std::unique_ptr<INode> Generate();
+
+ private:
+  uint64_t Next();
+  // Uniform in [0, 1).
+  double NextDouble();
+  // Uniform in [from, to].
+  int NextInt(int from, int to);
+  bool NextBool(double probability);
+
+  std::unique_ptr<INode> MakeScalar(size_t depth);
+  std::unique_ptr<INode> MakeLeaf();
+  std::unique_ptr<INode> MakeConstant();
+  std::unique_ptr<INode> MakeVector3(size_t depth);
+  std::vector<std::unique_ptr<INode>> MakeOperands(size_t count,
+                                                   size_t depth);
+  Op NextOp();
+
+  RandomExpressionOptions options_;
+  std::vector<Variable*> variables_;
+  double total_weight_ = 0;
+  uint64_t state_;
+};
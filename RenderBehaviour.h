@@ -38,6 +38,13 @@ class RenderBehaviour {
   VariableBehaviour GetVariable() const { return variable_behaviour_; }
   void SetVariable(VariableBehaviour variable_behaviour);
 
+  bool operator==(const RenderBehaviour& rh) const {
+    return minus_behaviour_ == rh.minus_behaviour_ &&
+           brackets_behaviour_ == rh.brackets_behaviour_ &&
+           sub_super_behaviour_ == rh.sub_super_behaviour_ &&
+           variable_behaviour_ == rh.variable_behaviour_;
+  }
+
  private:
   MinusBehaviour minus_behaviour_ = MinusBehaviour::Relax;
   BracketsBehaviour brackets_behaviour_ = BracketsBehaviour::Relax;
@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include "INodeHelper.h"
+#include "SimplifyHelpers.h"
 
 Sequence::Sequence() {}
 
@@ -14,10 +15,10 @@ std::unique_ptr<INode> Sequence::SymCalc(SymCalcSettings settings) const {
   return AbstractSequence::DoSymCalc(std::make_unique<Sequence>(), settings);
 }
 
-PrintSize Sequence::Render(Canvas* canvas,
-                           PrintBox print_box,
-                           bool dry_run,
-                           RenderBehaviour render_behaviour) const {
+PrintSize Sequence::RenderImpl(Canvas* canvas,
+                               PrintBox print_box,
+                               bool dry_run,
+                               RenderBehaviour render_behaviour) const {
   render_behaviour.TakeMinus();
   render_behaviour.TakeBrackets();
   return AbstractSequence::DoRender(PrintDirection::Horizontal, canvas,
@@ -25,6 +26,7 @@ PrintSize Sequence::Render(Canvas* canvas,
 }
 
 void Sequence::Unique() {
+  InvalidateCaches();
   auto less_cmp = [](const std::unique_ptr<INode>& lh,
                      const std::unique_ptr<INode>& rh) {
     return lh->Compare(rh.get()) == CompareResult::Less;
@@ -32,7 +34,7 @@ void Sequence::Unique() {
   std::sort(values_.begin(), values_.end(), less_cmp);
   auto eq_cmp = [](const std::unique_ptr<INode>& lh,
                    const std::unique_ptr<INode>& rh) {
-    return lh->Compare(rh.get()) == CompareResult::Equal;
+    return IsEqualNodes(lh.get(), rh.get());
   };
   auto it = std::unique(values_.begin(), values_.end(), eq_cmp);
   values_.erase(it, values_.end());
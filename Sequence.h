@@ -15,10 +15,10 @@ class Sequence : public AbstractSequence {
 
   // INodeImpl interface
   NodeType GetNodeType() const override { return NodeType::Sequence; }
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   int Priority() const override { return 100; }
   ValueType GetValueType() const override { return ValueType::Sequence; }
   Sequence* AsSequence() override { return this; }
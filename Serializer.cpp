@@ -0,0 +1,558 @@
+﻿#include "Serializer.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+
+#include "AbstractSequence.h"
+#include "Brackets.h"
+#include "Constant.h"
+#include "ErrorNode.h"
+#include "Operation.h"
+#include "SharedNode.h"
+#include "Variable.h"
+#include "VariableRef.h"
+
+namespace {
+constexpr size_t kBufferSize = 1 << 16;
+
+struct Syntax {
+  std::wstring_view open;
+  std::wstring_view close;
+  std::wstring_view plus;
+  std::wstring_view minus;
+  std::wstring_view un_minus;
+  std::wstring_view mult;
+  std::wstring_view cross;
+  std::wstring_view equal;
+  std::wstring_view assign;
+  std::wstring_view separator;
+  std::wstring_view imaginary;
+};
+
+// Indexed by SerializeFormat.
+const Syntax kSyntax[] = {
+    {L"(", L")", L" + ", L" - ", L"-", L"*", L" × ", L" == ", L" = ", L", ",
+     L"i"},
+    {L"\\left(", L"\\right)", L" + ", L" - ", L"-", L" \\cdot ", L" \\times ",
+     L" = ", L" = ", L", ", L"i"},
+    {L"<mo>(</mo>", L"<mo>)</mo>", L"<mo>+</mo>", L"<mo>-</mo>", L"<mo>-</mo>",
+     L"<mo>&#x22C5;</mo>", L"<mo>&#x00D7;</mo>", L"<mo>=</mo>", L"<mo>=</mo>",
+     L"<mo>,</mo>", L"<mi>i</mi>"},
+};
+
+const std::wstring_view kMathBegin(
+    L"<math xmlns=\"http://www.w3.org/1998/Math/MathML\">");
+const std::wstring_view kMathEnd(L"</math>");
+
+bool IsConstant(const INodeImpl* node, double value) {
+  const Constant* constant = node->AsConstant();
+  return constant && !constant->IsNamed() && !constant->IsBool() &&
+         constant->Value() == value;
+}
+
+bool IsOperation(const INodeImpl* node, Op op) {
+  const Operation* operation = node->AsOperation();
+  return operation && operation->op() == op;
+}
+}  // namespace
+
+Serializer::Serializer(SerializeFormat format, std::wostream& out)
+    : format_(format), out_(out) {
+  buffer_.reserve(kBufferSize);
+}
+
+Serializer::~Serializer() {
+  Flush();
+}
+
+void Serializer::Write(const INode* node) {
+  if (format_ == SerializeFormat::MathMl)
+    Append(kMathBegin);
+  Run(node->AsNodeImpl());
+  if (format_ == SerializeFormat::MathMl)
+    Append(kMathEnd);
+}
+
+void Serializer::Write(const Variable& var) {
+  if (format_ == SerializeFormat::MathMl)
+    Append(kMathBegin);
+  if (var.GetSymbol().IsEmpty() || !var.GetValue()) {
+    VariableRef ref(&var);
+    Run(&ref);
+  } else {
+    AppendName(var.GetName());
+    Append(kSyntax[static_cast<size_t>(format_)].assign);
+    Run(var.GetValue()->AsNodeImpl());
+  }
+  if (format_ == SerializeFormat::MathMl)
+    Append(kMathEnd);
+}
+
+void Serializer::Flush() {
+  out_.write(buffer_.data(), buffer_.size());
+  buffer_.clear();
+}
+
+// static
+std::wstring Serializer::ToString(const INode* node, SerializeFormat format) {
+  std::wostringstream out;
+  Serializer(format, out).Write(node);
+  return out.str();
+}
+
+// static
+std::wstring Serializer::ToString(const Variable& var, SerializeFormat format) {
+  std::wostringstream out;
+  Serializer(format, out).Write(var);
+  return out.str();
+}
+
+void Serializer::Run(const INodeImpl* root) {
+  const Syntax& syntax = kSyntax[static_cast<size_t>(format_)];
+  stack_.push_back({root, {}, false, false});
+  while (!stack_.empty()) {
+    Item item = stack_.back();
+    stack_.pop_back();
+    if (!item.node) {
+      Append(item.text);
+      continue;
+    }
+    if (item.brackets) {
+      Text(syntax.open);
+      Child(item.node, false, item.negate);
+      Text(syntax.close);
+    } else {
+      Visit(item.node, item.negate);
+    }
+    stack_.insert(stack_.end(), pending_.rbegin(), pending_.rend());
+    pending_.clear();
+  }
+}
+
+void Serializer::Visit(const INodeImpl* node, bool negate) {
+  const Syntax& syntax = kSyntax[static_cast<size_t>(format_)];
+  // Look through the nodes that only forward to another subtree.
+  for (;;) {
+    if (const SharedNode* shared = node->AsSharedNode()) {
+      node = shared->Target();
+    } else if (const Variable* var = node->AsVariable()) {
+      if (!var->GetSymbol().IsEmpty() || !var->GetValue())
+        break;
+      node = var->GetValue()->AsNodeImpl();
+    } else {
+      break;
+    }
+  }
+
+  if (const Operation* operation = node->AsOperation()) {
+    VisitOperation(operation, negate);
+    return;
+  }
+  if (const Constant* constant = node->AsConstant()) {
+    if (constant->IsNamed()) {
+      AppendName(constant->Name());
+    } else if (constant->IsBool()) {
+      AppendName(constant->Value() != 0.0 ? L"True" : L"False");
+    } else {
+      AppendNumber(negate ? -constant->Value() : constant->Value());
+    }
+    return;
+  }
+  if (negate) {
+    Text(syntax.un_minus);
+    Child(node, true);
+    return;
+  }
+  if (const Variable* var = node->AsVariable()) {
+    AppendName(var->GetSymbol().IsEmpty() ? L"null" : var->GetName());
+  } else if (node->AsImaginary()) {
+    Append(syntax.imaginary);
+  } else if (const ErrorNode* error = node->AsError()) {
+    if (format_ == SerializeFormat::Infix) {
+      Append(error->Error());
+    } else if (format_ == SerializeFormat::Latex) {
+      Append(L"\\text{");
+      Append(error->Error());
+      Append(L"}");
+    } else {
+      Append(L"<merror><mtext>");
+      AppendEscaped(error->Error());
+      Append(L"</mtext></merror>");
+    }
+  } else if (const Brackets* brackets = node->AsBrackets()) {
+    // Indexed by BracketType, then by SerializeFormat.
+    static const std::wstring_view kBrackets[][3][2] = {
+        {{L"(", L")"},
+         {L"\\left(", L"\\right)"},
+         {L"<mo>(</mo>", L"<mo>)</mo>"}},
+        {{L"[", L"]"},
+         {L"\\left[", L"\\right]"},
+         {L"<mo>[</mo>", L"<mo>]</mo>"}},
+        {{L"{", L"}"},
+         {L"\\left\\{", L"\\right\\}"},
+         {L"<mo>{</mo>", L"<mo>}</mo>"}},
+        {{L"|", L"|"},
+         {L"\\left|", L"\\right|"},
+         {L"<mo>|</mo>", L"<mo>|</mo>"}},
+        {{L"sqrt(", L")"}, {L"\\sqrt{", L"}"}, {L"<msqrt>", L"</msqrt>"}},
+    };
+    const auto& pair = kBrackets[static_cast<size_t>(
+        brackets->GetBracketType())][static_cast<size_t>(format_)];
+    Text(pair[0]);
+    Child(brackets->Value(), false);
+    Text(pair[1]);
+  } else if (const AbstractSequence* sequence = node->AsAbstractSequence()) {
+    bool is_vector = node->AsVector() != nullptr;
+    std::wstring_view begin, separator, end;
+    if (format_ == SerializeFormat::Infix) {
+      begin = is_vector ? L"[" : L"{";
+      separator = syntax.separator;
+      end = is_vector ? L"]" : L"}";
+    } else if (format_ == SerializeFormat::Latex) {
+      begin = is_vector ? L"\\begin{pmatrix}" : L"\\left\\{";
+      separator = is_vector ? L" \\\\ " : L", ";
+      end = is_vector ? L"\\end{pmatrix}" : L"\\right\\}";
+    } else {
+      begin = is_vector ? L"<mrow><mo>(</mo><mtable><mtr><mtd>"
+                        : L"<mrow><mo>{</mo>";
+      separator = is_vector ? L"</mtd></mtr><mtr><mtd>" : L"<mo>,</mo>";
+      end = is_vector ? L"</mtd></mtr></mtable><mo>)</mo></mrow>"
+                      : L"<mo>}</mo></mrow>";
+    }
+    Text(begin);
+    for (size_t i = 0; i < sequence->Size(); ++i) {
+      if (i != 0)
+        Text(separator);
+      Child(sequence->Value(i)->AsNodeImpl(), false);
+    }
+    Text(end);
+  }
+}
+
+void Serializer::VisitOperation(const Operation* operation, bool negate) {
+  const Syntax& syntax = kSyntax[static_cast<size_t>(format_)];
+  const int priority = operation->Priority();
+  const Op op = operation->op();
+  if (negate) {
+    if (op == Op::UnMinus) {
+      const INodeImpl* operand = operation->Operand(0);
+      Child(operand, operand->Priority() < priority);
+    } else if (op == Op::Mult) {
+      Child(operation->Operand(0), false, true);
+      for (size_t i = 1; i < operation->OperandsCount(); ++i) {
+        const INodeImpl* operand = operation->Operand(i);
+        Text(syntax.mult);
+        Child(operand,
+              operand->Priority() < priority || operand->HasFrontMinus());
+      }
+    } else if (op == Op::Div && format_ == SerializeFormat::Infix) {
+      const INodeImpl* dividend = operation->Operand(0);
+      const INodeImpl* divider = operation->Operand(1);
+      bool negate_dividend = dividend->HasFrontMinus();
+      Child(dividend, dividend->Priority() < priority, negate_dividend);
+      Text(L"/");
+      Child(divider, divider->Priority() <= priority, !negate_dividend);
+    } else {
+      Text(syntax.un_minus);
+      Child(operation->AsNodeImpl(), true);
+    }
+    return;
+  }
+
+  switch (op) {
+    case Op::UnMinus: {
+      const INodeImpl* operand = operation->Operand(0);
+      if (operand->HasFrontMinus()) {
+        Child(operand, false, true);
+      } else {
+        Text(syntax.un_minus);
+        Child(operand, operand->Priority() < priority);
+      }
+      break;
+    }
+    case Op::Minus:
+      VisitChain(operation, syntax.minus);
+      break;
+    case Op::Plus:
+      VisitChain(operation, syntax.plus);
+      break;
+    case Op::Mult:
+      VisitChain(operation, syntax.mult);
+      break;
+    case Op::VectorMult:
+      VisitChain(operation, syntax.cross);
+      break;
+    case Op::Equal:
+      VisitChain(operation, syntax.equal);
+      break;
+    case Op::Div: {
+      const INodeImpl* dividend = operation->Operand(0);
+      const INodeImpl* divider = operation->Operand(1);
+      if (format_ == SerializeFormat::Infix) {
+        Child(dividend, dividend->Priority() < priority);
+        Text(L"/");
+        Child(divider,
+              divider->Priority() <= priority || divider->HasFrontMinus());
+      } else {
+        Text(format_ == SerializeFormat::Latex ? L"\\frac" : L"<mfrac>");
+        Group(dividend);
+        Group(divider);
+        if (format_ == SerializeFormat::MathMl)
+          Text(L"</mfrac>");
+      }
+      break;
+    }
+    case Op::Pow: {
+      const INodeImpl* base = operation->Operand(0);
+      const INodeImpl* exp = operation->Operand(1);
+      bool base_brackets = base->Priority() < priority ||
+                           base->HasFrontMinus() || IsOperation(base, Op::Pow);
+      if (format_ == SerializeFormat::Infix) {
+        Child(base, base_brackets);
+        Text(L"^");
+        Child(exp, exp->Priority() < 100 || exp->HasFrontMinus());
+      } else if (format_ == SerializeFormat::Latex) {
+        Text(L"{");
+        Child(base, base_brackets);
+        Text(L"}^");
+        Group(exp);
+      } else {
+        Text(L"<msup><mrow>");
+        Child(base, base_brackets);
+        Text(L"</mrow>");
+        Group(exp);
+        Text(L"</msup>");
+      }
+      break;
+    }
+    case Op::Sqrt: {
+      const INodeImpl* value = operation->Operand(0);
+      const INodeImpl* exp = operation->Operand(1);
+      bool square = IsConstant(exp, 2.0);
+      if (format_ == SerializeFormat::Infix) {
+        if (square)
+          VisitFunction(L"sqrt", value);
+        else
+          VisitFunction(L"root", value, exp);
+      } else if (format_ == SerializeFormat::Latex) {
+        if (square) {
+          Text(L"\\sqrt");
+        } else {
+          Text(L"\\sqrt[");
+          Child(exp, false);
+          Text(L"]");
+        }
+        Group(value);
+      } else {
+        Text(square ? L"<msqrt>" : L"<mroot>");
+        Group(value);
+        if (!square)
+          Group(exp);
+        Text(square ? L"</msqrt>" : L"</mroot>");
+      }
+      break;
+    }
+    case Op::Sin:
+    case Op::Cos: {
+      static const std::wstring_view kNames[][3] = {
+          {L"sin", L"\\sin", L"<mi>sin</mi><mo>&#x2061;</mo>"},
+          {L"cos", L"\\cos", L"<mi>cos</mi><mo>&#x2061;</mo>"},
+      };
+      VisitFunction(kNames[op == Op::Sin ? 0 : 1][static_cast<size_t>(format_)],
+                    operation->Operand(0));
+      break;
+    }
+    case Op::Log: {
+      const INodeImpl* base = operation->Operand(0);
+      const INodeImpl* value = operation->Operand(1);
+      const Constant* base_constant = base->AsConstant();
+      if (base_constant && base_constant->Value() == M_E) {
+        static const std::wstring_view kLn[] = {
+            L"ln", L"\\ln", L"<mi>ln</mi><mo>&#x2061;</mo>"};
+        VisitFunction(kLn[static_cast<size_t>(format_)], value);
+      } else if (format_ == SerializeFormat::Infix) {
+        VisitFunction(L"log", base, value);
+      } else {
+        Text(format_ == SerializeFormat::Latex ? L"\\log_"
+                                               : L"<msub><mi>log</mi>");
+        Group(base);
+        if (format_ == SerializeFormat::MathMl)
+          Text(L"</msub><mo>&#x2061;</mo>");
+        VisitFunction({}, value);
+      }
+      break;
+    }
+    case Op::Diff: {
+      const INodeImpl* value = operation->Operand(0);
+      const INodeImpl* by_var = operation->Operand(1);
+      if (format_ == SerializeFormat::Infix) {
+        VisitFunction(L"diff", value, by_var);
+        break;
+      }
+      if (format_ == SerializeFormat::Latex) {
+        Text(L"\\frac{d}{d");
+        Child(by_var, false);
+        Text(L"}");
+      } else {
+        Text(L"<mfrac><mi>d</mi><mrow><mi>d</mi>");
+        Child(by_var, false);
+        Text(L"</mrow></mfrac>");
+      }
+      VisitFunction({}, value);
+      break;
+    }
+  }
+}
+
+void Serializer::VisitChain(const Operation* operation,
+                            std::wstring_view op_text) {
+  const Syntax& syntax = kSyntax[static_cast<size_t>(format_)];
+  const int priority = operation->Priority();
+  const Op op = operation->op();
+  for (size_t i = 0; i < operation->OperandsCount(); ++i) {
+    const INodeImpl* operand = operation->Operand(i);
+    const bool front_minus = operand->HasFrontMinus();
+    if (i == 0) {
+      // -a∙b keeps no brackets around -a.
+      Child(operand, operand->Priority() < priority &&
+                         !(op == Op::Mult && front_minus));
+      continue;
+    }
+    if (op == Op::Plus && front_minus) {
+      // a + (-b) is written as a - b.
+      Text(syntax.minus);
+      Child(operand, false, true);
+      continue;
+    }
+    Text(op_text);
+    int operand_priority = operand->Priority();
+    Child(operand, operand_priority < priority ||
+                       (op == Op::Minus && operand_priority == priority) ||
+                       (op != Op::Equal && front_minus));
+  }
+}
+
+void Serializer::VisitFunction(std::wstring_view name,
+                               const INodeImpl* first,
+                               const INodeImpl* second) {
+  const Syntax& syntax = kSyntax[static_cast<size_t>(format_)];
+  if (!name.empty())
+    Text(name);
+  Text(syntax.open);
+  Child(first, false);
+  if (second) {
+    Text(syntax.separator);
+    Child(second, false);
+  }
+  Text(syntax.close);
+}
+
+void Serializer::Text(std::wstring_view text) {
+  pending_.push_back({nullptr, text, false, false});
+}
+
+void Serializer::Child(const INodeImpl* node, bool brackets, bool negate) {
+  pending_.push_back({node, {}, brackets, negate});
+}
+
+void Serializer::Group(const INodeImpl* node) {
+  bool latex = format_ == SerializeFormat::Latex;
+  Text(latex ? L"{" : L"<mrow>");
+  Child(node, false);
+  Text(latex ? L"}" : L"</mrow>");
+}
+
+void Serializer::Append(std::wstring_view text) {
+  buffer_.append(text.data(), text.size());
+  if (buffer_.size() >= kBufferSize)
+    Flush();
+}
+
+void Serializer::AppendEscaped(std::wstring_view text) {
+  size_t begin = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    std::wstring_view entity;
+    switch (text[i]) {
+      case L'<':
+        entity = L"&lt;";
+        break;
+      case L'>':
+        entity = L"&gt;";
+        break;
+      case L'&':
+        entity = L"&amp;";
+        break;
+      default:
+        continue;
+    }
+    Append(text.substr(begin, i - begin));
+    Append(entity);
+    begin = i + 1;
+  }
+  Append(text.substr(begin));
+}
+
+void Serializer::AppendName(std::wstring_view name) {
+  if (format_ == SerializeFormat::Infix) {
+    Append(name);
+  } else if (format_ == SerializeFormat::Latex) {
+    if (name.size() == 1) {
+      Append(name);
+    } else {
+      Append(L"\\mathrm{");
+      Append(name);
+      Append(L"}");
+    }
+  } else {
+    Append(L"<mi>");
+    AppendEscaped(name);
+    Append(L"</mi>");
+  }
+}
+
+void Serializer::AppendNumber(double value) {
+  const bool math_ml = format_ == SerializeFormat::MathMl;
+  if (math_ml && value < 0) {
+    Append(L"<mrow><mo>-</mo>");
+    AppendNumber(-value);
+    Append(L"</mrow>");
+    return;
+  }
+  // The shortest text that reads back as the same double, so the infix form
+  // round-trips through Parser, which also reads inf and nan. Small integers,
+  // the most common constants, are formatted by hand.
+  wchar_t text[32];
+  size_t size = 0;
+  if (value == std::trunc(value) && std::abs(value) < 1e6 &&
+      !(value == 0 && std::signbit(value))) {
+    wchar_t* end = text + sizeof(text) / sizeof(text[0]);
+    wchar_t* begin = end;
+    uint32_t digits = static_cast<uint32_t>(std::abs(value));
+    do {
+      *--begin = static_cast<wchar_t>(L'0' + digits % 10);
+      digits /= 10;
+    } while (digits);
+    if (value < 0)
+      *--begin = L'-';
+    size = end - begin;
+    std::copy(begin, end, text);
+  } else {
+    char digits[32];
+    auto result = std::to_chars(std::begin(digits), std::end(digits), value);
+    size = result.ptr - digits;
+    std::copy(digits, result.ptr, text);
+  }
+  if (math_ml)
+    Append(L"<mn>");
+  Append(std::wstring_view(text, size));
+  if (math_ml)
+    Append(L"</mn>");
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class INode;
+class INodeImpl;
+class Operation;
+class Variable;
+
+enum class SerializeFormat {
+  Infix,
+  Latex,
+  MathMl,
+};
+
+// Writes expressions as linear text in one pass over the tree, without the
+// layout Print() does. Brackets are placed by Priority() and HasFrontMinus()
+// of the operands. The tree is walked with an explicit stack, so the depth of
+// the tree is not limited by the call stack. Output is buffered and written to
+// the stream by Flush() or the destructor.
+class Serializer {
+ public:
+  Serializer(SerializeFormat format, std::wostream& out);
+  Serializer(const Serializer&) = delete;
+  ~Serializer();
+
+  void Write(const INode* node);
+  // Named variables are written as "name = value", like Print() does.
+  void Write(const Variable& var);
+  void Flush();
+
+  static std::wstring ToString(const INode* node, SerializeFormat format);
+  static std::wstring ToString(const Variable& var, SerializeFormat format);
+
+ private:
+  // Either a node to write or a piece of fixed text.
+  struct Item {
+    const INodeImpl* node;
+    std::wstring_view text;
+    bool brackets;
+    // The node is written with the opposite sign, its front minus is already
+    // written by the parent.
+    bool negate;
+  };
+
+  void Run(const INodeImpl* root);
+  void Visit(const INodeImpl* node, bool negate);
+  void VisitOperation(const Operation* operation, bool negate);
+  void VisitChain(const Operation* operation, std::wstring_view op_text);
+  void VisitFunction(std::wstring_view name,
+                     const INodeImpl* first,
+                     const INodeImpl* second = nullptr);
+
+  // Queue the parts of the visited node, in the order they are written.
+  void Text(std::wstring_view text);
+  void Child(const INodeImpl* node, bool brackets, bool negate = false);
+  // A child that forms one argument of a LaTeX or MathML construct.
+  void Group(const INodeImpl* node);
+
+  void Append(std::wstring_view text);
+  void AppendEscaped(std::wstring_view text);
+  void AppendName(std::wstring_view name);
+  void AppendNumber(double value);
+
+  SerializeFormat format_;
+  std::wostream& out_;
+  std::wstring buffer_;
+  std::vector<Item> stack_;
+  std::vector<Item> pending_;
+};
@@ -0,0 +1,186 @@
+#include "SharedNode.h"
+
+#include <cassert>
+
+#include "INodeHelper.h"
+#include "Operation.h"
+
+SharedNode::SharedNode(std::shared_ptr<const INode> shared)
+    : shared_(std::move(shared)) {
+  assert(shared_);
+}
+
+CompareResult SharedNode::Compare(const INode* rh) const {
+  return Target()->Compare(rh);
+}
+
+uint64_t SharedNode::ComputeHash() const {
+  return ChildHash(Target());
+}
+
+void SharedNode::CollectFreeVariables(SymbolSet* result) const {
+  result->InsertAll(ChildFreeVariables(Target()));
+}
+
+void SharedNode::ForgetChildren() const {
+  ForgetChild(private_.get());
+}
+
+std::unique_ptr<INode> SharedNode::Clone() const {
+  if (private_)
+    return private_->Clone();
+  return std::make_unique<SharedNode>(shared_);
+}
+
+std::unique_ptr<INode> SharedNode::SymCalc(SymCalcSettings settings) const {
+  return Target()->SymCalc(settings);
+}
+
+NodeType SharedNode::GetNodeType() const {
+  return Target()->GetNodeType();
+}
+
+PrintSize SharedNode::RenderImpl(Canvas* canvas,
+                                 PrintBox print_box,
+                                 bool dry_run,
+                                 RenderBehaviour render_behaviour) const {
+  // Render caches sizes inside nodes, so every occurrence needs its own copy.
+  return Materialize()->Render(canvas, print_box, dry_run, render_behaviour);
+}
+
+PrintSize SharedNode::LastPrintSize() const {
+  return Target()->LastPrintSize();
+}
+
+int SharedNode::Priority() const {
+  return Target()->Priority();
+}
+
+bool SharedNode::HasFrontMinus() const {
+  return Target()->HasFrontMinus();
+}
+
+ValueType SharedNode::GetValueType() const {
+  return Target()->GetValueType();
+}
+
+bool SharedNode::CheckCircular(const INodeImpl* other) const {
+  return this == other || Target()->CheckCircular(other);
+}
+
+Constant* SharedNode::AsConstant() {
+  return Target()->AsConstant() ? MutableTarget()->AsConstant() : nullptr;
+}
+
+const Constant* SharedNode::AsConstant() const {
+  return Target()->AsConstant();
+}
+
+Vector* SharedNode::AsVector() {
+  return Target()->AsVector() ? MutableTarget()->AsVector() : nullptr;
+}
+
+const Vector* SharedNode::AsVector() const {
+  return Target()->AsVector();
+}
+
+Sequence* SharedNode::AsSequence() {
+  return Target()->AsSequence() ? MutableTarget()->AsSequence() : nullptr;
+}
+
+const Sequence* SharedNode::AsSequence() const {
+  return Target()->AsSequence();
+}
+
+AbstractSequence* SharedNode::AsAbstractSequence() {
+  return Target()->AsAbstractSequence() ? MutableTarget()->AsAbstractSequence()
+                                        : nullptr;
+}
+
+const AbstractSequence* SharedNode::AsAbstractSequence() const {
+  return Target()->AsAbstractSequence();
+}
+
+Imaginary* SharedNode::AsImaginary() {
+  return Target()->AsImaginary() ? MutableTarget()->AsImaginary() : nullptr;
+}
+
+const Imaginary* SharedNode::AsImaginary() const {
+  return Target()->AsImaginary();
+}
+
+Brackets* SharedNode::AsBrackets() {
+  return Target()->AsBrackets() ? MutableTarget()->AsBrackets() : nullptr;
+}
+
+const Brackets* SharedNode::AsBrackets() const {
+  return Target()->AsBrackets();
+}
+
+const ErrorNode* SharedNode::AsError() const {
+  return Target()->AsError();
+}
+
+Variable* SharedNode::AsVariable() {
+  return Target()->AsVariable() ? MutableTarget()->AsVariable() : nullptr;
+}
+
+const Variable* SharedNode::AsVariable() const {
+  return Target()->AsVariable();
+}
+
+Operation* SharedNode::AsOperation() {
+  return Target()->AsOperation() ? MutableTarget()->AsOperation() : nullptr;
+}
+
+const Operation* SharedNode::AsOperation() const {
+  return Target()->AsOperation();
+}
+
+void SharedNode::SimplifyImpl(HotToken token,
+                              std::unique_ptr<INode>* new_node) {
+  MutableTarget()->SimplifyImpl({&token}, new_node);
+  if (new_node && !*new_node)
+    *new_node = std::move(private_);
+}
+
+void SharedNode::OpenBracketsImpl(HotToken token,
+                                  std::unique_ptr<INode>* new_node) {
+  MutableTarget()->OpenBracketsImpl({&token}, new_node);
+  if (new_node && !*new_node)
+    *new_node = std::move(private_);
+}
+
+void SharedNode::ConvertToComplexImpl(HotToken token,
+                                      std::unique_ptr<INode>* new_node) {
+  MutableTarget()->ConvertToComplexImpl({&token}, new_node);
+  if (new_node && !*new_node)
+    *new_node = std::move(private_);
+}
+
+const INodeImpl* SharedNode::Target() const {
+  return private_ ? private_->AsNodeImpl() : shared_->AsNodeImpl();
+}
+
+INodeImpl* SharedNode::MutableTarget() {
+  // The caches of this node follow the private copy the caller mutates.
+  InvalidateCaches();
+  return Materialize();
+}
+
+INodeImpl* SharedNode::Materialize() const {
+  if (private_)
+    return private_->AsNodeImpl();
+  const Operation* operation = shared_->AsNodeImpl()->AsOperation();
+  if (!operation) {
+    private_ = shared_->Clone();
+    return private_->AsNodeImpl();
+  }
+  // Operands of a shared node are proxies or leaves, both cheap to clone.
+  std::vector<std::unique_ptr<INode>> operands;
+  operands.reserve(operation->OperandsCount());
+  for (size_t i = 0; i < operation->OperandsCount(); ++i)
+    operands.push_back(operation->Operand(i)->Clone());
+  private_ = INodeHelper::MakeOperation(operation->op(), std::move(operands));
+  return private_->AsNodeImpl();
+}
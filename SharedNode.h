@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+
+#include "INodeImpl.h"
+
+// Proxy for an immutable Operation subtree owned by a NodeTable. Read-only
+// access goes to the shared node; the first mutable access makes a private
+// shallow copy whose operands are again proxies, so a rewrite only copies the
+// path it actually touches.
+class SharedNode : public INodeImpl {
+ public:
+  explicit SharedNode(std::shared_ptr<const INode> shared);
+
+  // INode implementation
+  CompareResult Compare(const INode* rh) const override;
+  std::unique_ptr<INode> Clone() const override;
+  std::unique_ptr<INode> SymCalc(SymCalcSettings settings) const override;
+
+  // INodeImpl interface
+  NodeType GetNodeType() const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
+  PrintSize LastPrintSize() const override;
+  int Priority() const override;
+  bool HasFrontMinus() const override;
+  ValueType GetValueType() const override;
+  bool CheckCircular(const INodeImpl* other) const override;
+
+  Constant* AsConstant() override;
+  const Constant* AsConstant() const override;
+  Vector* AsVector() override;
+  const Vector* AsVector() const override;
+  Sequence* AsSequence() override;
+  const Sequence* AsSequence() const override;
+  AbstractSequence* AsAbstractSequence() override;
+  const AbstractSequence* AsAbstractSequence() const override;
+  Imaginary* AsImaginary() override;
+  const Imaginary* AsImaginary() const override;
+  Brackets* AsBrackets() override;
+  const Brackets* AsBrackets() const override;
+  const ErrorNode* AsError() const override;
+  Variable* AsVariable() override;
+  const Variable* AsVariable() const override;
+  Operation* AsOperation() override;
+  const Operation* AsOperation() const override;
+  const SharedNode* AsSharedNode() const override { return this; }
+
+  void SimplifyImpl(HotToken token, std::unique_ptr<INode>* new_node) override;
+  void OpenBracketsImpl(HotToken token,
+                        std::unique_ptr<INode>* new_node) override;
+  void ConvertToComplexImpl(HotToken token,
+                            std::unique_ptr<INode>* new_node) override;
+
+  const std::shared_ptr<const INode>& Shared() const { return shared_; }
+  bool IsMaterialized() const { return private_ != nullptr; }
+
+ protected:
+  uint64_t ComputeHash() const override;
+  void CollectFreeVariables(SymbolSet* result) const override;
+  void ForgetChildren() const override;
+
+ private:
+  friend class BinaryWriter;
+  friend class Serializer;
+
+  const INodeImpl* Target() const;
+  INodeImpl* Materialize() const;
+  INodeImpl* MutableTarget();
+
+  std::shared_ptr<const INode> shared_;
+  mutable std::unique_ptr<INode> private_;
+};
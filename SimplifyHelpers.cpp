@@ -10,6 +10,7 @@
 #include "INodeHelper.h"
 #include "IOperation.h"
 #include "MultOperation.h"
+#include "OperandsVector.h"
 #include "PlusOperation.h"
 #include "PowOperation.h"
 #include "UnMinusOperation.h"
@@ -147,6 +148,12 @@ void DoShorten(double* v1, double* v2) {
 }
 }  // namespace
 
+bool IsEqualNodes(const INode* lh, const INode* rh) {
+  if (lh->AsNodeImpl()->Hash() != rh->AsNodeImpl()->Hash())
+    return false;
+  return lh->Compare(rh) == CompareResult::Equal;
+}
+
 CompareResult IsNodesTransitiveEqual(std::vector<const INode*> lhs,
                                      std::vector<const INode*> rhs) {
   auto result = CompareTrivial(lhs.size(), rhs.size());
@@ -163,8 +170,7 @@ CompareResult IsNodesTransitiveEqual(std::vector<const INode*> lhs,
       for (size_t j = 0; j < rhs.size(); ++j) {
         if (used[j])
           continue;
-        auto r = lhs[i]->Compare(rhs[j]);
-        if (r != CompareResult::Equal)
+        if (!IsEqualNodes(lhs[i], rhs[j]))
           continue;
         used[j] = true;
         equal_found = true;
@@ -209,10 +215,9 @@ CompareResult IsNodesTransitiveEqual(
   return IsNodesTransitiveEqual(transform(lhs), transform(rhs));
 }
 
-CompareResult IsNodesTransitiveEqual(
-    const std::vector<std::unique_ptr<INode>>& lhs,
-    const std::vector<std::unique_ptr<INode>>& rhs) {
-  auto transform = [](const std::vector<std::unique_ptr<INode>>& nodes)
+CompareResult IsNodesTransitiveEqual(const OperandsVector& lhs,
+                                     const OperandsVector& rhs) {
+  auto transform = [](const OperandsVector& nodes)
       -> std::vector<const INode*> {
     std::vector<const INode*> result;
     result.resize(nodes.size());
@@ -235,7 +240,7 @@ std::vector<std::unique_ptr<INode>> TakeEqualNodes(
     for (size_t j = 0; j < rhs->size(); ++j) {
       if (!(*rhs)[j])
         continue;
-      if ((*lhs)[i]->Compare((*rhs)[j].get()) != CompareResult::Equal)
+      if (!IsEqualNodes((*lhs)[i].get(), (*rhs)[j].get()))
         continue;
       result.push_back(std::move((*lhs)[i]));
       (*lhs)[i].reset();
@@ -253,7 +258,7 @@ std::vector<std::unique_ptr<INode>> RemoveEqualNodes(
     for (size_t j = 0; j < rhs->size(); ++j) {
       if (!(*rhs)[j])
         continue;
-      if (lhs[i]->Compare((*rhs)[j].get()) == CompareResult::Equal) {
+      if (IsEqualNodes(lhs[i].get(), (*rhs)[j].get())) {
         (*rhs)[j].reset();
         break;
       }
@@ -264,9 +269,10 @@ std::vector<std::unique_ptr<INode>> RemoveEqualNodes(
 }
 
 void ExctractNodesWithOp(Op op,
-                         std::vector<std::unique_ptr<INode>>* src,
+                         OperandsVector* src,
                          std::vector<std::unique_ptr<INode>>* nodes) {
   assert(!src->empty());
+  src->InvalidateOwner();
   for (auto& node : *src) {
     ExctractNodesWithOp(op, std::move(node), nodes);
   }
@@ -279,7 +285,6 @@ void ExctractNodesWithOp(Op op,
   std::vector<std::unique_ptr<INode>> positive_nodes;
   std::vector<std::unique_ptr<INode>> negative_nodes;
   ExctractNodesWithOp(op, std::move(src), &positive_nodes, &negative_nodes);
-  nodes->reserve(nodes->size() + positive_nodes.size() + negative_nodes.size());
   for (auto& node : positive_nodes) {
     nodes->push_back(std::move(node));
   }
@@ -300,10 +305,18 @@ void ExctractNodesWithOp(Op op,
   if (operation->op() == Op::UnMinus) {
     auto* un_minus = operation->AsUnMinusOperation();
     if (op == Op::Mult) {
+      size_t positive_count = positive_nodes->size();
       ExctractNodesWithOp(op, un_minus->TakeOperand(), positive_nodes,
                           negative_nodes);
-      negative_nodes->push_back(std::move(positive_nodes->back()));
-      positive_nodes->pop_back();
+      // The product changes its sign with any one of the new factors, which
+      // all can be negative already, as in -(-a).
+      if (positive_nodes->size() > positive_count) {
+        negative_nodes->push_back(std::move(positive_nodes->back()));
+        positive_nodes->pop_back();
+      } else {
+        positive_nodes->push_back(std::move(negative_nodes->back()));
+        negative_nodes->pop_back();
+      }
     } else {
       ExctractNodesWithOp(op, un_minus->TakeOperand(), negative_nodes,
                           positive_nodes);
@@ -510,28 +523,35 @@ bool MergeCanonicToPow(HotToken& token,
   return true;
 }
 
-void ReorderOperands(std::vector<std::unique_ptr<INode>>* operands,
-                     bool move_const_to_front) {
+void ReorderOperands(OperandsVector* operands, bool move_const_to_front) {
+  // The order is found on positions, the operands are only moved, and the
+  // caches of the owner dropped, when it changes.
+  std::vector<size_t> order;
+  order.reserve(operands->size());
   {
-    auto order_by_name = [](const std::unique_ptr<INode>& lh,
-                            const std::unique_ptr<INode>& rh) {
-      std::wstring lh_name = GetBaseName(lh.get());
-      std::wstring rh_name = GetBaseName(rh.get());
-      if (lh_name.empty() || rh_name.empty()) {
-        return lh_name.empty() < rh_name.empty();
+    // Base names are built once per operand, not once per comparison.
+    using NamedNode = std::pair<std::wstring, size_t>;
+    std::vector<NamedNode> named_nodes;
+    named_nodes.reserve(operands->size());
+    for (size_t i = 0; i < operands->size(); ++i)
+      named_nodes.emplace_back(GetBaseName((*operands)[i].get()), i);
+    auto order_by_name = [](const NamedNode& lh, const NamedNode& rh) {
+      if (lh.first.empty() || rh.first.empty()) {
+        return lh.first.empty() < rh.first.empty();
       }
-      return lh_name < rh_name;
+      return lh.first < rh.first;
     };
-    std::sort(operands->begin(), operands->end(), order_by_name);
+    std::sort(named_nodes.begin(), named_nodes.end(), order_by_name);
+    for (const auto& named_node : named_nodes)
+      order.push_back(named_node.second);
   }
   {
-    auto const_to_front = [move_const_to_front](
-                              const std::unique_ptr<INode>& lh,
-                              const std::unique_ptr<INode>& rh) {
-      auto lh_as_const = INodeHelper::AsConstant(lh.get());
+    auto const_to_front = [operands, move_const_to_front](size_t lh_indx,
+                                                          size_t rh_indx) {
+      auto lh_as_const = INodeHelper::AsConstant((*operands)[lh_indx].get());
       if (lh_as_const && lh_as_const->IsNamed())
         lh_as_const = nullptr;
-      auto rh_as_const = INodeHelper::AsConstant(rh.get());
+      auto rh_as_const = INodeHelper::AsConstant((*operands)[rh_indx].get());
       if (rh_as_const && rh_as_const->IsNamed())
         rh_as_const = nullptr;
       if (!lh_as_const && !rh_as_const)
@@ -543,17 +563,28 @@ void ReorderOperands(std::vector<std::unique_ptr<INode>>* operands,
       return move_const_to_front ? lh_as_const > rh_as_const
                                  : lh_as_const < rh_as_const;
     };
-    std::stable_sort(operands->begin(), operands->end(), const_to_front);
+    std::stable_sort(order.begin(), order.end(), const_to_front);
   }
   {
-    auto i_to_back = [](const std::unique_ptr<INode>& lh,
-                        const std::unique_ptr<INode>& rh) {
-      auto lh_as_i = INodeHelper::AsImaginary(lh.get());
-      auto rh_as_i = INodeHelper::AsImaginary(rh.get());
+    auto i_to_back = [operands](size_t lh_indx, size_t rh_indx) {
+      auto lh_as_i = INodeHelper::AsImaginary((*operands)[lh_indx].get());
+      auto rh_as_i = INodeHelper::AsImaginary((*operands)[rh_indx].get());
       return lh_as_i < rh_as_i;
     };
-    std::stable_sort(operands->begin(), operands->end(), i_to_back);
+    std::stable_sort(order.begin(), order.end(), i_to_back);
   }
+  bool is_ordered = true;
+  for (size_t i = 0; i < order.size(); ++i)
+    is_ordered = is_ordered && order[i] == i;
+  if (is_ordered)
+    return;
+  operands->InvalidateOwner();
+  std::vector<std::unique_ptr<INode>> ordered;
+  ordered.reserve(order.size());
+  for (size_t indx : order)
+    ordered.push_back(std::move((*operands)[indx]));
+  for (size_t i = 0; i < ordered.size(); ++i)
+    (*operands)[i] = std::move(ordered[i]);
 }
 
 std::vector<std::unique_ptr<INode>> ExtractMultipliers(const INode* node) {
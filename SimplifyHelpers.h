@@ -11,15 +11,18 @@ enum class CompareResult;
 struct CanonicMult;
 struct CanonicPow;
 class INode;
+class OperandsVector;
 
+// Compare() == Equal, rejecting nodes with different hashes without walking
+// them. Hashes don't order nodes, callers that sort use Compare().
+bool IsEqualNodes(const INode* lh, const INode* rh);
 CompareResult IsNodesTransitiveEqual(std::vector<const INode*> lhs,
                                      std::vector<const INode*> rhs);
 CompareResult IsNodesTransitiveEqual(
     const std::vector<std::unique_ptr<INode>*>& lhs,
     const std::vector<std::unique_ptr<INode>*>& rhs);
-CompareResult IsNodesTransitiveEqual(
-    const std::vector<std::unique_ptr<INode>>& lhs,
-    const std::vector<std::unique_ptr<INode>>& rhs);
+CompareResult IsNodesTransitiveEqual(const OperandsVector& lhs,
+                                     const OperandsVector& rhs);
 
 std::vector<std::unique_ptr<INode>> TakeEqualNodes(
     std::vector<std::unique_ptr<INode>>* lhs,
@@ -29,7 +32,7 @@ std::vector<std::unique_ptr<INode>> RemoveEqualNodes(
     std::vector<std::unique_ptr<INode>>* rhs);
 
 void ExctractNodesWithOp(Op op,
-                         std::vector<std::unique_ptr<INode>>* src,
+                         OperandsVector* src,
                          std::vector<std::unique_ptr<INode>>* nodes);
 void ExctractNodesWithOp(Op op,
                          std::unique_ptr<INode> src,
@@ -57,7 +60,6 @@ bool MergeCanonicToPow(HotToken& token,
                        std::vector<std::unique_ptr<INode>>* top,
                        std::vector<std::unique_ptr<INode>>* bottom);
 
-void ReorderOperands(std::vector<std::unique_ptr<INode>>* operands,
-                     bool move_const_to_front);
+void ReorderOperands(OperandsVector* operands, bool move_const_to_front);
 
 std::vector<std::unique_ptr<INode>> ExtractMultipliers(const INode* node);
@@ -0,0 +1,65 @@
+#include "SimplifyProfile.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <ostream>
+
+namespace {
+thread_local SimplifyProfile* g_current_profile = nullptr;
+}  // namespace
+
+SimplifyProfile::SimplifyProfile() : rules_(kRulesCount) {}
+
+SimplifyProfile::~SimplifyProfile() {}
+
+// static
+SimplifyProfile* SimplifyProfile::Current() {
+  return g_current_profile;
+}
+
+void SimplifyProfile::Reset() {
+  rules_.assign(kRulesCount, RuleStats());
+  calls_ = 0;
+}
+
+void SimplifyProfile::WriteReport(std::ostream& out) const {
+  std::vector<size_t> order(rules_.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [this](size_t lh, size_t rh) {
+    return rules_[lh].time > rules_[rh].time;
+  });
+  out << "SimplifyImpl calls: " << calls_ << "\n";
+  out << std::left << std::setw(4) << "#" << std::setw(18) << "rule"
+      << std::right << std::setw(12) << "invocations" << std::setw(10)
+      << "hits" << std::setw(10) << "restarts" << std::setw(12) << "time_ms"
+      << "\n";
+  for (size_t indx : order) {
+    const RuleStats& rule = rules_[indx];
+    if (!rule.name)
+      continue;
+    std::chrono::duration<double, std::milli> time = rule.time;
+    out << std::left << std::setw(4) << indx << std::setw(18) << rule.name
+        << std::right << std::setw(12) << rule.invocations << std::setw(10)
+        << rule.hits << std::setw(10) << rule.restarts << std::setw(12)
+        << std::fixed << std::setprecision(3) << time.count()
+        << std::defaultfloat << "\n";
+  }
+}
+
+SimplifyProfile::RuleStats* SimplifyProfile::Rule(size_t indx,
+                                                  const char* name) {
+  assert(indx < rules_.size());
+  rules_[indx].name = name;
+  return &rules_[indx];
+}
+
+ScopedSimplifyProfile::ScopedSimplifyProfile(SimplifyProfile* profile)
+    : previous_(g_current_profile) {
+  g_current_profile = profile;
+}
+
+ScopedSimplifyProfile::~ScopedSimplifyProfile() {
+  g_current_profile = previous_;
+}
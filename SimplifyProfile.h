@@ -0,0 +1,60 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <iosfwd>
+#include <vector>
+
+// Counters of the rules Operation::SimplifyImpl applies in turn, collected
+// while the profile is current on the thread, see ScopedSimplifyProfile.
+// Without a current profile the rules run unobserved.
+class SimplifyProfile {
+ public:
+  struct RuleStats {
+    const char* name = nullptr;
+    uint64_t invocations = 0;
+    // Runs that changed the tree.
+    uint64_t hits = 0;
+    // Runs that replaced the operation, so the rules started over.
+    uint64_t restarts = 0;
+    // Includes the simplifications nested in the rule.
+    std::chrono::steady_clock::duration time{};
+  };
+  // Rules Operation::SimplifyImpl applies. The table is sized once, so rules
+  // nested in a rule do not move the entry it records to.
+  static constexpr size_t kRulesCount = 10;
+
+  SimplifyProfile();
+  SimplifyProfile(const SimplifyProfile&) = delete;
+  ~SimplifyProfile();
+
+  // Profile of the current thread, may be null.
+  static SimplifyProfile* Current();
+
+  // Rules by their position in SimplifyImpl, unnamed until they run.
+  const std::vector<RuleStats>& Rules() const { return rules_; }
+  // Calls of SimplifyImpl on operations.
+  uint64_t Calls() const { return calls_; }
+  void Reset();
+  // Writes a table of the rules, the most expensive first.
+  void WriteReport(std::ostream& out) const;
+
+  void AddCall() { ++calls_; }
+  RuleStats* Rule(size_t indx, const char* name);
+
+ private:
+  std::vector<RuleStats> rules_;
+  uint64_t calls_ = 0;
+};
+
+// Makes |profile| current for the lifetime of the scope.
+class ScopedSimplifyProfile {
+ public:
+  explicit ScopedSimplifyProfile(SimplifyProfile* profile);
+  ScopedSimplifyProfile(const ScopedSimplifyProfile&) = delete;
+  ~ScopedSimplifyProfile();
+
+ private:
+  SimplifyProfile* previous_;
+};
@@ -52,10 +52,10 @@ std::unique_ptr<INode> SqrtOperation::Clone() const {
   return INodeHelper::MakeSqrt(Value()->Clone(), Exp()->Clone());
 }
 
-PrintSize SqrtOperation::Render(Canvas* canvas,
-                                PrintBox print_box,
-                                bool dry_run,
-                                RenderBehaviour render_behaviour) const {
+PrintSize SqrtOperation::RenderImpl(Canvas* canvas,
+                                    PrintBox print_box,
+                                    bool dry_run,
+                                    RenderBehaviour render_behaviour) const {
   PrintSize exp_size;
   bool print_exp = true;
   if (auto* exp_const = Exp()->AsConstant()) {
@@ -106,6 +106,8 @@ std::optional<CanonicPow> SqrtOperation::GetCanonicPow() {
   if (!exp_const || exp_const->IsNamed())
     return std::nullopt;
 
+  // The value may be written through the result.
+  InvalidateCaches();
   CanonicPow result = INodeHelper::GetCanonicPow(operands_[0]);
   for (auto& node_info : result.base_nodes)
     node_info.exp_down *= exp_const->Value();
@@ -2,6 +2,7 @@
 
 #include "Operation.h"
 
+double TrivialSqrt(double lh, double rh);
 std::unique_ptr<INode> NonTrivialSqrt(
     const OpInfo* op,
     std::vector<std::unique_ptr<INode>>* operands);
@@ -18,10 +19,10 @@ class SqrtOperation : public Operation {
   std::unique_ptr<INode> Clone() const override;
 
   // INodeImpl interface
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   bool HasFrontMinus() const override { return false; }
 
   // IOperation implementation
@@ -0,0 +1,156 @@
+// Command line driver for batches of expressions:
+//   symmath [options] [file ...]
+// Reads expressions from the files, or from stdin if there are none or the
+// name is "-". A file starting with the BinaryWriter magic is read as a
+// binary image, any other as infix text with one expression per line.
+// Pipeline steps run in the order they are given.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BatchProcessor.h"
+#include "BinaryFormat.h"
+#include "BinaryImage.h"
+#include "MappedFile.h"
+#include "Utf8.h"
+
+namespace {
+const char kUsage[] =
+    "usage: symmath [options] [file ...]\n"
+    "  -s, --simplify          simplify\n"
+    "  -b, --open-brackets     open brackets\n"
+    "  -d, --diff VAR          derivative by VAR\n"
+    "  -e, --eval X=1,Y=2      numeric value at the bindings\n"
+    "  -f, --format FORMAT     infix, latex, mathml or print; infix by default\n"
+    "  -j, --threads N         worker threads; all cores by default\n";
+
+int Usage(const char* error) {
+  if (error)
+    std::cerr << "symmath: " << error << "\n";
+  std::cerr << kUsage;
+  return 2;
+}
+
+bool ParseBindings(std::string_view text,
+                   std::vector<std::pair<std::wstring, double>>* bindings) {
+  while (!text.empty()) {
+    size_t end = text.find(',');
+    std::string_view binding = text.substr(0, end);
+    text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+    size_t equal = binding.find('=');
+    if (equal == 0 || equal == std::string_view::npos)
+      return false;
+    std::string value(binding.substr(equal + 1));
+    char* value_end = nullptr;
+    double number = strtod(value.c_str(), &value_end);
+    if (value.empty() || *value_end)
+      return false;
+    bindings->emplace_back(FromUtf8(binding.substr(0, equal)), number);
+  }
+  return true;
+}
+
+bool IsBinary(std::string_view data) {
+  return data.size() >= sizeof(kBinaryMagic) &&
+         std::memcmp(data.data(), kBinaryMagic, sizeof(kBinaryMagic)) == 0;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::vector<BatchStep> steps;
+  BatchOutput output = BatchOutput::Infix;
+  size_t threads_count = 0;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    auto value = [&]() -> const char* {
+      return i + 1 < argc ? argv[++i] : nullptr;
+    };
+    if (arg == "-h" || arg == "--help") {
+      return Usage(nullptr);
+    } else if (arg == "-s" || arg == "--simplify") {
+      steps.push_back({BatchStepType::Simplify});
+    } else if (arg == "-b" || arg == "--open-brackets") {
+      steps.push_back({BatchStepType::OpenBrackets});
+    } else if (arg == "-d" || arg == "--diff") {
+      const char* name = value();
+      if (!name || !*name)
+        return Usage("--diff needs a variable");
+      steps.push_back({BatchStepType::Diff, FromUtf8(name)});
+    } else if (arg == "-e" || arg == "--eval") {
+      const char* bindings = value();
+      BatchStep step = {BatchStepType::Evaluate};
+      if (!bindings || !ParseBindings(bindings, &step.bindings))
+        return Usage("--eval needs bindings like x=1,y=2");
+      steps.push_back(std::move(step));
+    } else if (arg == "-f" || arg == "--format") {
+      const char* format = value();
+      std::string_view name = format ? format : "";
+      if (name == "infix")
+        output = BatchOutput::Infix;
+      else if (name == "latex")
+        output = BatchOutput::Latex;
+      else if (name == "mathml")
+        output = BatchOutput::MathMl;
+      else if (name == "print")
+        output = BatchOutput::Print;
+      else
+        return Usage("unknown format");
+    } else if (arg == "-j" || arg == "--threads") {
+      const char* count = value();
+      threads_count = count ? strtoul(count, nullptr, 10) : 0;
+      if (threads_count == 0)
+        return Usage("--threads needs a positive number");
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      return Usage("unknown option");
+    } else {
+      paths.emplace_back(arg);
+    }
+  }
+  if (paths.empty())
+    paths.emplace_back("-");
+
+  BatchProcessor processor(std::move(steps), output, threads_count);
+  // Inputs stay alive until the batch is done, the processor refers to them.
+  std::vector<std::unique_ptr<MappedFile>> files;
+  std::vector<std::unique_ptr<BinaryImage>> images;
+  std::string stdin_data;
+  for (const std::string& path : paths) {
+    std::string_view data;
+    if (path == "-") {
+      if (!stdin_data.empty())
+        continue;
+      stdin_data.assign(std::istreambuf_iterator<char>(std::cin),
+                        std::istreambuf_iterator<char>());
+      data = stdin_data;
+    } else {
+      files.push_back(MappedFile::Open(path));
+      if (!files.back()) {
+        std::cerr << "symmath: can not read " << path << "\n";
+        return 2;
+      }
+      data = files.back()->Data();
+    }
+    if (IsBinary(data)) {
+      images.push_back(BinaryImage::Open(data));
+      if (!images.back()) {
+        std::cerr << "symmath: damaged binary image " << path << "\n";
+        return 2;
+      }
+      processor.AddImage(images.back().get());
+    } else {
+      processor.AddText(data);
+    }
+  }
+
+  std::ios_base::sync_with_stdio(false);
+  return processor.Run(std::cout) == 0 ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#include "Symbol.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Exception.h"
+
+namespace {
+// Names and their hashes are stored in blocks that never move, so Name()
+// reads them without the lock: an id only reaches other threads after
+// Intern() wrote its entry.
+class SymbolTable {
+ public:
+  SymbolTable() { AddName(std::wstring()); }
+
+  static SymbolTable& Get() {
+    static SymbolTable table;
+    return table;
+  }
+
+  uint32_t Intern(const std::wstring& name) {
+    if (name.empty())
+      return 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    if (it != ids_.end())
+      return it->second;
+    uint32_t id = AddName(name);
+    ids_.emplace(Name(id), id);
+    return id;
+  }
+
+  const std::wstring& Name(uint32_t id) const { return GetEntry(id).name; }
+  uint64_t NameHash(uint32_t id) const { return GetEntry(id).hash; }
+
+ private:
+  static constexpr uint32_t kBlockSize = 1024;
+  static constexpr uint32_t kMaxBlocks = 4096;
+
+  struct Entry {
+    std::wstring name;
+    uint64_t hash = 0;
+  };
+
+  const Entry& GetEntry(uint32_t id) const {
+    return blocks_[id / kBlockSize].load(std::memory_order_acquire)
+        [id % kBlockSize];
+  }
+
+  static uint64_t HashName(const std::wstring& name) {
+    uint64_t result = 0xcbf29ce484222325ull;
+    for (wchar_t ch : name) {
+      result ^= static_cast<uint32_t>(ch);
+      result *= 0x100000001b3ull;
+    }
+    return result;
+  }
+
+  // Called with |mutex_| held, or from the constructor.
+  uint32_t AddName(const std::wstring& name) {
+    uint32_t id = size_;
+    if (id / kBlockSize >= kMaxBlocks)
+      throw Exception("too many symbols");
+    std::atomic<Entry*>& slot = blocks_[id / kBlockSize];
+    Entry* block = slot.load(std::memory_order_relaxed);
+    if (!block) {
+      block = new Entry[kBlockSize];
+      owned_blocks_.emplace_back(block);
+      slot.store(block, std::memory_order_release);
+    }
+    block[id % kBlockSize].name = name;
+    block[id % kBlockSize].hash = HashName(name);
+    ++size_;
+    return id;
+  }
+
+  std::mutex mutex_;
+  std::atomic<Entry*> blocks_[kMaxBlocks] = {};
+  std::vector<std::unique_ptr<Entry[]>> owned_blocks_;
+  uint32_t size_ = 0;
+  // The keys view into the blocks.
+  std::unordered_map<std::wstring_view, uint32_t> ids_;
+};
+}  // namespace
+
+Symbol::Symbol(const std::wstring& name)
+    : id_(SymbolTable::Get().Intern(name)) {}
+
+const std::wstring& Symbol::Name() const {
+  return SymbolTable::Get().Name(id_);
+}
+
+uint64_t Symbol::NameHash() const {
+  return SymbolTable::Get().NameHash(id_);
+}
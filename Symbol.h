@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+
+// Interned name. All symbols with the same text share one id, so equality is
+// an integer comparison. Ids follow the order names were first interned, so
+// anything observable orders by Name() and hashes NameHash(). Interning is
+// thread-safe and ids are never freed.
+class Symbol {
+ public:
+  Symbol() {}
+  explicit Symbol(const std::wstring& name);
+
+  uint32_t Id() const { return id_; }
+  bool IsEmpty() const { return id_ == 0; }
+  const std::wstring& Name() const;
+  // Hash of the text, the same in every run.
+  uint64_t NameHash() const;
+
+  bool operator==(Symbol rh) const { return id_ == rh.id_; }
+  bool operator!=(Symbol rh) const { return id_ != rh.id_; }
+  // Orders by id, for containers private to one run only.
+  bool operator<(Symbol rh) const { return id_ < rh.id_; }
+
+ private:
+  uint32_t id_ = 0;
+};
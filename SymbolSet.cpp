@@ -0,0 +1,51 @@
+#include "SymbolSet.h"
+
+namespace {
+constexpr uint32_t kWordBits = 64;
+}  // namespace
+
+SymbolSet::SymbolSet() {}
+
+SymbolSet::~SymbolSet() {}
+
+bool SymbolSet::Contains(Symbol symbol) const {
+  uint32_t word = symbol.Id() / kWordBits;
+  if (word < first_word_ || word - first_word_ >= words_.size())
+    return false;
+  return (words_[word - first_word_] >> (symbol.Id() % kWordBits)) & 1;
+}
+
+void SymbolSet::Insert(Symbol symbol) {
+  uint32_t word = symbol.Id() / kWordBits;
+  Cover(word, word + 1);
+  words_[word - first_word_] |= uint64_t(1) << (symbol.Id() % kWordBits);
+}
+
+void SymbolSet::InsertAll(const SymbolSet& other) {
+  if (other.IsEmpty())
+    return;
+  Cover(other.first_word_,
+        other.first_word_ + static_cast<uint32_t>(other.words_.size()));
+  uint32_t offset = other.first_word_ - first_word_;
+  for (size_t i = 0; i < other.words_.size(); ++i)
+    words_[offset + i] |= other.words_[i];
+}
+
+void SymbolSet::Clear() {
+  first_word_ = 0;
+  words_.clear();
+}
+
+void SymbolSet::Cover(uint32_t first_word, uint32_t end_word) {
+  if (words_.empty()) {
+    first_word_ = first_word;
+    words_.assign(end_word - first_word, 0);
+    return;
+  }
+  if (first_word < first_word_) {
+    words_.insert(words_.begin(), first_word_ - first_word, 0);
+    first_word_ = first_word;
+  }
+  if (end_word - first_word_ > words_.size())
+    words_.resize(end_word - first_word_, 0);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "Symbol.h"
+
+// Bitset over symbol ids. Only the words between the lowest and the highest
+// member are stored, so sets of nearby symbols stay small however many
+// symbols were interned before them.
+class SymbolSet {
+ public:
+  SymbolSet();
+  ~SymbolSet();
+
+  bool IsEmpty() const { return words_.empty(); }
+  bool Contains(Symbol symbol) const;
+  void Insert(Symbol symbol);
+  void InsertAll(const SymbolSet& other);
+  void Clear();
+
+ private:
+  // Grows the stored words to cover [first_word, end_word).
+  void Cover(uint32_t first_word, uint32_t end_word);
+
+  uint32_t first_word_ = 0;
+  std::vector<uint64_t> words_;
+};
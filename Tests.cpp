@@ -1,14 +1,45 @@
 #include "Tests.h"
 
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+#include <complex>
 #include <iostream>
+#include <sstream>
 #include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "BatchProcessor.h"
+#include "BinaryFormat.h"
+#include "BinaryImage.h"
+#include "BinaryWriter.h"
+#include "Brackets.h"
+#include "CompiledExpression.h"
 #include "DivOperation.h"
+#include "EvaluationContext.h"
 #include "INode.h"
 #include "INodeHelper.h"
+#include "LogOperation.h"
+#include "MultOperation.h"
+#include "NodeArena.h"
+#include "NodeTable.h"
+#include "OpInfo.h"
 #include "Operation.h"
+#include "Parser.h"
 #include "PlusOperation.h"
+#include "RandomExpression.h"
+#include "Sequence.h"
+#include "Serializer.h"
+#include "SimplifyProfile.h"
+#include "Symbol.h"
+#include "Utf8.h"
 #include "ValueHelpers.h"
+#include "VariableScope.h"
 
 namespace {
 using TestF = bool (*)();
@@ -23,12 +54,59 @@ const TestInfo kTests[] = {
     {&Tests::TestSimplifyDivDiv, "TestSimplifyDivDiv"},
     {&Tests::TestSimplifyImaginary, "TestSimplifyImaginary"},
     {&Tests::TestOpenBrackets, "TestOpenBrackets"},
+    {&Tests::TestNodeArena, "TestNodeArena"},
+    {&Tests::TestNodeTable, "TestNodeTable"},
+    {&Tests::TestStructuralHash, "TestStructuralHash"},
+    {&Tests::TestOperandsVector, "TestOperandsVector"},
+    {&Tests::TestSymbolTable, "TestSymbolTable"},
+    {&Tests::TestIncrementalSimplify, "TestIncrementalSimplify"},
+    {&Tests::TestPlusLikeTerms, "TestPlusLikeTerms"},
+    {&Tests::TestOpenBracketsPolynomial, "TestOpenBracketsPolynomial"},
+    {&Tests::TestCompiledExpression, "TestCompiledExpression"},
+    {&Tests::TestBatchEvaluation, "TestBatchEvaluation"},
+    {&Tests::TestBatchKernels, "TestBatchKernels"},
+    {&Tests::TestConcurrentEvaluation, "TestConcurrentEvaluation"},
+    {&Tests::TestSymCalcNumeric, "TestSymCalcNumeric"},
+    {&Tests::TestForwardDerivatives, "TestForwardDerivatives"},
+    {&Tests::TestReverseGradient, "TestReverseGradient"},
+    {&Tests::TestDiffSharedSubtrees, "TestDiffSharedSubtrees"},
+    {&Tests::TestFreeVariables, "TestFreeVariables"},
+    {&Tests::TestPrintLayoutCache, "TestPrintLayoutCache"},
+    {&Tests::TestPrintToBands, "TestPrintToBands"},
+    {&Tests::TestSerializers, "TestSerializers"},
+    {&Tests::TestParser, "TestParser"},
+    {&Tests::TestBinaryFormat, "TestBinaryFormat"},
+    {&Tests::TestBatchProcessor, "TestBatchProcessor"},
+    {&Tests::TestCountNodes, "TestCountNodes"},
+    {&Tests::TestRandomExpression, "TestRandomExpression"},
+    {&Tests::TestSimplifyProfile, "TestSimplifyProfile"},
+    {&Tests::TestSerializeRoundTrip, "TestSerializeRoundTrip"},
 };
+
+// Distance in representable doubles, NaNs match only NaNs.
+uint64_t UlpDistance(double lh, double rh) {
+  if (std::isnan(lh) || std::isnan(rh))
+    return std::isnan(lh) && std::isnan(rh) ? 0 : UINT64_MAX;
+  auto ordered = [](double value) {
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits < 0 ? INT64_MIN - bits : bits;
+  };
+  int64_t lh_bits = ordered(lh);
+  int64_t rh_bits = ordered(rh);
+  return lh_bits < rh_bits ? uint64_t(rh_bits) - uint64_t(lh_bits)
+                           : uint64_t(lh_bits) - uint64_t(rh_bits);
+}
 }  // namespace
 
-void Tests::Run() {
+size_t Tests::Run(std::string_view only, std::string_view skip) {
+  size_t failed = 0;
   for (auto test : kTests) {
+    if ((!only.empty() && only != test.Name) || skip == test.Name)
+      continue;
     bool succ = test.test_f();
+    if (!succ)
+      ++failed;
     std::string response(test.Name);
     if (succ)
       response += " OK";
@@ -36,6 +114,7 @@ void Tests::Run() {
       response += " Failed";
     std::wcout << std::wstring(response.begin(), response.end()) << std::endl;
   }
+  return failed;
 }
 
 // static
@@ -157,4 +236,1077 @@ bool Tests::TestOpenBrackets() {
   if (result->Compare(expected_result.get()) != CompareResult::Equal)
     return false;
   return true;
-}
\ No newline at end of file
+}
+
+// static
+bool Tests::TestNodeArena() {
+  auto a = Var(L"a", 1);
+  auto b = Var(L"b", 2);
+  auto c = Var(L"c", 3);
+  Variable s = (a + b) * (b + c) * (a + c);
+  s.OpenBrackets();
+  s.Simplify();
+  if (!s.arena_ || s.arena_->GetStats().live_blocks == 0)
+    return false;
+  auto expected_result = Const(60);
+  auto result = s.SymCalc(SymCalcSettings::Full);
+  if (result->Compare(expected_result.get()) != CompareResult::Equal)
+    return false;
+  size_t resets = s.arena_->GetStats().resets;
+  s = 1;
+  if (s.arena_->GetStats().live_blocks != 0)
+    return false;
+  if (s.arena_->GetStats().resets != resets + 1)
+    return false;
+  return true;
+}
+
+// static
+bool Tests::TestNodeTable() {
+  auto a = Var(L"a", 1);
+  auto b = Var(L"b", 2);
+  NodeTable table;
+  auto lh = table.Intern(Sin(a + b) * (a + b));
+  auto rh = table.Intern(Sin(a + b) * (a + b));
+  if (lh != rh || table.Size() != 3)
+    return false;
+  Variable s = NodeTable::Instance(lh) + NodeTable::Instance(rh);
+  s.Simplify();
+  auto expected_shared = Sin(a + b) * (a + b);
+  if (lh->Compare(expected_shared.get()) != CompareResult::Equal)
+    return false;
+  auto expected_result = Const(6 * sin(3.0));
+  auto result = s.SymCalc(SymCalcSettings::Full);
+  if (result->Compare(expected_result.get()) != CompareResult::Equal)
+    return false;
+  return true;
+}
+
+// static
+bool Tests::TestStructuralHash() {
+  auto a = Var(L"a", 1);
+  auto b = Var(L"b", 2);
+  auto lh = Sin(a + b) * Pow(a, b);
+  auto rh = Pow(a, b) * Sin(b + a);
+  if (lh->AsNodeImpl()->Hash() != rh->AsNodeImpl()->Hash())
+    return false;
+  if (lh->Compare(rh.get()) != CompareResult::Equal)
+    return false;
+  auto other = Sin(a - b) * Pow(a, b);
+  if (lh->AsNodeImpl()->Hash() == other->AsNodeImpl()->Hash())
+    return false;
+  if (lh->Compare(other.get()) == CompareResult::Equal)
+    return false;
+  // Unequal trees still order structurally, not by hash.
+  if (Sin(a)->Compare(Sin(b).get()) != CompareResult::Less ||
+      Sin(b)->Compare(Sin(a).get()) != CompareResult::Greater) {
+    return false;
+  }
+
+  Variable s = a + b;
+  auto hash = s.Hash();
+  s.AsOperation()->SetOperand(1, a);
+  if (s.Hash() == hash || s.Hash() != (a + a)->AsNodeImpl()->Hash())
+    return false;
+  s = b + a;
+  if (s.Hash() != hash)
+    return false;
+
+  // A write deep in a tree drops the cached hashes up to its root.
+  hash = lh->AsNodeImpl()->Hash();
+  auto* sin = lh->AsNodeImpl()->AsOperation()->Operand(0)->AsOperation();
+  sin->Operand(0)->AsOperation()->SetOperand(1, Const(3));
+  if (lh->AsNodeImpl()->Hash() == hash ||
+      lh->AsNodeImpl()->Hash() !=
+          (Sin(a + 3) * Pow(a, b))->AsNodeImpl()->Hash()) {
+    return false;
+  }
+  if (rh->AsNodeImpl()->Hash() != hash)
+    return false;
+
+  // A node that can't cache its hash leaves no back-pointers in the children
+  // that outlive it.
+  Variable anonymous(Const(2));
+  auto diff = Diff(Sin(a + b), anonymous);
+  diff->AsNodeImpl()->Hash();
+  auto child = diff->AsNodeImpl()->AsOperation()->TakeOperand(0);
+  diff.reset();
+  if (child->AsNodeImpl()->cache_parent_)
+    return false;
+  child->AsNodeImpl()->AsOperation()->SetOperand(0, a + 3);
+  return child->AsNodeImpl()->Hash() == Sin(a + 3)->AsNodeImpl()->Hash();
+}
+
+// static
+bool Tests::TestOperandsVector() {
+  auto a = Var(L"a", 1);
+  auto b = Var(L"b", 2);
+  Variable s = a * b;
+  auto& operands = s.AsOperation()->operands_;
+  if (!operands.IsInline())
+    return false;
+  operands.push_back(Const(3));
+  operands.push_back(Const(4));
+  operands.insert(operands.begin() + 1, Const(5));
+  if (operands.IsInline() || operands.size() != 5)
+    return false;
+  operands[3].reset();
+  INodeHelper::RemoveEmptyOperands(&operands);
+  if (operands.size() != 4)
+    return false;
+  auto expected_result = Const(1 * 5 * 2 * 4);
+  auto result = s.SymCalc(SymCalcSettings::Full);
+  if (result->Compare(expected_result.get()) != CompareResult::Equal)
+    return false;
+
+  // Reads through the non-const accessors keep the cached hash, changing the
+  // list drops it.
+  s.Hash();
+  Operation* mult = s.AsOperation();
+  for (auto& operand : operands)
+    operand->AsNodeImpl();
+  if (!operands[0] || !operands.front() || !operands.back() ||
+      !mult->hash_valid_) {
+    return false;
+  }
+  INodeHelper::RemoveEmptyOperands(&operands);
+  if (!mult->hash_valid_)
+    return false;
+  operands.push_back(Const(6));
+  return !mult->hash_valid_;
+}
+
+// static
+bool Tests::TestSymbolTable() {
+  const size_t kNames = 100;
+  std::vector<Symbol> symbols[4];
+  std::vector<std::thread> threads;
+  for (auto& thread_symbols : symbols) {
+    threads.emplace_back([&thread_symbols]() {
+      for (size_t i = 0; i < kNames; ++i)
+        thread_symbols.emplace_back(L"sym" + std::to_wstring(i));
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  for (size_t i = 0; i < kNames; ++i) {
+    for (const auto& thread_symbols : symbols) {
+      if (thread_symbols[i] != symbols[0][i])
+        return false;
+    }
+    if (symbols[0][i].Name() != L"sym" + std::to_wstring(i))
+      return false;
+  }
+
+  auto x = Var(L"sym1");
+  if (x.GetSymbol() != symbols[0][1] || Symbol(L"").Id() != 0)
+    return false;
+
+  // Variables order and hash by name, not by the order of interning.
+  auto late_b = Var(L"order_b");
+  auto late_a = Var(L"order_a");
+  if (late_a.Compare(&late_b) != CompareResult::Less)
+    return false;
+  if (Symbol(L"order_a").NameHash() == Symbol(L"order_b").NameHash())
+    return false;
+  return true;
+}
+
+// static
+bool Tests::TestIncrementalSimplify() {
+  auto a = Var(L"a", 2);
+  auto b = Var(L"b", 3);
+  Variable s = Sin(a * b + 0 * a) + a * b * 2 - b * a;
+  s.Simplify();
+  auto* op = s.AsOperation();
+  if (!op)
+    return false;
+  Operation* sin_op = nullptr;
+  for (size_t i = 0; i < op->OperandsCount(); ++i) {
+    auto* operand = op->Operand(i)->AsOperation();
+    if (operand && operand->op() == Op::Sin)
+      sin_op = operand;
+  }
+  if (!sin_op || !sin_op->IsNormalForm())
+    return false;
+  sin_op->SetOperand(0, a * b + 0 * a);
+  if (sin_op->IsNormalForm())
+    return false;
+  s.Simplify();
+  auto expected_result = Const(sin(6.0) + 6.0);
+  auto result = s.SymCalc(SymCalcSettings::Full);
+  if (result->Compare(expected_result.get()) != CompareResult::Equal)
+    return false;
+  return true;
+}
+
+// static
+bool Tests::TestPlusLikeTerms() {
+  const size_t kTerms = 300;
+  auto a = Var(L"a", 1);
+  auto b = Var(L"b", 2);
+  auto c = Var(L"c", 3);
+  std::vector<std::unique_ptr<INode>> terms;
+  for (size_t k = 1; k <= kTerms; ++k) {
+    terms.push_back(static_cast<double>(k) * (a * b));
+    terms.push_back(c * static_cast<double>(k));
+    terms.push_back(-(b * a));
+  }
+  Variable s(INodeHelper::MakePlus(std::move(terms)));
+  s.Simplify();
+  auto* plus = INodeHelper::AsPlus(s.AsOperation());
+  if (!plus || plus->OperandsCount() != 2)
+    return false;
+  double sum = kTerms * (kTerms + 1) / 2;
+  auto expected_result = Const((sum - kTerms) * 2 + sum * 3);
+  auto result = s.SymCalc(SymCalcSettings::Full);
+  if (result->Compare(expected_result.get()) != CompareResult::Equal)
+    return false;
+  return true;
+}
+
+// static
+bool Tests::TestOpenBracketsPolynomial() {
+  auto a = Var(L"a", 1);
+  auto b = Var(L"b", 2);
+  std::vector<std::unique_ptr<INode>> factors;
+  for (size_t i = 0; i < 7; ++i)
+    factors.push_back(a + b);
+  Variable s(INodeHelper::MakeMult(std::move(factors)));
+  s.OpenBrackets();
+  auto* plus = INodeHelper::AsPlus(s.AsOperation());
+  if (!plus || plus->operands_.size() != 8)
+    return false;
+  auto expected_result = Const(2187);
+  auto result = s.SymCalc(SymCalcSettings::Full);
+  if (result->Compare(expected_result.get()) != CompareResult::Equal)
+    return false;
+
+  // The exponents of a reach 257.
+  factors.clear();
+  for (size_t i = 0; i < 7; ++i)
+    factors.push_back(a + b);
+  factors.push_back(Pow(a, 250));
+  Variable high(INodeHelper::MakeMult(std::move(factors)));
+  high.OpenBrackets();
+  plus = INodeHelper::AsPlus(high.AsOperation());
+  if (!plus || plus->operands_.size() != 8)
+    return false;
+  result = high.SymCalc(SymCalcSettings::Full);
+  if (result->Compare(expected_result.get()) != CompareResult::Equal)
+    return false;
+
+  // Imaginary factors expand without a polynomial.
+  factors.clear();
+  for (size_t i = 0; i < 6; ++i)
+    factors.push_back(a + b * Imag());
+  Variable imag(INodeHelper::MakeMult(std::move(factors)));
+  imag.OpenBrackets();
+  imag.Simplify();
+  plus = INodeHelper::AsPlus(imag.AsOperation());
+  if (!plus || plus->operands_.size() != 7)
+    return false;
+  return true;
+}
+
+// static
+bool Tests::TestCompiledExpression() {
+  auto a = Var(L"a", 2);
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  Variable s = Sin(x) * a + Pow(x, y) / (x + 1) - Sqrt(x * y) + Log(a * x);
+  std::shared_ptr<const CompiledExpression> compiled =
+      CompiledExpression::Compile(&s, {x.GetSymbol(), y.GetSymbol()});
+  if (!compiled || compiled->IsComplex())
+    return false;
+  EvaluationContext context(compiled);
+  for (double x_value : {0.5, 1.0, 3.0}) {
+    const double bindings[] = {x_value, 2.0};
+    context.BindAll(bindings);
+    double expected_result = sin(x_value) * 2 +
+                             pow(x_value, 2.0) / (x_value + 1) -
+                             sqrt(x_value * 2.0) + log(2 * x_value);
+    if (std::abs(context.Evaluate() - expected_result) > 1e-12)
+      return false;
+  }
+
+  Variable c = Imag() * x + a;
+  std::shared_ptr<const CompiledExpression> compiled_complex =
+      CompiledExpression::Compile(&c, {x.GetSymbol()});
+  if (!compiled_complex || !compiled_complex->IsComplex())
+    return false;
+  EvaluationContext complex_context(compiled_complex);
+  if (!complex_context.Bind(x.GetSymbol(), 3.0) ||
+      complex_context.Bind(a.GetSymbol(), 3.0) ||
+      complex_context.EvaluateComplex() != std::complex<double>(2.0, 3.0)) {
+    return false;
+  }
+
+  if (CompiledExpression::Compile(&s, {x.GetSymbol()}))
+    return false;
+  return true;
+}
+
+// static
+bool Tests::TestBatchEvaluation() {
+  auto a = Var(L"a", 2);
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  Variable s = Sin(x) * a + Cos(x * y) - Pow(x, 3) / (y * y + 1) +
+               Sqrt(x) + Log(a * x) - Pow(x, y);
+  std::shared_ptr<const CompiledExpression> compiled =
+      CompiledExpression::Compile(&s, {x.GetSymbol(), y.GetSymbol()});
+  if (!compiled)
+    return false;
+  EvaluationContext context(compiled);
+  // Odd count to cover the tails, a few huge and negative arguments to cover
+  // the lanes the vector approximations leave to the library functions.
+  const size_t count = 1001;
+  std::vector<double> x_values(count);
+  std::vector<double> y_values(count);
+  for (size_t i = 0; i < count; ++i) {
+    x_values[i] = 0.001 + i * 0.037;
+    y_values[i] = -3.0 + i * 0.006;
+  }
+  x_values[17] = 1e9;
+  x_values[400] = -2.5;
+  x_values[999] = 0.0;
+  const double* bindings[] = {x_values.data(), y_values.data()};
+  std::vector<double> output(count);
+  // Levels the CPU lacks fall back to the supported one.
+  for (auto level : {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2}) {
+    context.EvaluateBatch(bindings, count, output.data(), level);
+    for (size_t i = 0; i < count; ++i) {
+      const double point[] = {x_values[i], y_values[i]};
+      context.BindAll(point);
+      double expected_result = context.Evaluate();
+      if (std::isnan(expected_result) != std::isnan(output[i]))
+        return false;
+      if (std::abs(output[i] - expected_result) >
+          1e-12 * std::max(1.0, std::abs(expected_result))) {
+        return false;
+      }
+    }
+  }
+
+  // A square root by Pow keeps the signs std::pow gives.
+  Variable root = Pow(x, 0.5);
+  compiled = CompiledExpression::Compile(&root, {x.GetSymbol()});
+  if (!compiled)
+    return false;
+  EvaluationContext root_context(compiled);
+  const double roots[] = {-INFINITY, -0.0, 0.0, 4.0, 2.0, -4.0, INFINITY};
+  const size_t roots_count = sizeof(roots) / sizeof(roots[0]);
+  const double* root_bindings[] = {roots};
+  for (auto level : {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2}) {
+    root_context.EvaluateBatch(root_bindings, roots_count, output.data(),
+                               level);
+    for (size_t i = 0; i < roots_count; ++i) {
+      root_context.BindAll(&roots[i]);
+      double expected_result = root_context.Evaluate();
+      if (std::isnan(expected_result) ? !std::isnan(output[i])
+                                      : memcmp(&expected_result, &output[i],
+                                               sizeof(double)) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// static
+bool Tests::TestBatchKernels() {
+  // Every binade from the smallest denormal to the largest double, both
+  // signs, zeros and infinities.
+  std::vector<double> values = {0.0, -0.0, INFINITY, -INFINITY, NAN};
+  for (int exp = -1074; exp <= 1023; ++exp) {
+    for (double mantissa : {1.0, 1.1, 1.37, 1.5, 1.77, 1.999}) {
+      values.push_back(std::ldexp(mantissa, exp));
+      values.push_back(-std::ldexp(mantissa, exp));
+    }
+  }
+  // Worst cases measured on millions of random doubles: 3 ulp for 1/x^4 and
+  // log, 2 for sin and cos.
+  const uint64_t kPowIntMaxUlps = 3;
+  std::vector<double> output(values.size());
+  for (auto level : {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2}) {
+    const BatchKernels* kernels = GetBatchKernels(level);
+    if (!kernels)
+      continue;
+    for (int exp = -BatchKernels::kMaxPowInt; exp <= BatchKernels::kMaxPowInt;
+         ++exp) {
+      kernels->pow_int(values.data(), exp, output.data(), values.size());
+      for (size_t i = 0; i < values.size(); ++i) {
+        if (UlpDistance(output[i], std::pow(values[i], exp)) > kPowIntMaxUlps)
+          return false;
+      }
+    }
+    const std::tuple<BatchKernels::UnaryF, double (*)(double), uint64_t>
+        functions[] = {{kernels->sin, &std::sin, 2},
+                       {kernels->cos, &std::cos, 2},
+                       {kernels->log, &std::log, 3}};
+    for (const auto& [kernel, library_f, max_ulps] : functions) {
+      kernel(values.data(), output.data(), values.size());
+      for (size_t i = 0; i < values.size(); ++i) {
+        if (UlpDistance(output[i], library_f(values[i])) > max_ulps)
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+// static
+bool Tests::TestConcurrentEvaluation() {
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  Variable s = Sin(x) * y + Pow(x, 2) / (y + 1);
+  std::shared_ptr<const CompiledExpression> compiled =
+      CompiledExpression::Compile(&s, {x.GetSymbol(), y.GetSymbol()});
+  if (!compiled)
+    return false;
+  const size_t kPoints = 10000;
+  const Symbol y_symbol = y.GetSymbol();
+  bool results[4] = {};
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&compiled, &results, &y_symbol, t, kPoints]() {
+      EvaluationContext context(compiled);
+      context.Bind(y_symbol, static_cast<double>(t));
+      results[t] = true;
+      for (size_t i = 0; i < kPoints; ++i) {
+        double x_value = i * 0.001;
+        context.Bind(size_t(0), x_value);
+        double expected_result =
+            sin(x_value) * t + x_value * x_value / (t + 1.0);
+        if (std::abs(context.Evaluate() - expected_result) > 1e-12)
+          results[t] = false;
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  for (bool result : results) {
+    if (!result)
+      return false;
+  }
+  return true;
+}
+
+// static
+bool Tests::TestSymCalcNumeric() {
+  auto a = Var(L"a", 2);
+  auto x = Var(L"x");
+  Variable s = Sin(Const(2)) * 3 + Pow(a, 2) / 4 - Sqrt(Const(8), 3);
+  auto expected_result = Const(sin(2.0) * 3 + 1 - 2);
+  auto result = s.SymCalc(SymCalcSettings::Full);
+  if (result->Compare(expected_result.get()) != CompareResult::Equal)
+    return false;
+
+  // Numeric operands are folded up to the symbolic boundary.
+  Variable mixed = (Const(2) + a) * x;
+  expected_result = Const(4) * x;
+  result = mixed.SymCalc(SymCalcSettings::Full);
+  if (result->Compare(expected_result.get()) != CompareResult::Equal)
+    return false;
+
+  Variable named = Constants::MakeE() * a;
+  result = named.SymCalc(SymCalcSettings::KeepNamedConstants);
+  if (!result->AsNodeImpl()->AsOperation())
+    return false;
+  result = named.SymCalc(SymCalcSettings::Full);
+  expected_result = Const(Constants::E()->Value() * 2);
+  if (result->Compare(expected_result.get()) != CompareResult::Equal)
+    return false;
+
+  Variable root = Sqrt(a + 2);
+  result = root.SymCalc(SymCalcSettings::Full);
+  const Sequence* roots = INodeHelper::AsSequence(result.get());
+  if (!roots || roots->Size() != 2)
+    return false;
+  return true;
+}
+
+// static
+bool Tests::TestForwardDerivatives() {
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  auto f = [&x, &y]() {
+    return Sin(x) * y + Pow(x, 3) / (y + 1) + Log(x * y) - Cos(y) / x +
+           Pow(x, y) + Pow(Const(2), y) + Pow(x + y, x) + Sqrt(x * x + y, 3) +
+           Sqrt(x * y, x + 2) + INodeHelper::MakeLog(x + 2, x * y + 1);
+  };
+  Variable s = f();
+  std::shared_ptr<const CompiledExpression> compiled =
+      CompiledExpression::Compile(&s, {x.GetSymbol(), y.GetSymbol()});
+  if (!compiled)
+    return false;
+  EvaluationContext context(compiled);
+  const double point[] = {1.3, 0.7};
+  context.BindAll(point);
+  double gradient[2];
+  double value = context.EvaluateGradient(gradient);
+  if (value != context.Evaluate())
+    return false;
+
+  // The same as the symbolic derivatives.
+  Variable dx_diff = Diff(f(), x);
+  Variable dy_diff = Diff(f(), y);
+  Variable dx(dx_diff.SymCalc(SymCalcSettings::KeepNamedConstants));
+  Variable dy(dy_diff.SymCalc(SymCalcSettings::KeepNamedConstants));
+  x = point[0];
+  y = point[1];
+  auto dx_value = dx.SymCalc(SymCalcSettings::Full);
+  auto dy_value = dy.SymCalc(SymCalcSettings::Full);
+  const Constant* expected_dx = INodeHelper::AsConstant(dx_value.get());
+  const Constant* expected_dy = INodeHelper::AsConstant(dy_value.get());
+  if (!expected_dx || !expected_dy)
+    return false;
+  if (std::abs(gradient[0] - expected_dx->Value()) > 1e-9 ||
+      std::abs(gradient[1] - expected_dy->Value()) > 1e-9) {
+    return false;
+  }
+
+  // Several directions in one pass.
+  const double directions[] = {1.0, 2.0, 0.0, -1.0};
+  double derivatives[2];
+  context.EvaluateDerivatives(directions, 2, derivatives);
+  if (std::abs(derivatives[0] - (gradient[0] + 2 * gradient[1])) > 1e-12 ||
+      std::abs(derivatives[1] + gradient[1]) > 1e-12) {
+    return false;
+  }
+  return true;
+}
+
+// static
+bool Tests::TestReverseGradient() {
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  auto z = Var(L"z");
+  auto f = [&x, &y, &z]() {
+    return Vector3(x, y, x * z) * Vector3(Sin(y), z, Const(2)) +
+           VectorMult(Vector3(x, Const(1), y), Vector3(z, x * y, Const(3))) *
+               Vector3(Log(z), -y, x) +
+           (x * -Vector3(y, z, Pow(z, x))) *
+               (Vector3(z, Const(2), y) + Vector3(y, x, z));
+  };
+  Variable s = f();
+  std::shared_ptr<const CompiledExpression> compiled =
+      CompiledExpression::Compile(
+          &s, {x.GetSymbol(), y.GetSymbol(), z.GetSymbol()});
+  if (!compiled)
+    return false;
+  EvaluationContext context(compiled);
+  const double point[] = {1.3, 0.7, 2.1};
+  context.BindAll(point);
+  double gradient[3];
+  double value = context.EvaluateGradient(gradient);
+
+  // Vectors follow the symbolic scalar and vector products.
+  x = point[0];
+  y = point[1];
+  z = point[2];
+  auto expected_value = s.SymCalc(SymCalcSettings::Full);
+  const Constant* expected = INodeHelper::AsConstant(expected_value.get());
+  if (!expected || std::abs(value - expected->Value()) > 1e-12)
+    return false;
+
+  const double directions[] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+  double derivatives[3];
+  context.EvaluateDerivatives(directions, 3, derivatives);
+  for (size_t i = 0; i < 3; ++i) {
+    if (std::abs(gradient[i] - derivatives[i]) > 1e-12)
+      return false;
+  }
+
+  // One sweep for many variables.
+  std::vector<std::unique_ptr<Variable>> vars;
+  std::vector<Symbol> symbols;
+  for (int i = 0; i < 50; ++i) {
+    vars.push_back(std::make_unique<Variable>(L"x" + std::to_wstring(i)));
+    symbols.push_back(vars.back()->GetSymbol());
+  }
+  std::unique_ptr<INode> sum = *vars[0] * *vars[1];
+  for (size_t i = 1; i + 1 < vars.size(); ++i)
+    sum = std::move(sum) + *vars[i] * *vars[i + 1];
+  compiled = CompiledExpression::Compile(sum.get(), symbols);
+  if (!compiled)
+    return false;
+  EvaluationContext sum_context(compiled);
+  std::vector<double> values(vars.size());
+  for (size_t i = 0; i < values.size(); ++i)
+    values[i] = i * 0.5 - 3;
+  sum_context.BindAll(values.data());
+  std::vector<double> sum_gradient(vars.size());
+  sum_context.EvaluateGradient(sum_gradient.data());
+  for (size_t i = 0; i < values.size(); ++i) {
+    double expected_derivative = (i > 0 ? values[i - 1] : 0.0) +
+                                 (i + 1 < values.size() ? values[i + 1] : 0.0);
+    if (sum_gradient[i] != expected_derivative)
+      return false;
+  }
+  return true;
+}
+
+// static
+bool Tests::TestDiffSharedSubtrees() {
+  auto x = Var(L"x");
+  // The tree doubles with every level, the derivative is linear in depth.
+  const int kDepth = 12;
+  std::unique_ptr<INode> f = x;
+  for (int i = 0; i < kDepth; ++i) {
+    auto sin = Sin(f->Clone());
+    f = std::move(sin) * std::move(f);
+  }
+  Variable diff = Diff(f->Clone(), x);
+  Variable derivative(diff.SymCalc(SymCalcSettings::KeepNamedConstants));
+
+  std::unordered_set<const INode*> nodes;
+  std::vector<const INode*> pending = {&derivative};
+  while (!pending.empty()) {
+    const INode* node = NodeTable::Resolve(pending.back());
+    pending.pop_back();
+    if (!nodes.insert(node).second)
+      continue;
+    if (const Variable* variable = node->AsNodeImpl()->AsVariable()) {
+      if (variable->Value())
+        pending.push_back(variable->Value());
+    } else if (const Operation* operation = node->AsNodeImpl()->AsOperation()) {
+      for (size_t i = 0; i < operation->OperandsCount(); ++i)
+        pending.push_back(operation->Operand(i));
+    }
+  }
+  if (nodes.size() > 20 * kDepth)
+    return false;
+
+  std::shared_ptr<const CompiledExpression> compiled =
+      CompiledExpression::Compile(f.get(), {x.GetSymbol()});
+  if (!compiled)
+    return false;
+  EvaluationContext context(compiled);
+  context.Bind(0, 0.9);
+  double expected;
+  context.EvaluateGradient(&expected);
+  x = 0.9;
+  auto value = derivative.SymCalc(SymCalcSettings::Full);
+  const Constant* constant = INodeHelper::AsConstant(value.get());
+  return constant && std::abs(constant->Value() - expected) < 1e-12;
+}
+
+// static
+bool Tests::TestFreeVariables() {
+  auto a = Var(L"a");
+  auto b = Var(L"b", 2);
+  auto c = Var(L"c");
+  Variable s = Sin(a + b) * Pow(c, 2);
+  const SymbolSet& free_variables = s.AsOperation()->FreeVariables();
+  if (!free_variables.Contains(a.GetSymbol()) ||
+      !free_variables.Contains(b.GetSymbol()) ||
+      !free_variables.Contains(c.GetSymbol())) {
+    return false;
+  }
+  s.AsOperation()->SetOperand(1, Const(3));
+  if (s.AsOperation()->FreeVariables().Contains(c.GetSymbol()))
+    return false;
+
+  // Subtrees without the variable are not differentiated.
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  Variable diff = Diff(x * 2 + Sin(y) / Cos(y) + Pow(y, Log(y)), x);
+  auto derivative = diff.SymCalc(SymCalcSettings::KeepNamedConstants);
+  if (!derivative->AsNodeImpl()->FreeVariables().IsEmpty())
+    return false;
+  auto expected_result = Const(2);
+  auto result = derivative->SymCalc(SymCalcSettings::Full);
+  return result->Compare(expected_result.get()) == CompareResult::Equal;
+}
+
+// static
+bool Tests::TestPrintLayoutCache() {
+  auto x = Var(L"x", 2);
+  Variable s = Pow(x, 2) / (x + 1) + Sin(x) * x;
+  Operation* sum = s.AsOperation();
+  const INodeImpl* div = sum->Operand(0);
+  Operation* product = sum->Operand(1)->AsOperation();
+  std::wstring printed = s.Print(true);
+  if (!s.IsLayoutCurrent(true) || s.Print(true) != printed)
+    return false;
+
+  // Another expression over the same variable is laid out in between.
+  Variable other = Diff(x * 3, x);
+  other.Print();
+  if (!s.IsLayoutCurrent(true) || s.Print(true) != printed)
+    return false;
+
+  // A mutation drops the sizes measured up to the root, the other operand
+  // keeps its own.
+  if (!div->measured_ || !product->measured_)
+    return false;
+  product->SetOperand(1, Const(5));
+  if (!div->measured_ || product->measured_ || sum->measured_ ||
+      s.IsLayoutCurrent(true)) {
+    return false;
+  }
+  Variable changed = Pow(x, 2) / (x + 1) + Sin(x) * 5;
+  if (s.Print(true) != changed.Print(true))
+    return false;
+
+  x = 3;
+  if (s.IsLayoutCurrent(true))
+    return false;
+  Variable fresh = Pow(x, 2) / (x + 1) + Sin(x) * 5;
+  return s.Print(true) == fresh.Print(true);
+}
+
+// static
+bool Tests::TestPrintToBands() {
+  auto x = Var(L"x", 2);
+  auto y = Var(L"y");
+  Variable s = Sqrt(Pow(x, 2) / (y + 1) + 1, 3) /
+               (Vector3(x, y, Const(1)) * Vector3(y, x / (y + 2), x)) +
+               Log(x);
+  std::wstring printed = s.Print(true);
+  for (uint32_t band_height : {1u, 2u, 3u, 1000u}) {
+    std::wostringstream out;
+    s.PrintTo(out, true, band_height);
+    if (out.str() != printed)
+      return false;
+  }
+  return true;
+}
+
+// static
+bool Tests::TestSerializers() {
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  Variable s(L"s", -x * 2 + Sin(x) / (y - 1) - Pow(x + 1, Const(-2)) +
+                       Sqrt(y, 3));
+  if (Serializer::ToString(s, SerializeFormat::Infix) !=
+      L"s = -x*2 + sin(x)/(y - 1) - (x + 1)^(-2) + root(y, 3)") {
+    return false;
+  }
+  if (Serializer::ToString(s, SerializeFormat::Latex) !=
+      L"s = -x \\cdot 2 + \\frac{\\sin\\left(x\\right)}{y - 1} - "
+      L"{\\left(x + 1\\right)}^{-2} + \\sqrt[3]{y}") {
+    return false;
+  }
+  Variable f = Pow(x, 2) / (y + 1);
+  if (Serializer::ToString(f, SerializeFormat::MathMl) !=
+      L"<math xmlns=\"http://www.w3.org/1998/Math/MathML\"><mfrac><mrow>"
+      L"<msup><mrow><mi>x</mi></mrow><mrow><mn>2</mn></mrow></msup></mrow>"
+      L"<mrow><mi>y</mi><mo>+</mo><mn>1</mn></mrow></mfrac></math>") {
+    return false;
+  }
+
+  // Brackets follow the sign of the operands.
+  Variable g = x / (-y) + (-x) * (-y) - (x - y);
+  if (Serializer::ToString(g, SerializeFormat::Infix) !=
+      L"x/(-y) - x*(-y) - (x - y)") {
+    return false;
+  }
+
+  // Several expressions share one buffer.
+  std::wostringstream out;
+  {
+    Serializer serializer(SerializeFormat::Infix, out);
+    serializer.Write(f);
+    serializer.Write(g);
+  }
+  return out.str() == Serializer::ToString(f, SerializeFormat::Infix) +
+                          Serializer::ToString(g, SerializeFormat::Infix);
+}
+
+// static
+bool Tests::TestParser() {
+  VariableScope scope;
+  Parser parser(&scope);
+  // Infix text written by Serializer reads back to the same tree.
+  for (std::string_view text :
+       {"-x*2 + sin(x)/(y - 1) - (x + 1)^(-2) + root(y, 3)",
+        "ln(x) + log(10, x)*cos(y)^2 == 1.5", "diff(x^2*y, x)",
+        "[x, -y, 1e-05]", "{1, x}"}) {
+    auto node = parser.Parse(text);
+    if (!node || Serializer::ToString(node.get(), SerializeFormat::Infix) !=
+                     std::wstring(text.begin(), text.end())) {
+      return false;
+    }
+  }
+  auto node = parser.Parse("\xCF\x80\xC2\xB7r^-2*r  -  -2");
+  if (!node ||
+      Serializer::ToString(node.get(), SerializeFormat::Infix) !=
+          L"\u03C0*r^(-2)*r + 2") {
+    return false;
+  }
+
+  // Names are looked up in the scope.
+  *scope.Get(L"x") = 3;
+  *scope.Get(L"y") = 2;
+  node = parser.Parse("x^2 - 3*x/y + y^3");
+  auto result = node->SymCalc(SymCalcSettings::Full);
+  const Constant* value = INodeHelper::AsConstant(result.get());
+  if (!value || value->Value() != 9 - 4.5 + 8)
+    return false;
+
+  struct ErrorCase {
+    std::string_view text;
+    size_t offset;
+  };
+  for (const ErrorCase& error_case : {ErrorCase{"x + ", 4},
+                                      ErrorCase{"sin(x, y)", 0},
+                                      ErrorCase{"2 $ 3", 2},
+                                      ErrorCase{"((x)", 4}}) {
+    if (parser.Parse(error_case.text) ||
+        parser.ErrorOffset() != error_case.offset) {
+      return false;
+    }
+  }
+  return !parser.Parse("x + 1e999") && parser.ErrorOffset() == 4 &&
+         parser.Error() == "number out of range";
+}
+
+// static
+bool Tests::TestBinaryFormat() {
+  VariableScope scope;
+  Parser parser(&scope);
+  std::vector<std::unique_ptr<INode>> nodes;
+  for (std::string_view text :
+       {"-x*2 + sin(x)/(y - 1) - (x + 1)^(-2) + root(y, 3)",
+        "\xCF\x80*e^x == True", "diff(x^2*y, x)", "[x, -y, 1e-05]",
+        "{1, x}"}) {
+    nodes.push_back(parser.Parse(text));
+  }
+  nodes.push_back(INodeHelper::MakeBrackets(BracketType::Square,
+                                            parser.Parse("x + i")));
+  auto x = Var(L"x");
+  Variable f = x * x;
+  Variable g = f + 1;
+
+  BinaryWriter writer;
+  for (const auto& node : nodes)
+    writer.Add(node.get());
+  writer.Add(g);
+  std::string image = writer.Image();
+
+  // Loaded trees use the variables of another scope.
+  VariableScope load_scope;
+  auto binary_image = BinaryImage::Open(image);
+  if (!binary_image || binary_image->Size() != nodes.size() + 1)
+    return false;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    auto node = binary_image->Load(i, &load_scope);
+    if (!node || Serializer::ToString(node.get(), SerializeFormat::Infix) !=
+                     Serializer::ToString(nodes[i].get(),
+                                          SerializeFormat::Infix)) {
+      return false;
+    }
+  }
+  auto node = binary_image->Load(nodes.size(), &load_scope);
+  if (!node || Serializer::ToString(node.get(), SerializeFormat::Infix) !=
+                   L"x*x + 1") {
+    return false;
+  }
+  if (load_scope.Size() != 2 || !load_scope.Find(L"x"))
+    return false;
+
+  // Damaged images are rejected instead of read out of bounds.
+  if (BinaryImage::Open(std::string_view(image).substr(0, image.size() - 1)))
+    return false;
+  std::string damaged = image;
+  damaged[sizeof(kBinaryMagic)] = static_cast<char>(0x7F);
+  binary_image = BinaryImage::Open(damaged);
+  if (!binary_image || binary_image->Load(0, &load_scope))
+    return false;
+
+  // Plus and Mult need at least two operands.
+  for (Op op : {Op::Plus, Op::Mult}) {
+    std::string single(kBinaryMagic, sizeof(kBinaryMagic));
+    const uint64_t nodes_offset = single.size();
+    single += {static_cast<char>(BinaryTag::Variable), 0,
+               static_cast<char>(BinaryTag::Operation), static_cast<char>(op),
+               1};
+    const uint64_t names_offset = single.size();
+    single += {1, 1, 'x'};
+    const uint64_t directory_offset = single.size();
+    single += {1, static_cast<char>(nodes_offset),
+               static_cast<char>(names_offset - nodes_offset), 2};
+    single.append(reinterpret_cast<const char*>(&names_offset),
+                  sizeof(names_offset));
+    single.append(reinterpret_cast<const char*>(&directory_offset),
+                  sizeof(directory_offset));
+    single.append(kBinaryMagic, sizeof(kBinaryMagic));
+    binary_image = BinaryImage::Open(single);
+    if (!binary_image || binary_image->Load(0, &load_scope))
+      return false;
+    // The same image with a unary operation is well formed.
+    single[names_offset - 2] = static_cast<char>(Op::Sin);
+    if (!binary_image->Load(0, &load_scope))
+      return false;
+  }
+  return true;
+}
+
+// static
+bool Tests::TestBatchProcessor() {
+  // Many chunks over few threads, the output keeps the input order.
+  std::string text;
+  std::string expected;
+  for (int i = 0; i < 100; ++i) {
+    text += "x^" + std::to_string(i + 2) + " + y*" + std::to_string(i) +
+            "\r\n\n";
+    expected += std::to_string(i + 2) + "*x" +
+                (i ? "^" + std::to_string(i + 1) : "") + "\n";
+  }
+  text += "[x, y*x]\n{x, 2*x}\nx + ";
+  expected +=
+      "error: can not differentiate, not a scalar\n"
+      "error: can not differentiate, not a scalar\n"
+      "error: expected an operand at 4\n";
+
+  BatchProcessor processor({{BatchStepType::Diff, L"x"},
+                            {BatchStepType::Simplify}},
+                           BatchOutput::Infix, 3);
+  processor.AddText(text);
+  std::ostringstream out;
+  if (processor.Run(out) != 3 || out.str() != expected)
+    return false;
+
+  // Expressions of a binary image, evaluated.
+  VariableScope scope;
+  Parser parser(&scope);
+  BinaryWriter writer;
+  writer.Add(parser.Parse("x*y - 1").get());
+  writer.Add(parser.Parse("sqrt(x)*i").get());
+  std::string image = writer.Image();
+  auto binary_image = BinaryImage::Open(image);
+  BatchProcessor evaluator(
+      {{BatchStepType::Evaluate, {}, {{L"x", 4}, {L"y", 0.5}}}},
+      BatchOutput::Infix, 2);
+  evaluator.AddImage(binary_image.get());
+  out.str(std::string());
+  return evaluator.Run(out) == 0 && out.str() == "1\n2*i\n";
+}
+
+// static
+bool Tests::TestCountNodes() {
+  VariableScope scope;
+  Parser parser(&scope);
+  auto node = parser.Parse("x*2 + sin(y) - [x, 1]");
+  if (INodeHelper::CountNodes(node.get()) != 10)
+    return false;
+  // Values of anonymous variables are counted, named ones are leaves.
+  auto x = Var(L"x", 5);
+  Variable f = x * x;
+  Variable g = f + 1;
+  std::unique_ptr<INode> value = g;
+  return INodeHelper::CountNodes(value.get()) == 5;
+}
+
+// static
+bool Tests::TestRandomExpression() {
+  VariableScope scope;
+  RandomExpressionOptions options;
+  options.seed = 42;
+  options.max_depth = 3;
+  options.max_fan_out = 2;
+  // A minus is a plus with a negated operand, one more node.
+  options.Weight(Op::Minus) = 0;
+  RandomExpression generator(options, &scope);
+  RandomExpression same_generator(options, &scope);
+  for (size_t i = 0; i < 20; ++i) {
+    auto node = generator.Generate();
+    auto same_node = same_generator.Generate();
+    if (Serializer::ToString(node.get(), SerializeFormat::Infix) !=
+        Serializer::ToString(same_node.get(), SerializeFormat::Infix)) {
+      return false;
+    }
+    // Binary operations nested 3 deep.
+    if (INodeHelper::CountNodes(node.get()) > 15)
+      return false;
+  }
+  options.vector_probability = 1;
+  RandomExpression vector_generator(options, &scope);
+  auto vector = vector_generator.Generate();
+  if (vector->AsNodeImpl()->GetValueType() != ValueType::Vector)
+    return false;
+
+  // Found by the generator: the negation of a negated factor.
+  Parser parser(&scope);
+  Variable product = parser.Parse("(-(-x1))*x0");
+  product.OpenBrackets();
+  return Serializer::ToString(product, SerializeFormat::Infix) == L"x1*x0";
+}
+
+// static
+bool Tests::TestSimplifyProfile() {
+  auto x = Var(L"x");
+  auto y = Var(L"y");
+  SimplifyProfile profile;
+  {
+    ScopedSimplifyProfile scoped_profile(&profile);
+    Variable t = (x + y) * 2 + (x + y) * 3;
+    t.Simplify();
+    Variable zero = x * y - y * x;
+    zero.Simplify();
+  }
+  if (SimplifyProfile::Current() || profile.Calls() == 0 ||
+      profile.Rules().size() != 10) {
+    return false;
+  }
+  uint64_t hits = 0;
+  uint64_t restarts = 0;
+  std::unordered_set<std::string_view> names;
+  for (const auto& rule : profile.Rules()) {
+    if (rule.invocations == 0 || rule.hits > rule.invocations ||
+        rule.restarts > rule.hits || !names.insert(rule.name).second) {
+      return false;
+    }
+    hits += rule.hits;
+    restarts += rule.restarts;
+  }
+  if (hits == 0 || restarts == 0)
+    return false;
+
+  // Nothing is recorded without a current profile.
+  uint64_t calls = profile.Calls();
+  Variable t = x * 1 + 0;
+  t.Simplify();
+  if (profile.Calls() != calls)
+    return false;
+
+  // The rules simplify nested operations while they are recorded, the first
+  // profiled run must not move the rows of the rules in progress.
+  SimplifyProfile nested_profile;
+  {
+    ScopedSimplifyProfile scoped_profile(&nested_profile);
+    Variable nested = -(-(x * 2 + 3 * x) / (y / (x / 4))) +
+                      (x + x) * (y + y) - Sin(x * x * 3 / 2);
+    nested.Simplify();
+  }
+  return nested_profile.Rules().size() == SimplifyProfile::kRulesCount &&
+         nested_profile.Calls() > 1 &&
+         nested_profile.Rules()[0].invocations > 0;
+}
+
+// static
+bool Tests::TestSerializeRoundTrip() {
+  VariableScope scope;
+  Parser parser(&scope);
+  // Numbers keep every digit through the infix form.
+  for (double value : {0.1234567891, 1.0 / 3, -2.5e-7, 6.02214076e23, 1e-300,
+                       123456789.125, 0.1, HUGE_VAL, -HUGE_VAL, std::nan("")}) {
+    auto node = INodeHelper::MakeConst(value);
+    auto parsed = parser.Parse(
+        ToUtf8(Serializer::ToString(node.get(), SerializeFormat::Infix)));
+    const Constant* constant =
+        parsed ? INodeHelper::AsConstant(parsed.get()) : nullptr;
+    if (!constant || UlpDistance(constant->Value(), value) != 0)
+      return false;
+  }
+  Variable& x = *scope.Get(L"x");
+  Variable f = 0.1234567891 * x;
+  Variable g =
+      parser.Parse(ToUtf8(Serializer::ToString(f, SerializeFormat::Infix)));
+  x = 8;
+  return g.SymCalc(SymCalcSettings::Full)->Compare(
+             f.SymCalc(SymCalcSettings::Full).get()) == CompareResult::Equal;
+}
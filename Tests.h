@@ -1,12 +1,44 @@
 #pragma once
+#include <stddef.h>
+
+#include <string_view>
 
 class Tests {
  public:
-  static void Run();
+  // Runs the test named |only|, or all tests but |skip|, and returns the
+  // number of failed tests.
+  static size_t Run(std::string_view only = {}, std::string_view skip = {});
   static bool TestSimplifyPlusChain();
   static bool TestSimplifyMultChain();
   static bool TestSimplifyChainRecursive();
   static bool TestSimplifyDivDiv();
   static bool TestSimplifyImaginary();
   static bool TestOpenBrackets();
+  static bool TestNodeArena();
+  static bool TestNodeTable();
+  static bool TestStructuralHash();
+  static bool TestOperandsVector();
+  static bool TestSymbolTable();
+  static bool TestIncrementalSimplify();
+  static bool TestPlusLikeTerms();
+  static bool TestOpenBracketsPolynomial();
+  static bool TestCompiledExpression();
+  static bool TestBatchEvaluation();
+  static bool TestBatchKernels();
+  static bool TestConcurrentEvaluation();
+  static bool TestSymCalcNumeric();
+  static bool TestForwardDerivatives();
+  static bool TestReverseGradient();
+  static bool TestDiffSharedSubtrees();
+  static bool TestFreeVariables();
+  static bool TestPrintLayoutCache();
+  static bool TestPrintToBands();
+  static bool TestSerializers();
+  static bool TestParser();
+  static bool TestBinaryFormat();
+  static bool TestBatchProcessor();
+  static bool TestCountNodes();
+  static bool TestRandomExpression();
+  static bool TestSimplifyProfile();
+  static bool TestSerializeRoundTrip();
 };
@@ -0,0 +1,20 @@
+// Test driver:
+//   symmath-tests [NAME] [--skip NAME]
+// Runs the tests of Tests.cpp and exits with 1 if any of them failed.
+
+#include <string_view>
+
+#include "Tests.h"
+
+int main(int argc, char* argv[]) {
+  std::string_view only;
+  std::string_view skip;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "--skip" && i + 1 < argc)
+      skip = argv[++i];
+    else
+      only = arg;
+  }
+  return Tests::Run(only, skip) ? 1 : 0;
+}
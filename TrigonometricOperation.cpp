@@ -3,6 +3,7 @@
 #include <cassert>
 
 #include "Constant.h"
+#include "NodeTable.h"
 #include "OpInfo.h"
 #include "ValueHelpers.h"
 
@@ -17,7 +18,7 @@ std::unique_ptr<INode> TrigonometricOperation::Clone() const {
                                                   operands_[0]->Clone());
 }
 
-PrintSize TrigonometricOperation::Render(
+PrintSize TrigonometricOperation::RenderImpl(
     Canvas* canvas,
     PrintBox print_box,
     bool dry_run,
@@ -32,16 +33,17 @@ void TrigonometricOperation::ConvertToComplexImpl(
     std::unique_ptr<INode>* new_node) {
   Operation::ConvertToComplexImpl({&token}, nullptr);
 
-  auto x = Operand();
+  NodeTable table;
+  auto x = table.Intern(TakeOperand(0));
   if (op_info_->op == Op::Sin) {
-    *new_node = (Pow(Constants::MakeE(), Imag() * x->Clone()) -
-                 Pow(Constants::MakeE(), -Imag() * x->Clone())) /
+    *new_node = (Pow(Constants::MakeE(), Imag() * NodeTable::Instance(x)) -
+                 Pow(Constants::MakeE(), -Imag() * NodeTable::Instance(x))) /
                 (2 * Imag());
     return;
   }
   if (op_info_->op == Op::Cos) {
-    *new_node = (Pow(Constants::MakeE(), Imag() * x->Clone()->Clone()) +
-                 Pow(Constants::MakeE(), -Imag() * x->Clone())) /
+    *new_node = (Pow(Constants::MakeE(), Imag() * NodeTable::Instance(x)) +
+                 Pow(Constants::MakeE(), -Imag() * NodeTable::Instance(x))) /
                 2;
     return;
   }
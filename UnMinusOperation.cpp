@@ -15,10 +15,10 @@ std::unique_ptr<INode> UnMinusOperation::Clone() const {
   return INodeHelper::MakeUnMinus(operands_[0]->Clone());
 }
 
-PrintSize UnMinusOperation::Render(Canvas* canvas,
-                                   PrintBox print_box,
-                                   bool dry_run,
-                                   RenderBehaviour render_behaviour) const {
+PrintSize UnMinusOperation::RenderImpl(Canvas* canvas,
+                                       PrintBox print_box,
+                                       bool dry_run,
+                                       RenderBehaviour render_behaviour) const {
   auto minus_behaviour = render_behaviour.TakeMinus();
 
   if (minus_behaviour == MinusBehaviour::Force) {
@@ -81,6 +81,8 @@ void UnMinusOperation::OpenBracketsImpl(HotToken token,
 }
 
 std::optional<CanonicMult> UnMinusOperation::GetCanonicMult() {
+  // The operand may be written through the result.
+  InvalidateCaches();
   CanonicMult result = INodeHelper::GetCanonicMult(operands_[0]);
   result.a *= -1.0;
   return result;
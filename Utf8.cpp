@@ -0,0 +1,88 @@
+#include "Utf8.h"
+
+char32_t DecodeUtf8(const char** pos, const char* end) {
+  const unsigned char lead = static_cast<unsigned char>(**pos);
+  if (lead < 0x80) {
+    ++*pos;
+    return lead;
+  }
+  int length;
+  char32_t code_point;
+  if ((lead & 0xE0) == 0xC0) {
+    length = 2;
+    code_point = lead & 0x1F;
+  } else if ((lead & 0xF0) == 0xE0) {
+    length = 3;
+    code_point = lead & 0x0F;
+  } else if ((lead & 0xF8) == 0xF0) {
+    length = 4;
+    code_point = lead & 0x07;
+  } else {
+    return kInvalidCodePoint;
+  }
+  if (end - *pos < length)
+    return kInvalidCodePoint;
+  for (int i = 1; i < length; ++i) {
+    const unsigned char next = static_cast<unsigned char>((*pos)[i]);
+    if ((next & 0xC0) != 0x80)
+      return kInvalidCodePoint;
+    code_point = (code_point << 6) | (next & 0x3F);
+  }
+  *pos += length;
+  return code_point;
+}
+
+void AppendCodePoint(char32_t code_point, std::wstring* out) {
+  if (sizeof(wchar_t) == 2 && code_point > 0xFFFF) {
+    code_point -= 0x10000;
+    out->push_back(static_cast<wchar_t>(0xD800 + (code_point >> 10)));
+    out->push_back(static_cast<wchar_t>(0xDC00 + (code_point & 0x3FF)));
+  } else {
+    out->push_back(static_cast<wchar_t>(code_point));
+  }
+}
+
+std::wstring FromUtf8(std::string_view text) {
+  std::wstring result;
+  result.reserve(text.size());
+  const char* pos = text.data();
+  const char* end = text.data() + text.size();
+  while (pos != end) {
+    char32_t code_point = DecodeUtf8(&pos, end);
+    if (code_point == kInvalidCodePoint) {
+      code_point = 0xFFFD;
+      ++pos;
+    }
+    AppendCodePoint(code_point, &result);
+  }
+  return result;
+}
+
+std::string ToUtf8(std::wstring_view text) {
+  std::string result;
+  result.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    char32_t code_point = static_cast<char32_t>(text[i]);
+    if (sizeof(wchar_t) == 2 && code_point >= 0xD800 && code_point < 0xDC00 &&
+        i + 1 < text.size()) {
+      code_point = 0x10000 + ((code_point - 0xD800) << 10) +
+                   (static_cast<char32_t>(text[++i]) - 0xDC00);
+    }
+    if (code_point < 0x80) {
+      result.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+      result.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+      result.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+      result.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+      result.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+      result.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+      result.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+      result.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+      result.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+      result.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+  }
+  return result;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+constexpr char32_t kInvalidCodePoint = 0xFFFFFFFF;
+
+// Returns the code point at |*pos| and moves |*pos| past it. Returns
+// kInvalidCodePoint and leaves |*pos| unchanged on a malformed sequence.
+char32_t DecodeUtf8(const char** pos, const char* end);
+// Appends |code_point| to |out| as UTF-16 or UTF-32, whichever wchar_t holds.
+void AppendCodePoint(char32_t code_point, std::wstring* out);
+
+// Malformed sequences are replaced by U+FFFD.
+std::wstring FromUtf8(std::string_view text);
+std::string ToUtf8(std::wstring_view text);
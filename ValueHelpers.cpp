@@ -12,6 +12,7 @@
 #include "Imaginary.h"
 #include "LogOperation.h"
 #include "MultOperation.h"
+#include "NodeArena.h"
 #include "OpInfo.h"
 #include "Operation.h"
 #include "PlusOperation.h"
@@ -23,14 +24,24 @@
 #include "Vector.h"
 #include "VectorMultOperation.h"
 
+namespace {
+// Shared constants outlive any arena, so keep them on the heap.
+template <typename MakeF>
+auto MakeOutsideArena(MakeF make_f) {
+  ScopedNodeArena scoped_arena(nullptr);
+  return make_f();
+}
+}  // namespace
+
 namespace Constants {
 const Constant* Zero() {
-  static const auto kZero = INodeHelper::MakeConst(0.0);
+  static const auto kZero =
+      MakeOutsideArena([] { return INodeHelper::MakeConst(0.0); });
   return kZero.get();
 }
 
 const Constant* E() {
-  static const auto kE = MakeE();
+  static const auto kE = MakeOutsideArena(&MakeE);
   return kE.get();
 }
 
@@ -39,7 +50,7 @@ std::unique_ptr<Constant> MakeE() {
 }
 
 const Constant* PI() {
-  static const auto kPi = MakePI();
+  static const auto kPi = MakeOutsideArena(&MakePI);
   return kPi.get();
 }
 std::unique_ptr<Constant> MakePI() {
@@ -47,7 +58,7 @@ std::unique_ptr<Constant> MakePI() {
 }
 
 const Imaginary* Imag() {
-  static const auto kImag = INodeHelper::MakeImaginary();
+  static const auto kImag = MakeOutsideArena(&INodeHelper::MakeImaginary);
   return kImag.get();
 }
 }  // namespace Constants
@@ -2,11 +2,15 @@
 
 #include <algorithm>
 #include <cassert>
+#include <ostream>
 #include <sstream>
 
+#include "AbstractSequence.h"
+#include "Brackets.h"
 #include "ErrorNode.h"
 #include "Exception.h"
 #include "INodeHelper.h"
+#include "NodeArena.h"
 #include "Operation.h"
 #include "ValueHelpers.h"
 #include "VariableRef.h"
@@ -17,76 +21,136 @@ const std::string_view kNull("<null>");
 const std::string_view kArrow(" -> ");
 }  // namespace
 
-Variable::Variable(std::wstring name) : name_(std::move(name)) {}
+Variable::Variable(std::wstring name) : symbol_(name) {}
 
 Variable::Variable(std::unique_ptr<INode> value) : value_(std::move(value)) {}
 
 Variable::Variable(std::wstring name, std::unique_ptr<INode> value)
-    : name_(std::move(name)), value_(std::move(value)) {}
+    : symbol_(name), value_(std::move(value)) {}
 
-Variable::~Variable() {}
+Variable::~Variable() {
+  NodeArena::Release(arena_);
+}
 
 std::wstring Variable::Print(bool with_calc, uint32_t base_line) const {
-  RenderBehaviour render_behaviour;
-
   Canvas canvas;
-  canvas.SetDryRun(true);
-  PrintBox initial_print_box(0, 0, 10000, 10000, 0);
-
-  auto value_size = Render(&canvas, initial_print_box, true, render_behaviour);
-  assert(value_size == LastPrintSize());
-  auto total_size(value_size);
-
-  Variable calculated_value = Const(0);
-  if (with_calc) {
-    calculated_value = SymCalc(SymCalcSettings::KeepNamedConstants);
-    calculated_value.OpenBrackets();
-    calculated_value.Simplify();
+  PrintSize total_size = LayoutSize(&canvas, with_calc, base_line);
+  canvas.Resize(total_size);
+  Paint(&canvas, total_size, with_calc, base_line);
+  return canvas.ToString();
+}
 
-    auto calculated_value_size = calculated_value.Render(
-        &canvas, initial_print_box, true, render_behaviour);
-    assert(calculated_value_size == calculated_value.LastPrintSize());
-    auto arrow_size = canvas.PrintAt(initial_print_box, kArrow,
-                                     render_behaviour.GetSubSuper(), true);
-    total_size = value_size.GrowWidth(arrow_size, true)
-                     .GrowWidth(calculated_value_size, true);
+void Variable::PrintTo(std::wostream& out,
+                       bool with_calc,
+                       uint32_t band_height) const {
+  assert(band_height > 0);
+  Canvas canvas;
+  PrintSize total_size = LayoutSize(&canvas, with_calc, 0);
+  for (uint32_t row = 0; row < total_size.height; row += band_height) {
+    canvas.SetBand(total_size, row,
+                   std::min(band_height, total_size.height - row));
+    Paint(&canvas, total_size, with_calc, 0);
+    out << canvas.ToString();
   }
+}
+
+PrintSize Variable::LayoutSize(Canvas* canvas,
+                               bool with_calc,
+                               uint32_t base_line) const {
+  if (!IsLayoutCurrent(with_calc))
+    Layout(canvas, with_calc, RenderBehaviour());
+  auto total_size(print_layout_->total_size);
   if (base_line > total_size.base_line) {
     total_size.height += base_line - total_size.base_line;
     total_size.base_line = base_line;
   }
-  canvas.Resize(total_size);
-  canvas.SetDryRun(false);
+  return total_size;
+}
+
+void Variable::Paint(Canvas* canvas,
+                     const PrintSize& total_size,
+                     bool with_calc,
+                     uint32_t base_line) const {
+  RenderBehaviour render_behaviour;
+  const PrintSize value_size = print_layout_->value_size;
+  canvas->SetDryRun(false);
   PrintBox print_box(total_size, 0, 0);
-  auto value_size2 = Render(&canvas, print_box, false, render_behaviour);
+  auto value_size2 = Render(canvas, print_box, false, render_behaviour);
   auto total_size2(value_size2);
   assert(value_size == value_size2);
   assert(value_size == LastPrintSize());
 
   if (with_calc) {
+    const Variable& calculated_value = *print_layout_->calculated_value;
     print_box = print_box.ShrinkLeft(value_size.width);
-    auto arrow_size = canvas.PrintAt(print_box, kArrow,
-                                     render_behaviour.GetSubSuper(), false);
+    auto arrow_size = canvas->PrintAt(print_box, kArrow,
+                                      render_behaviour.GetSubSuper(), false);
     print_box = print_box.ShrinkLeft(arrow_size.width);
     auto calculated_value_size =
-        calculated_value.Render(&canvas, print_box, false, render_behaviour);
+        calculated_value.Render(canvas, print_box, false, render_behaviour);
     assert(calculated_value_size == calculated_value.LastPrintSize());
     total_size2 = value_size.GrowWidth(arrow_size, true)
                       .GrowWidth(calculated_value_size, true);
   }
   if (base_line == 0)
     assert(total_size == total_size2);
-  return canvas.ToString();
+}
+
+void Variable::Layout(Canvas* canvas,
+                      bool with_calc,
+                      RenderBehaviour render_behaviour) const {
+  auto layout = std::make_unique<PrintLayout>();
+  canvas->SetDryRun(true);
+  PrintBox initial_print_box = PrintBox::Infinite();
+
+  layout->value_size =
+      Render(canvas, initial_print_box, true, render_behaviour);
+  assert(layout->value_size == LastPrintSize());
+  layout->total_size = layout->value_size;
+
+  layout->tracked = TrackLayout();
+  if (with_calc) {
+    layout->calculated_value = std::make_unique<Variable>(Const(0));
+    Variable& calculated_value = *layout->calculated_value;
+    CollectCalcSources(this, &layout->calc_sources);
+    calculated_value = SymCalc(SymCalcSettings::KeepNamedConstants);
+    calculated_value.OpenBrackets();
+    calculated_value.Simplify();
+
+    auto calculated_value_size = calculated_value.Render(
+        canvas, initial_print_box, true, render_behaviour);
+    assert(calculated_value_size == calculated_value.LastPrintSize());
+    auto arrow_size = canvas->PrintAt(initial_print_box, kArrow,
+                                      render_behaviour.GetSubSuper(), true);
+    layout->total_size = layout->value_size.GrowWidth(arrow_size, true)
+                             .GrowWidth(calculated_value_size, true);
+  }
+  layout->with_calc = with_calc;
+  print_layout_ = std::move(layout);
+}
+
+bool Variable::IsLayoutCurrent(bool with_calc) const {
+  if (!print_layout_ || !print_layout_->tracked ||
+      print_layout_->with_calc != with_calc) {
+    return false;
+  }
+  // In the order of reading, a variable that was only reachable through a
+  // changed one is not looked at.
+  for (const auto& source : print_layout_->calc_sources) {
+    if (source.second == 0 || source.first->value_version_ != source.second)
+      return false;
+  }
+  return true;
 }
 
 int Variable::Priority() const {
-  if (name_.empty() && value_)
+  if (symbol_.IsEmpty() && value_)
     return value_->AsNodeImpl()->Priority();
   return 100;
 }
 
 bool Variable::HasFrontMinus() const {
-  if (!name_.empty())
+  if (!symbol_.IsEmpty())
     return false;
   if (value_)
     return value_->AsNodeImpl()->HasFrontMinus();
@@ -110,9 +174,11 @@ CompareResult Variable::Compare(const INode* rh) const {
   const Variable* rh_variable = rh->AsNodeImpl()->AsVariable();
   assert(rh_variable);
 
-  result = CompareTrivial(GetName(), rh_variable->GetName());
-  if (result != CompareResult::Equal)
-    return result;
+  if (symbol_ != rh_variable->symbol_) {
+    result = CompareTrivial(symbol_.Name(), rh_variable->symbol_.Name());
+    if (result != CompareResult::Equal)
+      return result;
+  }
 
   result = CompareTrivial(value_ != nullptr, rh_variable->value_ != nullptr);
   if (result != CompareResult::Equal)
@@ -122,8 +188,63 @@ CompareResult Variable::Compare(const INode* rh) const {
   return result;
 }
 
-std::wstring Variable::GetName() const {
-  return name_;
+uint64_t Variable::ComputeHash() const {
+  // An anonymous variable compares as its value.
+  if (symbol_.IsEmpty() && value_)
+    return ChildHash(value_.get());
+  return HashCombine(INodeImpl::ComputeHash(), symbol_.NameHash());
+}
+
+void Variable::CollectFreeVariables(SymbolSet* result) const {
+  result->Insert(symbol_);
+}
+
+void Variable::ForgetChildren() const {
+  ForgetChild(value_.get());
+}
+
+void Variable::DropCaches() const {
+  print_layout_.reset();
+  ++value_version_;
+}
+
+// static
+void Variable::CollectCalcSources(const INodeImpl* node,
+                                  CalcSources* result) {
+  if (!node)
+    return;
+  if (const Variable* var = node->AsVariable()) {
+    for (const auto& source : *result) {
+      if (source.first == var)
+        return;
+    }
+    result->push_back({var, var->ValueVersion()});
+    CollectCalcSources(var->Value(), result);
+  } else if (const Operation* operation = node->AsOperation()) {
+    for (size_t i = 0; i < operation->OperandsCount(); ++i)
+      CollectCalcSources(operation->Operand(i), result);
+  } else if (const AbstractSequence* sequence = node->AsAbstractSequence()) {
+    for (size_t i = 0; i < sequence->Size(); ++i)
+      CollectCalcSources(sequence->Value(i)->AsNodeImpl(), result);
+  } else if (const Brackets* brackets = node->AsBrackets()) {
+    CollectCalcSources(brackets->Value(), result);
+  }
+}
+
+bool Variable::TrackLayout() const {
+  if (!value_) {
+    SetCached();
+    return true;
+  }
+  return TrackChild(value_.get());
+}
+
+uint64_t Variable::ValueVersion() const {
+  return TrackLayout() ? value_version_ : 0;
+}
+
+const std::wstring& Variable::GetName() const {
+  return symbol_.Name();
 }
 
 void Variable::SimplifyImpl(HotToken token, std::unique_ptr<INode>* new_node) {
@@ -150,12 +271,18 @@ void Variable::ConvertToComplexImpl(HotToken token,
 }
 
 void Variable::Simplify() {
+  ScopedNodeArena scoped_arena(Arena());
+  // Rounds of one call share normal-form state, so each round only revisits
+  // subtrees changed by the previous one.
+  Operation::NewNormalFormEpoch();
   while (true) {
     HotToken token;
     std::unique_ptr<INode> new_node;
     SimplifyImpl({&token}, &new_node);
-    if (new_node)
+    if (new_node) {
+      InvalidateCaches();
       value_ = std::move(new_node);
+    }
     else if (token.GetChangesCount() == 0)
       break;
   }
@@ -164,27 +291,34 @@ void Variable::Simplify() {
 void Variable::OpenBrackets() {
   if (!value_)
     return;
+  ScopedNodeArena scoped_arena(Arena());
   HotToken token;
   std::unique_ptr<INode> temp_node;
   value_->AsNodeImpl()->OpenBracketsImpl({&token}, &temp_node);
-  if (temp_node)
+  if (temp_node) {
+    InvalidateCaches();
     value_ = std::move(temp_node);
+  }
 }
 
 void Variable::ConvertToComplex() {
   if (!value_)
     return;
+  ScopedNodeArena scoped_arena(Arena());
   HotToken token;
   std::unique_ptr<INode> temp_node;
   value_->AsNodeImpl()->ConvertToComplexImpl({&token}, &temp_node);
-  if (temp_node)
+  if (temp_node) {
+    InvalidateCaches();
     value_ = std::move(temp_node);
+  }
 }
 
 void Variable::operator=(std::unique_ptr<INode> value) {
+  InvalidateCaches();
   if (value->AsNodeImpl()->CheckCircular(this)) {
     value_ = std::make_unique<ErrorNode>(
-        L"Circular deps on [" + (name_.empty() ? L"<unonimous>" : name_) +
+        L"Circular deps on [" + (symbol_.IsEmpty() ? L"<unonimous>" : GetName()) +
         L"]");
   } else {
     value_ = std::move(value);
@@ -194,9 +328,10 @@ void Variable::operator=(std::unique_ptr<INode> value) {
 void Variable::operator=(const Variable& var) {
   if (this == &var)
     return;
+  InvalidateCaches();
   if (var.CheckCircular(this)) {
     value_ = std::make_unique<ErrorNode>(
-        L"Circular deps on [" + (name_.empty() ? L"<unonimous>" : name_) +
+        L"Circular deps on [" + (symbol_.IsEmpty() ? L"<unonimous>" : GetName()) +
         L"]");
   } else {
     value_ = std::make_unique<VariableRef>(&var);
@@ -204,6 +339,7 @@ void Variable::operator=(const Variable& var) {
 }
 
 void Variable::operator=(double val) {
+  InvalidateCaches();
   value_ = Const(val);
 }
 
@@ -224,16 +360,16 @@ NodeType Variable::GetNodeType() const {
   return NodeType::Variable;
 }
 
-PrintSize Variable::Render(Canvas* canvas,
-                           PrintBox print_box,
-                           bool dry_run,
-                           RenderBehaviour render_behaviour) const {
+PrintSize Variable::RenderImpl(Canvas* canvas,
+                               PrintBox print_box,
+                               bool dry_run,
+                               RenderBehaviour render_behaviour) const {
   bool print_name =
       (render_behaviour.GetVariable() != VariableBehaviour::ValueOnly);
   print_name =
       print_name &&
       ((render_behaviour.GetVariable() == VariableBehaviour::NameOnly) ||
-       (!name_.empty()));
+       (!symbol_.IsEmpty()));
   bool print_value =
       (render_behaviour.GetVariable() != VariableBehaviour::NameOnly);
   print_value =
@@ -296,7 +432,7 @@ PrintSize Variable::RenderName(Canvas* canvas,
                                RenderBehaviour render_behaviour,
                                bool equal_sign) const {
   std::wstring printable_name =
-      !name_.empty() ? name_ : std::wstring(kAnonimous);
+      !symbol_.IsEmpty() ? GetName() : std::wstring(kAnonimous);
   auto name_size = canvas->PrintAt(
       print_box, equal_sign ? printable_name + L" = " : printable_name,
       render_behaviour.GetSubSuper(), dry_run);
@@ -335,7 +471,7 @@ const INodeImpl* Variable::Value() const {
 }
 
 INodeImpl* Variable::GetVisibleNode() {
-  if (!name_.empty())
+  if (!symbol_.IsEmpty())
     return this;
   if (!value_)
     return nullptr;
@@ -347,7 +483,7 @@ INodeImpl* Variable::GetVisibleNode() {
 }
 
 const INodeImpl* Variable::GetVisibleNode() const {
-  if (!name_.empty())
+  if (!symbol_.IsEmpty())
     return this;
   if (!value_)
     return nullptr;
@@ -358,8 +494,14 @@ const INodeImpl* Variable::GetVisibleNode() const {
   return inner;
 }
 
+NodeArena* Variable::Arena() {
+  if (!arena_)
+    arena_ = NodeArena::Create();
+  return arena_;
+}
+
 Variable::operator std::unique_ptr<INode>() const {
-  if (!name_.empty())
+  if (!symbol_.IsEmpty())
     return std::make_unique<VariableRef>(this);
   if (!value_)
     return std::make_unique<ErrorNode>(L"bind to empty unnamed var");
@@ -1,7 +1,17 @@
 #pragma once
 
+#include <stdint.h>
+
+#include <iosfwd>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "INode.h"
 #include "INodeImpl.h"
+#include "Symbol.h"
+
+class NodeArena;
 
 class Variable : protected INodeImpl {
  public:
@@ -11,11 +21,23 @@ class Variable : protected INodeImpl {
   Variable(const Variable&) = delete;
   ~Variable() override;
 
+  // A variable owns an arena rather than living in one.
+  static void* operator new(size_t size) { return ::operator new(size); }
+  static void operator delete(void* ptr) { ::operator delete(ptr); }
+
   std::wstring Print(bool with_calc = false, uint32_t base_line = 0) const;
+  // Writes the same text as Print() to |out| in bands of |band_height| rows,
+  // only one band is kept in memory.
+  void PrintTo(std::wostream& out,
+               bool with_calc = false,
+               uint32_t band_height = 32) const;
   void Simplify();
   void OpenBrackets();
   void ConvertToComplex();
-  std::wstring GetName() const;
+  const std::wstring& GetName() const;
+  Symbol GetSymbol() const { return symbol_; }
+  // Assigned expression, nullptr if there is none.
+  const INode* GetValue() const { return value_.get(); }
 
   void operator=(std::unique_ptr<INode> value);
   void operator=(const Variable& var);
@@ -30,15 +52,20 @@ class Variable : protected INodeImpl {
  protected:
   // INodeImpl interface
   NodeType GetNodeType() const override;
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   PrintSize LastPrintSize() const override;
   int Priority() const override;
   bool HasFrontMinus() const override;
   ValueType GetValueType() const override;
   bool CheckCircular(const INodeImpl* other) const override;
+  uint64_t ComputeHash() const override;
+  void CollectFreeVariables(SymbolSet* result) const override;
+  void ForgetChildren() const override;
+  void DropCaches() const override;
+  bool TrackLayout() const override;
   Constant* AsConstant() override;
   const Constant* AsConstant() const override;
   const ErrorNode* AsError() const override;
@@ -54,8 +81,39 @@ class Variable : protected INodeImpl {
                             std::unique_ptr<INode>* new_node) override;
 
  private:
+  friend class CompiledExpression;
+  friend class Operation;
   friend class VariableRef;
   friend class Tests;
+
+  // Variables the value is computed from with their ValueVersion(), a
+  // variable before the ones its value refers to.
+  using CalcSources = std::vector<std::pair<const Variable*, uint64_t>>;
+
+  // Sizes measured by the dry run of Print(). The layout stays valid while
+  // the value and the variables the calculated value was computed from are
+  // not mutated, then printing again only paints. It is dropped with the
+  // caches of the variable.
+  struct PrintLayout {
+    bool with_calc = false;
+    bool tracked = false;
+    CalcSources calc_sources;
+    PrintSize value_size;
+    PrintSize total_size;
+    std::unique_ptr<Variable> calculated_value;
+  };
+
+  void Layout(Canvas* canvas,
+              bool with_calc,
+              RenderBehaviour render_behaviour) const;
+  bool IsLayoutCurrent(bool with_calc) const;
+  PrintSize LayoutSize(Canvas* canvas,
+                       bool with_calc,
+                       uint32_t base_line) const;
+  void Paint(Canvas* canvas,
+             const PrintSize& total_size,
+             bool with_calc,
+             uint32_t base_line) const;
   PrintSize RenderName(Canvas* canvas,
                        PrintBox print_box,
                        bool dry_run,
@@ -66,12 +124,20 @@ class Variable : protected INodeImpl {
                         bool dry_run,
                         RenderBehaviour render_behaviour) const;
 
+  static void CollectCalcSources(const INodeImpl* node, CalcSources* result);
+  // Changes whenever the value is replaced or mutated, 0 when the mutations
+  // can't be followed.
+  uint64_t ValueVersion() const;
   INodeImpl* Value();
   const INodeImpl* Value() const;
   INodeImpl* GetVisibleNode();
   const INodeImpl* GetVisibleNode() const;
+  NodeArena* Arena();
 
   mutable PrintSize print_size_;
-  std::wstring name_;
+  mutable std::unique_ptr<PrintLayout> print_layout_;
+  mutable uint64_t value_version_ = 1;
+  Symbol symbol_;
   std::unique_ptr<INode> value_;
+  NodeArena* arena_ = nullptr;
 };
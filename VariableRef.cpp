@@ -32,6 +32,17 @@ CompareResult VariableRef::Compare(const INode* rh) const {
   return var_->Compare(rh);
 }
 
+uint64_t VariableRef::ComputeHash() const {
+  // The value of an anonymous variable is owned and mutated elsewhere.
+  if (var_->GetSymbol().IsEmpty())
+    MarkUncacheable();
+  return var_->Hash();
+}
+
+void VariableRef::CollectFreeVariables(SymbolSet* result) const {
+  result->Insert(var_->GetSymbol());
+}
+
 std::unique_ptr<INode> VariableRef::Clone() const {
   return std::make_unique<VariableRef>(var_);
 }
@@ -40,17 +51,18 @@ NodeType VariableRef::GetNodeType() const {
   return var_->GetNodeType();
 }
 
-PrintSize VariableRef::Render(Canvas* canvas,
-                              PrintBox print_box,
-                              bool dry_run,
-                              RenderBehaviour render_behaviour) const {
-  if (!var_->name_.empty())
+PrintSize VariableRef::RenderImpl(Canvas* canvas,
+                                  PrintBox print_box,
+                                  bool dry_run,
+                                  RenderBehaviour render_behaviour) const {
+  if (!var_->symbol_.IsEmpty())
     render_behaviour.SetVariable(VariableBehaviour::NameOnly);
-  return var_->Render(canvas, print_box, dry_run, render_behaviour);
+  return print_size_ =
+             var_->Render(canvas, print_box, dry_run, render_behaviour);
 }
 
 PrintSize VariableRef::LastPrintSize() const {
-  return var_->LastPrintSize();
+  return print_size_;
 }
 
 Constant* VariableRef::AsConstant() {
@@ -14,10 +14,10 @@ class VariableRef : public INodeImpl {
 
   // INodeImpl interface
   NodeType GetNodeType() const override;
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   PrintSize LastPrintSize() const override;
   int Priority() const override;
   bool HasFrontMinus() const override;
@@ -38,6 +38,12 @@ class VariableRef : public INodeImpl {
   void ConvertToComplexImpl(HotToken token,
                             std::unique_ptr<INode>* new_node) override;
 
+ protected:
+  uint64_t ComputeHash() const override;
+  void CollectFreeVariables(SymbolSet* result) const override;
+
  private:
   const Variable* var_ = nullptr;
+  // The variable itself is rendered by every reference and by its own print.
+  mutable PrintSize print_size_;
 };
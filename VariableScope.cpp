@@ -0,0 +1,27 @@
+#include "VariableScope.h"
+
+#include <cassert>
+
+#include "Variable.h"
+
+VariableScope::VariableScope() {}
+
+VariableScope::~VariableScope() {}
+
+void VariableScope::Add(Variable* var) {
+  assert(!var->GetName().empty());
+  variables_[var->GetName()] = var;
+}
+
+Variable* VariableScope::Get(const std::wstring& name) {
+  auto it = variables_.find(name);
+  if (it != variables_.end())
+    return it->second;
+  owned_.push_back(std::make_unique<Variable>(name));
+  return variables_[name] = owned_.back().get();
+}
+
+Variable* VariableScope::Find(const std::wstring& name) const {
+  auto it = variables_.find(name);
+  return it != variables_.end() ? it->second : nullptr;
+}
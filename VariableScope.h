@@ -0,0 +1,30 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Variable;
+
+// Variables referenced by parsed expressions, looked up by name. Expressions
+// keep pointers to the variables, so the scope must outlive them.
+class VariableScope {
+ public:
+  VariableScope();
+  VariableScope(const VariableScope&) = delete;
+  ~VariableScope();
+
+  // Makes |var| visible by its name. The variable is not owned.
+  void Add(Variable* var);
+  // Returns the variable named |name|, created on first use.
+  Variable* Get(const std::wstring& name);
+  // Returns nullptr if the scope has no variable named |name|.
+  Variable* Find(const std::wstring& name) const;
+
+  size_t Size() const { return variables_.size(); }
+
+ private:
+  std::unordered_map<std::wstring, Variable*> variables_;
+  std::vector<std::unique_ptr<Variable>> owned_;
+};
@@ -33,10 +33,10 @@ std::unique_ptr<INode> Vector::SymCalc(SymCalcSettings settings) const {
   return AbstractSequence::DoSymCalc(std::make_unique<Vector>(), settings);
 }
 
-PrintSize Vector::Render(Canvas* canvas,
-                         PrintBox print_box,
-                         bool dry_run,
-                         RenderBehaviour render_behaviour) const {
+PrintSize Vector::RenderImpl(Canvas* canvas,
+                             PrintBox print_box,
+                             bool dry_run,
+                             RenderBehaviour render_behaviour) const {
   render_behaviour.TakeMinus();
   render_behaviour.TakeBrackets();
   return AbstractSequence::DoRender(PrintDirection::Vertical, canvas, print_box,
@@ -44,6 +44,7 @@ PrintSize Vector::Render(Canvas* canvas,
 }
 
 void Vector::Add(std::unique_ptr<Vector> rh) {
+  InvalidateCaches();
   for (size_t i = 0; i < rh->Size(); ++i) {
     if (Size() < i) {
       values_.push_back(rh->TakeValue(i));
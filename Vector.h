@@ -19,10 +19,10 @@ class Vector : public AbstractSequence {
 
   // INodeImpl interface
   NodeType GetNodeType() const override { return NodeType::Vector; }
-  PrintSize Render(Canvas* canvas,
-                   PrintBox print_box,
-                   bool dry_run,
-                   RenderBehaviour render_behaviour) const override;
+  PrintSize RenderImpl(Canvas* canvas,
+                       PrintBox print_box,
+                       bool dry_run,
+                       RenderBehaviour render_behaviour) const override;
   int Priority() const override { return 100; }
   ValueType GetValueType() const override { return ValueType::Vector; }
   Vector* AsVector() override { return this; }